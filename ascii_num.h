@@ -56,6 +56,12 @@ void modp_dtoa2(double value, char *str, int prec);
 //
 const char * jRead_atoi( const char *p, unsigned int *result );	// string to unsigned int
 const char * jRead_atol( const char *p, long *result );			// string to signed long
-const char * jRead_atof( const char *p, double *result);		// string to double (does not do exponents)
+const char * jRead_atof( const char *p, double *result);		// string to double (nearest, with exponents)
+const char * jRead_atoll( const char *p, long long *result );			// string to signed 64 bit, NULL on overflow
+const char * jRead_atoull( const char *p, unsigned long long *result );	// string to unsigned 64 bit, NULL on overflow
+// as above, reading no chars at or after pEnd (pEnd = NULL: up to the first non number char)
+const char * jRead_atofn( const char *p, const char *pEnd, double *result );
+const char * jRead_atolln( const char *p, const char *pEnd, long long *result );
+const char * jRead_atoulln( const char *p, const char *pEnd, unsigned long long *result );
 
 }
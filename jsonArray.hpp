@@ -0,0 +1,153 @@
+/**
+ * @brief jsonArray.hpp
+ * Parallel reader for a large top-level JSON array
+ *
+ * The element boundaries are found in one pass (the ',' between elements
+ * are found by block scanning, see jScanSeparators()), the elements are then split
+ * into batches shared by worker threads that steal batches from each
+ * other when their own run out. Each worker runs the compiled queries on
+ * its elements and passes the results to a handler:
+ *
+ *    static void onElement(const JsonArray::Record &record, void *pUser)
+ *    {
+ *        long id;
+ *        if (Json::getValue(record.pResults[0], id) == ReadError::JS_OK)
+ *            ((Totals *)pUser)[record.worker].sum += id;
+ *    }
+ *
+ *    JsonArray array;
+ *    array.addQuery("{'id'");
+ *    array.read(file, onElement, totals, JARRAY_UNORDERED, 0);
+ *
+ * *NOTES*
+ *    JARRAY_UNORDERED calls the handler from the worker threads as elements
+ *    are read, the handler must be thread safe (or keep per worker results,
+ *    see Record.worker).
+ *    JARRAY_ORDERED calls the handler for one element at a time in index
+ *    order, results of batches read ahead are held until the batches before
+ *    them are delivered.
+ *    The worker threads are kept until the JsonArray is destroyed, a
+ *    JsonArray is read by one thread at a time.
+ *    Boundaries are found as by the reader, elements are not validated
+ *    (see Json::validate()). If the text is not an array no element is
+ *    read, see getError().
+ *
+ */
+
+#ifndef JSONARRAY_HPP
+#define JSONARRAY_HPP
+
+#include "jsonRW.hpp"
+#include <vector>
+
+#define JARRAY_BATCH 256 // elements per batch taken by a worker
+
+// Delivery order for JsonArray::read()
+#define JARRAY_UNORDERED 0 // handler called by the workers, any order
+#define JARRAY_ORDERED 1   // handler called one element at a time, in index order
+
+namespace jonaskgandersson
+{
+class JsonFile; // see jsonFile.hpp
+
+/**
+	 * @brief Top-level array reader
+	 *
+	 */
+class JsonArray
+{
+public:
+	/**
+		 * @brief One element and its query results
+		 *
+		 */
+	struct Record
+	{
+		const char *pElement;				// element text, not '\0'-terminated
+		size_t length;						// length of element text
+		size_t index;						// index of the element in the array
+		int worker;							// worker thread that read the element, 0 .. threads - 1
+		const struct ReadElement *pResults; // one result per query, in addQuery() order
+	};
+
+	/**
+		 * @brief Element handler
+		 *
+		 * record and its results are valid during the call only,
+		 * elements point into the text read
+		 */
+	typedef void (*Handler)(const Record &record, void *pUser);
+
+	JsonArray();
+	~JsonArray();
+
+	/**
+		 * @brief Add query run on each element
+		 *
+		 * @param pQuery Query string, queries are run without parameters ('*' reads index 0)
+		 * @return int Query number (index in Record.pResults), -1 if the query is bad
+		 */
+	int addQuery(const char *pQuery);
+
+	/**
+		 * @brief Read elements
+		 *
+		 * Returns when all elements are delivered. Worker threads are started by the
+		 * first read() that needs them and kept for the next, one read() at a time.
+		 *
+		 * @param pJson JSON text, a top-level array, no char at or after pJson + length is read
+		 * @param length Length of text
+		 * @param handler Called for each element
+		 * @param pUser Passed to handler
+		 * @param order JARRAY_UNORDERED or JARRAY_ORDERED
+		 * @param threads Number of worker threads (the caller is one), 0 for one per core
+		 * @return size_t Number of elements read, 0 on error
+		 */
+	size_t read(const char *pJson, size_t length, Handler handler, void *pUser, int order, int threads);
+
+	/**
+		 * @brief Read elements of a mapped file
+		 *
+		 * Same as read(pJson, length, ...) for the contents of file
+		 */
+	size_t read(const JsonFile &file, Handler handler, void *pUser, int order, int threads);
+
+	/**
+		 * @brief Number of worker threads used by the last read()
+		 *
+		 * @return int Threads, per worker results can be kept in an array of this size
+		 */
+	int getThreads() const;
+
+	/**
+		 * @brief Error of the last read()
+		 *
+		 * @return int 0 if the array was read, else error code (see Json::jReadErrorToString()):
+		 *         8 Unexpected character (not an array), 2 Error reading JSON value (array not closed or element missing)
+		 */
+	int getError() const;
+
+private:
+	struct Element; // offset and length of an element
+	struct Queue;	// batches owned by a worker
+	struct Batch;	// results of a batch read ahead of delivery (JARRAY_ORDERED)
+	struct Reader;
+	struct Pool;	// worker threads kept between reads
+
+	JsonArray(const JsonArray &);			 // not copyable, the workers use this
+	JsonArray &operator=(const JsonArray &); // not copyable
+
+	static int findElements(const char *pJson, size_t length, std::vector<Element> &elements);
+	bool takeBatch(Reader &reader, int worker, size_t *pBatch) const;
+	void readBatches(Reader &reader, int worker) const;
+	void work(int worker) const;
+
+	std::vector<Json::Query> queries;
+	int threads;
+	int error;
+	Pool *pPool;
+};
+
+} // namespace jonaskgandersson
+
+#endif
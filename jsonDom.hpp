@@ -0,0 +1,237 @@
+/**
+ * @brief jsonDom.hpp
+ * Mutable document tree held in a caller supplied arena
+ *
+ * The tree is built in one pass by Json::parse(). Nodes, their child
+ * arrays and decoded strings are bump allocated from the arena, so the
+ * whole tree is freed by clear() (or by building the next document):
+ *
+ *    static char arena[64 * 1024];
+ *    JsonDom dom(arena, sizeof(arena));
+ *    if (dom.build(pJson, jsonLen) == 0)
+ *    {
+ *        JsonDom::Node *pQty = dom.find("{'items'[*{'qty'", params);
+ *        dom.setNumber(pQty, 3LL);
+ *        dom.print(dom.getRoot(), out, sizeof(out));
+ *    }
+ *
+ * *NOTES*
+ *    The children of an object or array are one contiguous array of
+ *    nodes, members keep the order of the text.
+ *    Strings and keys without escapes point into the JSON text (which must
+ *    be kept while the tree is used), others are decoded into the arena.
+ *    Strings are not '\0'-terminated, see Node.length.
+ *    Numbers keep their text, see getValue().
+ *    add() and remove() move the children of the container, pointers to
+ *    them are not valid after. Space of replaced strings and child arrays
+ *    is not reused 'til clear().
+ *
+ */
+
+#ifndef JSONDOM_HPP
+#define JSONDOM_HPP
+
+#include "jsonRW.hpp"
+
+#define JDOM_MIN_CHILDREN 4 // children allocated for a container's first add()
+
+namespace jonaskgandersson
+{
+/**
+	 * @brief Document tree
+	 *
+	 */
+class JsonDom
+{
+public:
+	/**
+		 * @brief Value of the tree, 32 bytes on 64 bit targets
+		 *
+		 */
+	struct Node
+	{
+		const char *pKey; // key of an object member (not '\0'-terminated), NULL otherwise
+		union
+		{
+			const char *pText; // JREAD_STRING: decoded text, JREAD_NUMBER, JREAD_BOOL, JREAD_NULL: text
+			Node *pChildren;   // JREAD_OBJECT, JREAD_ARRAY: children
+		};
+		unsigned int length;   // length of text, or number of children
+		unsigned int capacity; // children allocated (JREAD_OBJECT, JREAD_ARRAY)
+		unsigned int keyLen;   // length of key
+		int type;			   // JREAD_OBJECT, JREAD_ARRAY, JREAD_STRING, JREAD_NUMBER, JREAD_BOOL or JREAD_NULL
+	};
+
+	/**
+		 * @brief Create tree using an arena
+		 *
+		 * @param pArena Memory for the tree, not owned
+		 * @param arenaSize Size of arena
+		 */
+	JsonDom(char *pArena, size_t arenaSize);
+
+	/**
+		 * @brief Build the tree of a document
+		 *
+		 * Frees the tree built before
+		 *
+		 * @param pJson JSON text, no char at or after pJson + jsonLen is read
+		 * @param jsonLen Length of JSON text
+		 * @return int 0 if built, else error code (see Json::jReadErrorToString()), 19 Arena full
+		 */
+	int build(const char *pJson, size_t jsonLen);
+
+	/**
+		 * @brief Build the tree of a '\0'-terminated document
+		 *
+		 * @param pJson '\0'-terminated JSON text
+		 * @return int 0 if built, else error code, 19 Arena full
+		 */
+	int build(const char *pJson);
+
+	/**
+		 * @brief Free the tree, one reset of the arena
+		 *
+		 */
+	void clear();
+
+	/**
+		 * @brief Root value
+		 *
+		 * @return Node* Root, NULL if no tree is built
+		 */
+	Node *getRoot();
+
+	/**
+		 * @brief Arena used
+		 *
+		 * @return size_t Bytes allocated since clear()
+		 */
+	size_t getUsed() const;
+
+	/**
+		 * @brief Find a value by query
+		 *
+		 * Queries are as Json::getElement(), from the root: {'key' member, [n element,
+		 * '*' takes the index from queryParams. {n (key at index) is not supported.
+		 * Keys are compared decoded, query keys are taken as written.
+		 *
+		 * @param pQuery Query string
+		 * @param queryParams Parameters of '*' in the query, NULL if none
+		 * @return Node* Value, NULL if not found or the query is bad
+		 */
+	Node *find(const char *pQuery, int *queryParams);
+
+	/**
+		 * @brief Find a value by compiled query
+		 *
+		 * @param query Query made once, see Json::Query
+		 * @param queryParams Parameters of '*' in the query, NULL if none
+		 * @return Node* Value, NULL if not found
+		 */
+	Node *find(const Json::Query &query, int *queryParams);
+
+	/**
+		 * @brief Member of an object
+		 *
+		 * @param pObject Object
+		 * @param key Key (decoded), '\0'-terminated
+		 * @return Node* First member with key, NULL if none or not an object
+		 */
+	static Node *member(Node *pObject, const char *key);
+
+	/**
+		 * @brief Element of an array or member of an object by index
+		 *
+		 * @param pContainer Array or object
+		 * @param index Index
+		 * @return Node* Child, NULL if none
+		 */
+	static Node *child(Node *pContainer, unsigned int index);
+
+	/**
+		 * @brief Node values
+		 *
+		 * Converted as Json::getValue(element, value), strings are their decoded text
+		 *
+		 * @param pNode Node
+		 * @param value Variable to put the result in
+		 * @return ReadError JS_OK or JS_ERROR (no node, object, array or does not fit)
+		 */
+	static ReadError getValue(const Node *pNode, long &value);
+	static ReadError getValue(const Node *pNode, int &value);
+	static ReadError getValue(const Node *pNode, long long &value);
+	static ReadError getValue(const Node *pNode, double &value);
+	static ReadError getValue(const Node *pNode, bool &value);
+
+	/**
+		 * @brief Add a child to an object or array
+		 *
+		 * The child is null 'til set, other children may move (see NOTES)
+		 *
+		 * @param pContainer Object or array
+		 * @param key Key of the member, copied, NULL for arrays
+		 * @return Node* New child, NULL if arena full, not a container or key missing for an object
+		 */
+	Node *add(Node *pContainer, const char *key);
+
+	/**
+		 * @brief Remove a child of an object or array
+		 *
+		 * @param pContainer Object or array
+		 * @param index Index of child
+		 * @return true if removed
+		 */
+	bool remove(Node *pContainer, unsigned int index);
+
+	/**
+		 * @brief Set the value of a node
+		 *
+		 * Containers set to another value lose their children, setObject() and setArray() make
+		 * empty ones. Strings and numbers are copied into the arena, a double with the
+		 * fewest digits (15 to 17) that read back as the same double.
+		 *
+		 * @param pNode Node to set, not NULL
+		 * @return true if set, false if arena full (or the double is NaN or infinite)
+		 */
+	bool setString(Node *pNode, const char *value, size_t length);
+	bool setString(Node *pNode, const char *value);
+	bool setNumber(Node *pNode, long long value);
+	bool setNumber(Node *pNode, double value);
+	void setBool(Node *pNode, bool value);
+	void setNull(Node *pNode);
+	void setObject(Node *pNode);
+	void setArray(Node *pNode);
+
+	/**
+		 * @brief Write a value as compact JSON text
+		 *
+		 * Strings and keys are escaped
+		 *
+		 * @param pNode Value to write
+		 * @param pDest Destination, '\0'-terminated if destLen > 0
+		 * @param destLen Size of pDest
+		 * @return size_t Length of the text (also when more than destLen - 1)
+		 */
+	static size_t print(const Node *pNode, char *pDest, size_t destLen);
+
+private:
+	class Builder; // Json::Handler building the tree
+
+	void *allocate(size_t size, size_t align);
+	const char *copyText(const char *pText, size_t length);
+	static struct ReadElement element(const Node *pNode);
+
+	char *pArena;
+	size_t arenaSize;
+	size_t used;  // bytes allocated from the start of the arena
+	size_t limit; // end of the space allocate() may use, below the stack of build()
+	Node *pRoot;
+
+	JsonDom(const JsonDom &);			 // not copyable, nodes point into the arena
+	JsonDom &operator=(const JsonDom &); // not copyable
+};
+
+} // namespace jonaskgandersson
+
+#endif
@@ -0,0 +1,98 @@
+/**
+ * @brief jsonFile.hpp
+ * Read-only memory mapped JSON file
+ *
+ * The file is mapped, not read, so multi-gigabyte documents are
+ * queried in place with a read-only Json object:
+ *
+ *    JsonFile file;
+ *    if (file.open("export.json", JFILE_SEQUENTIAL) == JFILE_OK)
+ *    {
+ *        Json json(file);
+ *        json.getValue("{'count'", count);
+ *    }
+ *
+ * *NOTES*
+ *    the mapping is not '\0'-terminated, Json reads it bounded by size()
+ *    (also with the static functions taking pJson and jsonLen).
+ *    Elements returned by queries point into the mapping and are valid
+ *    until close().
+ *    Memory mapping needs a POSIX system, elsewhere open() returns
+ *    JFILE_NOT_SUPPORTED.
+ *
+ */
+
+#ifndef JSONFILE_HPP
+#define JSONFILE_HPP
+
+#include <stddef.h>
+
+// Hints for JsonFile::open(), advisory only
+#define JFILE_NORMAL 0	   // no hints
+#define JFILE_SEQUENTIAL 1 // file is read front to back, aggressive read ahead
+#define JFILE_WILLNEED 2   // start reading the whole file in the background
+#define JFILE_HUGEPAGES 4  // back the mapping with huge pages where the system can
+#define JFILE_PREFAULT 8   // read and map all pages in open(), no page faults on queries
+
+// Error Codes
+// -----------
+#define JFILE_OK 0
+#define JFILE_OPEN_FAILED 1	// file not found or not readable (see errno)
+#define JFILE_TOO_LARGE 2		// file does not fit in the address space
+#define JFILE_MAP_FAILED 3		// mmap() failed (see errno)
+#define JFILE_NOT_SUPPORTED 4 // no memory mapping on this system
+
+namespace jonaskgandersson
+{
+/**
+	 * @brief Read-only memory mapped file
+	 *
+	 */
+class JsonFile
+{
+public:
+	JsonFile();
+	~JsonFile();
+
+	/**
+		 * @brief Map a file
+		 *
+		 * A file already open is closed first
+		 *
+		 * @param path File to map
+		 * @param hints JFILE_... hints or'ed together
+		 * @return int Error code, JFILE_OK if mapped
+		 */
+	int open(const char *path, int hints);
+
+	/**
+		 * @brief Unmap the file
+		 *
+		 */
+	void close();
+
+	/**
+		 * @brief Start of the mapped file
+		 *
+		 * @return const char* File contents, "" if no file is open
+		 */
+	const char *data() const;
+
+	/**
+		 * @brief Size of the mapped file
+		 *
+		 * @return size_t Size in bytes, 0 if no file is open
+		 */
+	size_t size() const;
+
+private:
+	JsonFile(const JsonFile &);			   // not copyable, owns the mapping
+	JsonFile &operator=(const JsonFile &); // not copyable
+
+	const char *pData; // mapping, NULL if no file or an empty file is open
+	size_t length;	   // size of the file
+};
+
+} // namespace jonaskgandersson
+
+#endif
@@ -0,0 +1,127 @@
+/**
+ * @brief jsonLines.hpp
+ * Parallel reader for newline-delimited JSON (NDJSON, JSON Lines)
+ *
+ * The text is split into line-aligned chunks, worker threads take
+ * chunks in turn, run the compiled queries on each record and pass
+ * the results to a handler:
+ *
+ *    static void onRecord(const JsonLines::Record &record, void *pUser)
+ *    {
+ *        long id;
+ *        if (Json::getValue(record.pResults[0], id) == ReadError::JS_OK)
+ *            ((Totals *)pUser)[record.worker].sum += id;
+ *    }
+ *
+ *    JsonLines lines;
+ *    lines.addQuery("{'id'");
+ *    lines.addQuery("{'user'{'name'");
+ *    lines.read(file, onRecord, totals, JLINES_UNORDERED, 0);
+ *
+ * *NOTES*
+ *    JLINES_UNORDERED calls the handler from the worker threads as records
+ *    are read, the handler must be thread safe (or keep per worker results,
+ *    see Record.worker).
+ *    JLINES_ORDERED calls the handler for one record at a time in file order,
+ *    results of chunks read ahead are held until the chunks before them
+ *    are delivered.
+ *    Empty lines are skipped, a '\r' before the '\n' is not part of the record.
+ *
+ */
+
+#ifndef JSONLINES_HPP
+#define JSONLINES_HPP
+
+#include "jsonRW.hpp"
+#include <vector>
+
+#define JLINES_CHUNK (1 << 20) // bytes per chunk taken by a worker
+
+// Delivery order for JsonLines::read()
+#define JLINES_UNORDERED 0 // handler called by the workers, any order
+#define JLINES_ORDERED 1   // handler called one record at a time, in file order
+
+namespace jonaskgandersson
+{
+class JsonFile; // see jsonFile.hpp
+
+/**
+	 * @brief NDJSON reader
+	 *
+	 */
+class JsonLines
+{
+public:
+	/**
+		 * @brief One record (line) and its query results
+		 *
+		 */
+	struct Record
+	{
+		const char *pLine;				  // record text, not '\0'-terminated
+		size_t length;					  // length of record text
+		size_t offset;					  // offset of the record in the text read
+		int worker;						  // worker thread that read the record, 0 .. threads - 1
+		const struct ReadElement *pResults; // one result per query, in addQuery() order
+	};
+
+	/**
+		 * @brief Record handler
+		 *
+		 * record and its results are valid during the call only,
+		 * elements point into the text read
+		 */
+	typedef void (*Handler)(const Record &record, void *pUser);
+
+	JsonLines();
+
+	/**
+		 * @brief Add query run on each record
+		 *
+		 * @param pQuery Query string, queries are run without parameters ('*' reads index 0)
+		 * @return int Query number (index in Record.pResults), -1 if the query is bad
+		 */
+	int addQuery(const char *pQuery);
+
+	/**
+		 * @brief Read records
+		 *
+		 * Returns when all records are delivered
+		 *
+		 * @param pText NDJSON text, no char at or after pText + length is read
+		 * @param length Length of text
+		 * @param handler Called for each record
+		 * @param pUser Passed to handler
+		 * @param order JLINES_UNORDERED or JLINES_ORDERED
+		 * @param threads Number of worker threads, 0 for one per core
+		 * @return size_t Number of records read
+		 */
+	size_t read(const char *pText, size_t length, Handler handler, void *pUser, int order, int threads);
+
+	/**
+		 * @brief Read records of a mapped file
+		 *
+		 * Same as read(pText, length, ...) for the contents of file
+		 */
+	size_t read(const JsonFile &file, Handler handler, void *pUser, int order, int threads);
+
+	/**
+		 * @brief Number of worker threads used by the last read()
+		 *
+		 * @return int Threads, per worker results can be kept in an array of this size
+		 */
+	int getThreads() const;
+
+private:
+	struct Chunk; // records of a chunk read ahead of delivery (JLINES_ORDERED)
+	struct Reader;
+
+	void readChunks(Reader &reader, int worker) const;
+
+	std::vector<Json::Query> queries;
+	int threads;
+};
+
+} // namespace jonaskgandersson
+
+#endif
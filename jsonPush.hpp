@@ -0,0 +1,134 @@
+/**
+ * @brief jsonPush.hpp
+ * Resumable push tokenizer for JSON received in fragments
+ *
+ * Input is fed as it arrives, in fragments of any size. The tokenizer
+ * keeps its state between calls (nesting, strings, escapes, partial
+ * numbers and literals) and reports when a top-level value is complete,
+ * so a message is known to be whole without rescanning it:
+ *
+ *    JsonPush push;
+ *    while ((len = recv(sock, buf, sizeof(buf), 0)) > 0)
+ *    {
+ *        const char *p = buf;
+ *        while ((status = push.feed(p, len)) == JPUSH_COMPLETE)
+ *        {
+ *            message.append(p, push.getConsumed()); // message is complete
+ *            handleMessage(message);
+ *            message.clear();
+ *            p += push.getConsumed();
+ *            len -= push.getConsumed();
+ *        }
+ *        if (status == JPUSH_ERROR)
+ *            break;
+ *        message.append(p, len); // rest of the next message
+ *    }
+ *
+ * *NOTES*
+ *    memory use is fixed: no input is kept, nesting is held one bit
+ *    per level up to JREAD_STACK_DEPTH levels.
+ *    Whitespace between top-level values is skipped (and counted in
+ *    getConsumed()).
+ *    A top-level number ends at the first char after it, at the end of the
+ *    input call finish() to complete it.
+ *    Control chars in strings are errors, escapes are checked, UTF-8 is not.
+ *
+ */
+
+#ifndef JSONPUSH_HPP
+#define JSONPUSH_HPP
+
+#include "jsonRW.hpp"
+
+// Return values of JsonPush::feed() and JsonPush::finish()
+#define JPUSH_MORE 0	 // all input used, the value is not complete
+#define JPUSH_COMPLETE 1 // a top-level value is complete, see getConsumed()
+#define JPUSH_ERROR 2	 // input is not JSON, see getError()
+
+namespace jonaskgandersson
+{
+/**
+	 * @brief Push tokenizer
+	 *
+	 */
+class JsonPush
+{
+public:
+	JsonPush();
+
+	/**
+		 * @brief Start over, the next feed() starts a new top-level value
+		 *
+		 */
+	void reset();
+
+	/**
+		 * @brief Feed the next fragment of input
+		 *
+		 * Stops at the end of the first top-level value completed,
+		 * feed the rest of the fragment (after getConsumed() chars) again
+		 * for the values after it. After JPUSH_ERROR, feed() returns
+		 * JPUSH_ERROR 'til reset().
+		 *
+		 * @param pText Fragment, not '\0'-terminated, no char at or after pText + length is read
+		 * @param length Length of fragment
+		 * @return int JPUSH_MORE, JPUSH_COMPLETE or JPUSH_ERROR
+		 */
+	int feed(const char *pText, size_t length);
+
+	/**
+		 * @brief End of input
+		 *
+		 * @return int JPUSH_COMPLETE if a top-level number was pending,
+		 *         JPUSH_MORE if no value was started, JPUSH_ERROR if a value is incomplete
+		 */
+	int finish();
+
+	/**
+		 * @brief Chars of the last fragment used by feed()
+		 *
+		 * @return size_t Chars up to and including the end of the value completed,
+		 *         the whole fragment on JPUSH_MORE, up to the error on JPUSH_ERROR
+		 */
+	size_t getConsumed() const;
+
+	/**
+		 * @brief Chars used since reset()
+		 *
+		 * @return size_t Offset in the stream, on JPUSH_ERROR the offset of the char in error
+		 */
+	size_t getOffset() const;
+
+	/**
+		 * @brief Current nesting depth
+		 *
+		 * @return int Open objects and arrays
+		 */
+	int getDepth() const;
+
+	/**
+		 * @brief Error of the last JPUSH_ERROR
+		 *
+		 * @return int Error code, as Json::jReadErrorToString(): 2 Error reading JSON value,
+		 *         3 Expected "key", 4 Expected ':', 6 Expected ',' in object,
+		 *         8 Unexpected character, 9 Expected ',' in array, 16 Nesting > JREAD_STACK_DEPTH
+		 */
+	int getError() const;
+
+private:
+	void pop();
+
+	int state;					 // what is expected next
+	int substate;				 // state within a string, number or literal
+	int depth;					 // open objects and arrays
+	int isObject;				 // innermost open value is an object
+	int error;					 // error code, 0 if none
+	size_t consumed;			 // chars of the last fragment used
+	size_t offset;				 // chars used since reset()
+	const char *pLiteral;		 // literal being read (true, false, null)
+	unsigned char stack[JREAD_STACK_DEPTH / 8]; // bit per open object/array (1= object)
+};
+
+} // namespace jonaskgandersson
+
+#endif
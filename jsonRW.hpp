@@ -12,9 +12,19 @@
  * 
  */
 
+#ifndef JSONRW_HPP
+#define JSONRW_HPP
+
+#include <stddef.h>
 #include <stdio.h>
 
 #define JWRITE_STACK_DEPTH 32 // max nesting depth of objects/arrays
+#define JREAD_STACK_DEPTH 1024 // max nesting depth of objects/arrays read by parse() and validate() (1 bit each)
+
+#define JREAD_CACHE_QUERY 48 // longest query string in the query cache (chars, with '\0')
+#define JREAD_CACHE_PARAMS 4 // most '*' parameters of a query in the query cache
+
+#define JREAD_WIDE_OBJECT 32 // members of an indexed object that get a key table, see Json::useKeyTables()
 
 #define JW_COMPACT 0 // output string control for jwOpen()
 #define JW_PRETTY 1  // pretty adds \n and indentation
@@ -60,8 +70,38 @@
 #define JREAD_EARRAY 12  // "]"
 #define JREAD_QPARAM 13  // "*" query string parameter
 
+// compiled query steps (Json::Query)
+#define JREAD_QKEY 1	  // {'key'
+#define JREAD_QKEYINDEX 2 // {NUMBER or {* returns "key" at index
+#define JREAD_QINDEX 3	// [NUMBER or [*
+#define JREAD_QMEMBERS 4  // {*} every member, see Json::getMatches()
+#define JREAD_QSLICE 5	// [a:b] elements a to b - 1, [*] every element, see Json::getMatches()
+
+#define JREAD_QUERY_END 0xFFFFFFFFu // end of a slice without b, "[a:]"
+
+#define JREAD_QUERY_STEPS 16 // max steps in a compiled query
+#define JREAD_QUERY_KEYS 128 // max total length of keys in a compiled query
+
+#define JREAD_BATCH_FIELDS 32 // max fields in a Json::Batch
+#define JREAD_BATCH_NODES 64  // max distinct query steps in a Json::Batch
+#define JREAD_BATCH_KEYS 512  // max total length of distinct keys in a Json::Batch
+
+#define JREAD_BIND_FIELDS 32 // max fields in a Json::Binding
+#define JREAD_BIND_SLOTS 256 // max slots of the key table of a Json::Binding (power of 2)
+
+// member types of a Json::Binding field, see JSON_BIND()
+#define JBIND_INT 0
+#define JBIND_LONG 1
+#define JBIND_LLONG 2
+#define JBIND_DOUBLE 3
+#define JBIND_BOOL 4
+#define JBIND_STRING 5 // char array, '\0'-terminated, escapes decoded as by getString()
+
 namespace jonaskgandersson
 {
+class JsonFile; // see jsonFile.hpp
+class JsonDom;	// see jsonDom.hpp
+
 //------------------------------------------------------
 // ReadElement
 // - structure to return JSON elements
@@ -76,11 +116,137 @@ struct ReadElement
 {
 	int dataType;		// one of JREAD_...
 	int elements;		// number of elements (e.g. elements in array or object)
-	int bytelen;		// byte length of element (e.g. length of string, array text "[ ... ]" etc.)
+	size_t bytelen;		// byte length of element (e.g. length of string, array text "[ ... ]" etc.)
 	const void *pValue; // pointer to value string in JSON text
 	int error;			// error value if dataType == JREAD_ERROR
 };
 
+//------------------------------------------------------
+// IndexEntry
+// - one entry per object/array of an indexed JSON text
+// - entries are stored in document order (order of the opening bracket)
+//
+// *NOTES*
+//    offsets are byte offsets from the start of the JSON text (size_t, 64 bit
+//    on 64 bit targets so texts over 4 GB can be indexed)
+//    storage is supplied by the application, see Json::buildIndex()
+//
+struct IndexEntry
+{
+	size_t open;  // offset of '{' or '['
+	size_t close; // offset of the matching '}' or ']'
+	int elements; // number of elements in object/array
+	int keys;	  // first KeySlot of the key table of a wide object (element table of a wide array), -1 if not built, -2 if none
+};
+
+//------------------------------------------------------
+// KeySlot
+// - one slot of the key table of a wide object of an indexed JSON text,
+//   or one element of the element table of a wide array (value only)
+//
+// *NOTES*
+//    tables are built on the first key lookup in an object (index lookup
+//    in an array) with JREAD_WIDE_OBJECT or more members, storage is
+//    supplied by the application, see Json::useKeyTables()
+//
+struct KeySlot
+{
+	size_t key;			 // offset of the key text (after the '"'), 0 if the slot is empty
+	size_t value;		 // offset after the ':' of the key, or after the '[' or ',' before the element
+	unsigned int hash;	 // hash of the key text
+	unsigned int keyLen; // length of the key text
+};
+
+//------------------------------------------------------
+// CacheEntry
+// - one query result of the query cache
+//
+// *NOTES*
+//    storage is supplied by the application, see Json::useCache()
+//
+struct CacheEntry
+{
+	unsigned int hash;					// hash of query string
+	char query[JREAD_CACHE_QUERY];		// query string
+	int params[JREAD_CACHE_PARAMS];		// values of its '*' parameters
+	struct ReadElement result;			// element found
+	const char *pAfter;					// pointer into JSON after the element
+};
+
+//------------------------------------------------------
+// BindField
+// - maps a struct member to a JSON key, see Json::Binding
+// - made by JSON_BIND(Struct, member) or JSON_BIND_KEY(Struct, member, "key"),
+//   the member type is found by BindType, other member types do not compile
+//
+struct BindField
+{
+	const char *key; // JSON key
+	size_t offset;	 // offset of the member in the struct
+	int type;		 // one of JBIND_...
+	size_t size;	 // size of the member
+};
+
+template <typename T>
+struct BindType; // int, long, long long, double, bool or char[N]
+template <>
+struct BindType<int>
+{
+	enum { type = JBIND_INT };
+};
+template <>
+struct BindType<long>
+{
+	enum { type = JBIND_LONG };
+};
+template <>
+struct BindType<long long>
+{
+	enum { type = JBIND_LLONG };
+};
+template <>
+struct BindType<double>
+{
+	enum { type = JBIND_DOUBLE };
+};
+template <>
+struct BindType<bool>
+{
+	enum { type = JBIND_BOOL };
+};
+template <size_t N>
+struct BindType<char[N]>
+{
+	enum { type = JBIND_STRING };
+};
+
+#define JSON_BIND_KEY(Struct, member, key)                                    \
+	{                                                                         \
+		key, offsetof(Struct, member),                                        \
+			jonaskgandersson::BindType<decltype(((Struct *)0)->member)>::type, \
+			sizeof(((Struct *)0)->member)                                     \
+	}
+#define JSON_BIND(Struct, member) JSON_BIND_KEY(Struct, member, #member)
+
+//------------------------------------------------------
+// IndexList
+// - list of indices 0 .. N-1 as template parameters, MakeIndexList<N>::type,
+//   used to fill arrays by constexpr functions, see Json::Query::literal()
+//
+template <size_t... I>
+struct IndexList
+{
+};
+template <size_t N, size_t... I>
+struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...>
+{
+};
+template <size_t... I>
+struct MakeIndexList<0, I...>
+{
+	typedef IndexList<I...> type;
+};
+
 enum class NodeType
 {
 	JS_OBJECT = 1,
@@ -101,6 +267,580 @@ enum class ReadError
 class Json
 {
 private:
+	struct ReadContext
+	{
+		const char *pEnd;			 // end of JSON text (read as '\0'), NULL if '\0'-terminated only
+		const char *pJson;			 // JSON text read by the instance (and indexed)
+		IndexEntry *pEntries;		 // entries in document order, NULL if no index
+		int count;					 // number of valid entries
+		KeySlot *pSlots;			 // storage of key tables, NULL if none
+		int slots;					 // number of slots in pSlots
+		mutable int slotsUsed;		 // slots taken by key tables built
+	};
+
+public:
+	/**
+		 * @brief Compiled query string
+		 * 
+		 * A query string parsed once into steps, so repeated queries
+		 * do not read the query text again.
+		 * Each '*' in the query string becomes a parameter slot,
+		 * supplied by queryParams when the query is used.
+		 * 
+		 * Query literals can be parsed by the compiler, see literal().
+		 * Wildcard and slice steps ([*], {*}, [a:b]) are read by getMatches(),
+		 * queries for one value report 15 Bad query for them.
+		 * 
+		 */
+	class Query
+	{
+	public:
+		/**
+			 * @brief Compile a query string
+			 * 
+			 * @param pQuery Query string to match object, array and key
+			 */
+		Query(const char *pQuery);
+
+		/**
+			 * @brief Compile a query literal at compile time
+			 * 
+			 * Same steps as Query(pQuery), made by the compiler when used to
+			 * initialize a constexpr query, a bad query does not compile:
+			 * 
+			 *    static constexpr Json::Query tsQuery = Json::Query::literal("{'header'{'ts'");
+			 *    Json::getValue(pJson, tsQuery, NULL, &ts);
+			 * 
+			 * or in place with JSON_QUERY(), which always binds the query to a constexpr:
+			 * 
+			 *    Json::getValue(pJson, JSON_QUERY("{'header'{'ts'"), NULL, &ts);
+			 * 
+			 * The error reported is a call to badQueryLiteral().
+			 * Not used as a constant expression the call is evaluated at run time
+			 * by the recursive constexpr helpers, which is much slower than
+			 * Query(pQuery): use a constexpr variable or JSON_QUERY().
+			 * 
+			 * @param pQuery Query string literal
+			 * @return Query Compiled query
+			 */
+		static constexpr Query literal(const char *pQuery)
+		{
+			return Query(pQuery, MakeIndexList<JREAD_QUERY_STEPS>::type(), MakeIndexList<JREAD_QUERY_KEYS>::type());
+		}
+
+		/**
+			 * @brief Error from compiling the query
+			 * 
+			 * @return int 0 if the query compiled, else error code: 12 Bad object key or 15 Bad query (syntax, too many steps or keys too long)
+			 */
+		int getError() const;
+
+		/**
+			 * @brief Compare compiled queries
+			 * 
+			 * A literal() and Query(pQuery) of the same text compare equal.
+			 * 
+			 * @return true if the steps, keys, parameter count and error are the same
+			 */
+		bool operator==(const Query &query) const;
+
+	private:
+		friend class Json;
+		friend class JsonDom;
+		struct Step
+		{
+			unsigned char type;	// one of JREAD_Q...
+			unsigned char param;   // 1= value is a queryParams slot
+			unsigned short keyLen; // length of key
+			unsigned int hash;	 // hashKey() of key, looked up in key tables as is
+			unsigned int value;	// offset of key in keys, index or queryParams slot, first index of a slice
+			unsigned int end;	  // JREAD_QSLICE: index after the last element, JREAD_QUERY_END for all
+		} steps[JREAD_QUERY_STEPS];
+		int count;					 // number of steps
+		int params;					 // number of '*' parameters
+		int keyBytes;				 // bytes used in keys
+		char keys[JREAD_QUERY_KEYS]; // key text of all JREAD_QKEY steps
+		int error;					 // error code, 0 if ok
+
+		template <size_t... S, size_t... K>
+		constexpr Query(const char *pQuery, IndexList<S...>, IndexList<K...>)
+			: steps{makeStep(pQuery, S)...}, count(countSteps(pQuery, skipSpace(pQuery, 0), 0)),
+			  params(paramsBefore(pQuery, countSteps(pQuery, skipSpace(pQuery, 0), 0))),
+			  keyBytes(keyBytesBefore(pQuery, countSteps(pQuery, skipSpace(pQuery, 0), 0))),
+			  keys{keyChar(pQuery, skipSpace(pQuery, 0), K)...},
+			  error((checkQuery(pQuery, skipSpace(pQuery, 0), 0, 0) == 0) ? 0 : badQueryLiteral(checkQuery(pQuery, skipSpace(pQuery, 0), 0, 0)))
+		{
+		}
+
+		// Query literals
+		// - the query is parsed as by Query(pQuery), by constexpr functions of
+		//   one return statement (C++11), p is the position of a step's '{' or '['
+		//   and a the position after it and its whitespace
+		// - not constexpr, a bad query literal fails to compile at its call
+		//
+		static int badQueryLiteral(int error);
+
+		static constexpr bool isDigit(char c)
+		{
+			return (c >= '0') && (c <= '9');
+		}
+
+		static constexpr size_t skipSpace(const char *q, size_t i)
+		{
+			return ((q[i] != '\0') && ((unsigned char)q[i] <= ' ')) ? skipSpace(q, i + 1) : i;
+		}
+
+		static constexpr size_t skipDigits(const char *q, size_t i)
+		{
+			return isDigit(q[i]) ? skipDigits(q, i + 1) : i;
+		}
+
+		static constexpr unsigned int readIndex(const char *q, size_t i, unsigned int index)
+		{
+			return isDigit(q[i]) ? readIndex(q, i + 1, index * 10 + (unsigned int)(q[i] - '0')) : index;
+		}
+
+		// keyEnd
+		// - closing quote of the key text starting at i, 0 if not closed
+		//
+		static constexpr size_t keyEnd(const char *q, size_t i)
+		{
+			return (q[i] == '\0') ? 0 : (q[i] == '\\') ? ((q[i + 1] == '\0') ? 0 : keyEnd(q, i + 2)) : (q[i] == QUERY_QUOTE) ? i : keyEnd(q, i + 1);
+		}
+
+		// isAll
+		// - "[*]" or "{*}", close is the ']' or '}' wanted after the '*'
+		//
+		static constexpr bool isAll(const char *q, size_t a, char close)
+		{
+			return (q[a] == '*') && (q[skipSpace(q, a + 1)] == close);
+		}
+
+		// sliceColon
+		// - position of the ':' of a slice "[a:b]", 0 if the step is not a slice
+		//
+		static constexpr size_t sliceColon(const char *q, size_t a)
+		{
+			return (q[skipSpace(q, skipDigits(q, a))] == ':') ? skipSpace(q, skipDigits(q, a)) : 0;
+		}
+
+		// sliceClose
+		// - position after b of the slice with its ':' at c, the ']' if the slice is good
+		//
+		static constexpr size_t sliceClose(const char *q, size_t c)
+		{
+			return skipSpace(q, skipDigits(q, skipSpace(q, c + 1)));
+		}
+
+		static constexpr unsigned int sliceEnd(const char *q, size_t a)
+		{
+			return (isAll(q, a, ']') || !isDigit(q[skipSpace(q, sliceColon(q, a) + 1)])) ? JREAD_QUERY_END
+																						 : readIndex(q, skipSpace(q, sliceColon(q, a) + 1), 0);
+		}
+
+		static constexpr unsigned int hashText(const char *q, size_t i, size_t end, unsigned int hash)
+		{
+			return (i == end) ? hash : hashText(q, i + 1, end, (hash ^ (unsigned char)q[i]) * 16777619u); // as hashKey()
+		}
+
+		// stepType
+		// - JREAD_Q... of the step at p, 0 at the end of the query, -error if bad
+		//
+		static constexpr int stepType(const char *q, size_t p)
+		{
+			return (q[p] == '\0') ? 0
+				   : (q[p] == '[') ? ((q[skipSpace(q, p + 1)] == '-') ? -15
+									  : isAll(q, skipSpace(q, p + 1), ']') ? JREAD_QSLICE
+									  : (sliceColon(q, skipSpace(q, p + 1)) == 0) ? JREAD_QINDEX
+									  : (q[sliceClose(q, sliceColon(q, skipSpace(q, p + 1)))] == ']') ? JREAD_QSLICE : -15)
+				   : (q[p] != '{') ? -15
+				   : isAll(q, skipSpace(q, p + 1), '}') ? JREAD_QMEMBERS
+				   : (isDigit(q[skipSpace(q, p + 1)]) || (q[skipSpace(q, p + 1)] == '*')) ? JREAD_QKEYINDEX
+				   : (q[skipSpace(q, p + 1)] == QUERY_QUOTE) ? ((keyEnd(q, skipSpace(q, p + 1) + 1) != 0) ? JREAD_QKEY : -15)
+				   : ((q[skipSpace(q, p + 1)] == '-') || (q[skipSpace(q, p + 1)] == '\"')) ? -15 : -12;
+		}
+
+		static constexpr size_t stepEndAt(const char *q, size_t a, int type)
+		{
+			return (type == JREAD_QKEY) ? keyEnd(q, a + 1) + 1
+				   : (type == JREAD_QMEMBERS) ? skipSpace(q, a + 1) + 1
+				   : (type == JREAD_QSLICE) ? (isAll(q, a, ']') ? skipSpace(q, a + 1) : sliceClose(q, sliceColon(q, a))) + 1
+				   : isDigit(q[a]) ? skipDigits(q, a) : (q[a] == '*') ? a + 1 : a;
+		}
+
+		// nextStep
+		// - position of the step after the step at p, p at the end or a bad step
+		//
+		static constexpr size_t nextStep(const char *q, size_t p)
+		{
+			return (stepType(q, p) <= 0) ? p : skipSpace(q, stepEndAt(q, skipSpace(q, p + 1), stepType(q, p)));
+		}
+
+		static constexpr size_t stepAt(const char *q, size_t step)
+		{
+			return (step == 0) ? skipSpace(q, 0) : nextStep(q, stepAt(q, step - 1));
+		}
+
+		static constexpr bool isParam(const char *q, size_t p)
+		{
+			return ((stepType(q, p) == JREAD_QINDEX) || (stepType(q, p) == JREAD_QKEYINDEX)) && (q[skipSpace(q, p + 1)] == '*');
+		}
+
+		static constexpr size_t keyLenAt(const char *q, size_t p)
+		{
+			return (stepType(q, p) == JREAD_QKEY) ? keyEnd(q, skipSpace(q, p + 1) + 1) - (skipSpace(q, p + 1) + 1) : 0;
+		}
+
+		static constexpr int countSteps(const char *q, size_t p, int count)
+		{
+			return (stepType(q, p) <= 0) ? count : countSteps(q, nextStep(q, p), count + 1);
+		}
+
+		static constexpr int paramsBefore(const char *q, int step)
+		{
+			return (step == 0) ? 0 : paramsBefore(q, step - 1) + (isParam(q, stepAt(q, step - 1)) ? 1 : 0);
+		}
+
+		static constexpr int keyBytesBefore(const char *q, int step)
+		{
+			return (step == 0) ? 0 : keyBytesBefore(q, step - 1) + (int)keyLenAt(q, stepAt(q, step - 1));
+		}
+
+		// checkQuery
+		// - error of the query from the step at p, as Query(pQuery)
+		//
+		static constexpr int checkQuery(const char *q, size_t p, int count, size_t keyBytes)
+		{
+			return (stepType(q, p) < 0) ? -stepType(q, p)
+				   : (stepType(q, p) == 0) ? 0
+				   : ((count >= JREAD_QUERY_STEPS) || (keyBytes + keyLenAt(q, p) > JREAD_QUERY_KEYS)) ? 15
+				   : checkQuery(q, nextStep(q, p), count + 1, keyBytes + keyLenAt(q, p));
+		}
+
+		static constexpr Step makeStepAt(const char *q, size_t p, int step)
+		{
+			return Step{(unsigned char)stepType(q, p), (unsigned char)(isParam(q, p) ? 1 : 0), (unsigned short)keyLenAt(q, p),
+						(stepType(q, p) == JREAD_QKEY) ? hashText(q, skipSpace(q, p + 1) + 1, keyEnd(q, skipSpace(q, p + 1) + 1), 2166136261u) : 0u,
+						isParam(q, p) ? (unsigned int)paramsBefore(q, step)
+						: (stepType(q, p) == JREAD_QKEY) ? (unsigned int)keyBytesBefore(q, step)
+						: readIndex(q, skipSpace(q, p + 1), 0),
+						(stepType(q, p) == JREAD_QSLICE) ? sliceEnd(q, skipSpace(q, p + 1)) : 0u};
+		}
+
+		static constexpr Step makeStep(const char *q, size_t step)
+		{
+			return ((int)step < countSteps(q, skipSpace(q, 0), 0)) ? makeStepAt(q, stepAt(q, step), (int)step) : Step{0, 0, 0, 0, 0, 0};
+		}
+
+		// keyChar
+		// - byte i of the key text of all JREAD_QKEY steps from the step at p
+		//
+		static constexpr char keyChar(const char *q, size_t p, size_t i)
+		{
+			return (stepType(q, p) <= 0) ? '\0'
+				   : (i < keyLenAt(q, p)) ? q[skipSpace(q, p + 1) + 1 + i]
+				   : keyChar(q, nextStep(q, p), i - keyLenAt(q, p));
+		}
+	};
+
+	/**
+		 * @brief Set of queries read in one pass
+		 * 
+		 * Each field is a query string and a typed destination.
+		 * The queries are merged into a prefix tree, so a parent object
+		 * shared by several queries is read once, and getValues() stops
+		 * reading as soon as every field is found.
+		 * 
+		 * Queries with '*' parameters or wildcards ([*], {*}, [a:b]) are not supported.
+		 * 
+		 */
+	class Batch
+	{
+	public:
+		Batch();
+
+		/**
+			 * @brief Add field
+			 * 
+			 * Destination types and coercion are as for getValue(),
+			 * a ReadElement destination receives the element as from getElement()
+			 * 
+			 * @param pQuery Query string to match object, array and key
+			 * @param value Ref for return of JSON value
+			 * @return int Field number, or -1 if the batch is full or the query is bad
+			 */
+		int add(const char *pQuery, long &value);
+		int add(const char *pQuery, int &value);
+		int add(const char *pQuery, double &value);
+		int add(const char *pQuery, bool &value);
+		int add(const char *pQuery, char *pDest, int destlen);
+		int add(const char *pQuery, struct ReadElement &value);
+
+		/**
+			 * @brief Result of field from the last getValues()
+			 * 
+			 * @param field Field number returned by add()
+			 * @return ReadError JS_OK if the field was found and converted, else JS_ERROR
+			 */
+		ReadError result(int field) const;
+
+	private:
+		friend class Json;
+		enum FieldType
+		{
+			BATCH_LONG,
+			BATCH_INT,
+			BATCH_DOUBLE,
+			BATCH_BOOL,
+			BATCH_STRING,
+			BATCH_ELEMENT
+		};
+		struct Field
+		{
+			FieldType type; // destination type
+			void *pDest;	// destination
+			int destlen;	// length of string destination
+			int next;		// next field with the same query, -1 if none
+			ReadError result;
+		} fields[JREAD_BATCH_FIELDS];
+		struct Node
+		{
+			Query::Step step; // step from parent to this node
+			int parent;		  // parent node, -1 for root
+			int child;		  // first child, -1 if none
+			int sibling;	  // next child of parent, -1 if none
+			int field;		  // first field ending at this node, -1 if none
+			int fields;		  // number of fields in this subtree
+			int pending;	  // fields in this subtree not found yet
+			int visited;	  // 1= node was matched in this run
+		} nodes[JREAD_BATCH_NODES];
+		int fieldCount;
+		int nodeCount;
+		int keyBytes;
+		char keys[JREAD_BATCH_KEYS];
+		int pending; // fields not found yet
+
+		int addField(const char *pQuery, FieldType type, void *pDest, int destlen);
+		void found(int node, struct ReadElement *pElem);
+	};
+
+	/**
+		 * @brief Struct binding
+		 * 
+		 * Describes how the members of a struct map to the keys of a JSON
+		 * object, for decode() and add(binding, pStruct):
+		 * 
+		 *    struct Order { int id; double price; char item[32]; };
+		 *    static const BindField orderFields[] = {
+		 *        JSON_BIND(Order, id), JSON_BIND(Order, price), JSON_BIND_KEY(Order, item, "name")};
+		 *    static const Json::Binding orderBinding(orderFields);
+		 * 
+		 * The keys are placed in a table with a hash seed chosen so no two
+		 * keys share a slot, a key read is found with one hash and one compare.
+		 * 
+		 */
+	class Binding
+	{
+	public:
+		/**
+			 * @brief Make the binding of an array of fields
+			 * 
+			 * @param pFields Fields, not copied (keep them while the binding is used)
+			 * @param count Number of fields
+			 */
+		Binding(const BindField *pFields, int count);
+
+		template <size_t N>
+		Binding(const BindField (&fields)[N]) : Binding(fields, (int)N)
+		{
+		}
+
+		/**
+			 * @brief Error from making the binding
+			 * 
+			 * @return int 0 if the binding is usable, else error code: 12 Bad object key (same key twice),
+			 *         15 Bad query (more than JREAD_BIND_FIELDS fields, or no seed found)
+			 */
+		int getError() const;
+
+	private:
+		friend class Json;
+		const BindField *pFields;
+		int count;
+		unsigned int seed;						// hash seed, no two keys in one slot
+		unsigned int shift;						// 32 - log2(slots)
+		size_t keyLens[JREAD_BIND_FIELDS];		// length of each key
+		signed char slots[JREAD_BIND_SLOTS];	// field in each slot, -1 if none
+		int error;
+
+		int find(const char *pKey, size_t keyLen) const;
+	};
+
+	/**
+		 * @brief Handler of the events of parse()
+		 * 
+		 * parse() reads the document once, calling the handler for each
+		 * value in document order. Override the events wanted, the others
+		 * do nothing. Return false from an event to stop parse().
+		 * 
+		 * Strings and keys point into the JSON text and are not unescaped,
+		 * getValue(element, ...) converts string and number elements.
+		 * 
+		 */
+	class Handler
+	{
+	public:
+		virtual ~Handler() {}
+		virtual bool startObject() { return true; }
+		virtual bool endObject() { return true; }
+		virtual bool startArray() { return true; }
+		virtual bool endArray() { return true; }
+		virtual bool key(const char *pKey, size_t keyLen)
+		{
+			(void)pKey;
+			(void)keyLen;
+			return true;
+		}
+		virtual bool string(const struct ReadElement &element)
+		{
+			(void)element;
+			return true;
+		}
+		virtual bool number(const struct ReadElement &element)
+		{
+			(void)element;
+			return true;
+		}
+		virtual bool boolean(bool value)
+		{
+			(void)value;
+			return true;
+		}
+		virtual bool null() { return true; }
+	};
+
+	/**
+		 * @brief Cursor over the elements of an object or array
+		 * 
+		 * Keeps its position, so each call to next() reads one element
+		 * and iterating n elements reads the JSON once.
+		 * Can be used in range-for, the cursor itself is the loop variable:
+		 * 
+		 *   for (Json::Cursor &item : cursor)
+		 *       item.getElement("{'sku'", NULL, sku);
+		 * 
+		 */
+	class Cursor
+	{
+	public:
+		/**
+			 * @brief Create cursor
+			 * 
+			 * @param container Object or array element returned by getElement()
+			 */
+		Cursor(const struct ReadElement &container);
+
+		/**
+			 * @brief Move to the next element
+			 * 
+			 * @return true if there is a next element, false at end or error (see getError())
+			 */
+		bool next();
+
+		/**
+			 * @brief Move back before the first element
+			 * 
+			 */
+		void rewind();
+
+		/**
+			 * @brief Current element
+			 * 
+			 * @return const ReadElement& Current value
+			 */
+		const struct ReadElement &value() const;
+
+		/**
+			 * @brief Key of current element
+			 * 
+			 * @return const ReadElement& Current "key" (dataType JREAD_KEY), dataType is JREAD_ERROR for arrays
+			 */
+		const struct ReadElement &key() const;
+
+		/**
+			 * @brief Index of current element
+			 * 
+			 * @return int 0 for the first element
+			 */
+		int index() const;
+
+		/**
+			 * @brief Error code
+			 * 
+			 * @return int 0 while iterating, 13 End of array found or 14 End of object found at end, else JSON error
+			 */
+		int getError() const;
+
+		/**
+			 * @brief Get element relative to the current element
+			 * 
+			 * Query the current value as the root of pQuery
+			 * 
+			 * @param pQuery Query string to match object, array and key
+			 * @param queryParams Array of integers as index for each '*' in pQuery, may be NULL
+			 * @param pResult Return of element matching the query string
+			 * @return const char* Pointer into JSON after the queried value
+			 */
+		const char *getElement(const char *pQuery, int *queryParams, struct ReadElement &pResult) const;
+		const char *getElement(const Query &query, int *queryParams, struct ReadElement &pResult) const;
+
+		class Iterator
+		{
+		public:
+			Iterator(Cursor *pCursor);
+			Cursor &operator*() const;
+			Iterator &operator++();
+			bool operator!=(const Iterator &other) const;
+
+		private:
+			Cursor *pCursor; // NULL at end
+		};
+		Iterator begin();
+		Iterator end();
+
+	private:
+		friend class Json;
+		const char *pStart;		   // '{' or '[' of container
+		const char *pNext;		   // ',' or '{' '[' '}' ']' before next element
+		const ReadContext *pContext; // bounds and structural index, NULL if none
+		int isObject;			   // 1= iterating object members
+		int count;				   // index of current element, -1 before first
+		int error;				   // error code
+		struct ReadElement current; // current value
+		struct ReadElement member;  // current key
+	};
+
+	/**
+		 * @brief Value matched by getMatches()
+		 * 
+		 */
+	struct Match
+	{
+		struct ReadElement value;	 // matched value, as from getElement()
+		struct ReadElement key;		 // "key" of the member matched by the last {*} step (dataType JREAD_KEY), JREAD_ERROR if none
+		const unsigned int *pIndexes; // index of the element/member matched by each [*], {*} and [a:b] step, in query order
+	};
+
+	/**
+		 * @brief Match handler of getMatches()
+		 * 
+		 * match is valid during the call only, return false to stop getMatches()
+		 */
+	typedef bool (*MatchHandler)(const Match &match, void *pUser);
+
+private:
+	struct Matcher; // state of one getMatches()
+
 	// Variables:
 	char *buffer;		 // pointer to application's buffer
 	unsigned int buflen; // length of buffer
@@ -115,6 +855,16 @@ private:
 	} nodeStack[JWRITE_STACK_DEPTH]; // stack of array/object nodes
 	int stackpos;
 	int isPretty; // 1= pretty output (inserts \n and spaces)
+	ReadContext readContext; // end of buffer and structural index, see buildIndex()
+	struct QueryCache
+	{
+		CacheEntry *pEntries; // application storage, NULL if no cache
+		int size;			  // number of entries
+		int used;			  // entries holding a result
+		int next;			  // entry replaced by the next miss (round robin)
+		unsigned long hits;
+		unsigned long misses;
+	} queryCache; // query results, see useCache()
 	// private methods:
 
 	//-------------------------------------------------
@@ -137,7 +887,7 @@ private:
 		"* parameter" // 13
 	};
 
-	const char *jReadErrorStrings[15] = {
+	const char *jReadErrorStrings[20] = {
 		"Ok",										// 0
 		"JSON does not match Query",				// 1
 		"Error reading JSON value",					// 2
@@ -152,7 +902,12 @@ private:
 		"Object key not found (bad index)",			// 11
 		"Bad object key",							// 12
 		"End of array found",						// 13
-		"End of object found"						// 14
+		"End of object found",						// 14
+		"Bad query",								// 15
+		"Nesting > JREAD_STACK_DEPTH",				// 16
+		"Stopped by handler",						// 17
+		"Invalid UTF-8",							// 18
+		"Arena full"								// 19
 	};
 
 	/**
@@ -230,22 +985,80 @@ private:
 		 */
 	int _jwArr();
 
+	/**
+		 * @brief Invalidate read state
+		 * 
+		 * Called by every writer function that changes buffer,
+		 * drops the structural index and the cached query results
+		 * 
+		 */
+	void invalidate();
+
+	/**
+		 * @brief Query from the root of the JSON, through the query cache
+		 * 
+		 * @param pQuery Query string
+		 * @param queryParams Array of integers as index for each '*' in the query, may be NULL
+		 * @param pResult Return of element matching the query
+		 * @return const char* Pointer into JSON after the queried value
+		 */
+	const char *getRootElement(const char *pQuery, int *queryParams, struct ReadElement *pResult);
+
 	//------------------------------------------------------
 	// Internal Functions
 
-	static const char *skipWhitespace(const char *sp);
-	static const char *findTok(const char *sp, int *tokType);
-	static const char *getElementString(const char *pJson, struct ReadElement *pElem, char quote);
-	static int getElementStringLenght(const char *pJson);
-	static int equalElement(struct ReadElement *j1, struct ReadElement *j2);
-	static const char *getObjectLength(const char *pJson, struct ReadElement *pResult, int keyIndex);
-	static const char *getArrayLength(const char *pJson, struct ReadElement *pResult);
+	static const char *skipWhitespace(const char *sp, const char *pEnd = NULL);
+	static const char *findTok(const char *sp, int *tokType, const char *pEnd = NULL);
+	static const char *getElementString(const char *pJson, struct ReadElement *pElem, char quote, const char *pEnd = NULL);
+	static size_t getElementStringLenght(const char *pJson, const char *pEnd = NULL);
+	static const char *contextEnd(const ReadContext *pContext);
+	static unsigned int hashKey(const char *key, int keyLen);
+	static const char *findObjectKey(const char *pJson, const char *key, size_t keyLen, unsigned int hash, struct ReadElement *pResult, const ReadContext *pContext);
+	static const char *findArrayIndex(const char *pJson, unsigned int index, struct ReadElement *pResult, const ReadContext *pContext);
+	static const char *getObjectLength(const char *pJson, struct ReadElement *pResult, int keyIndex, const ReadContext *pContext);
+	static const char *skipValue(const char *pJson, const ReadContext *pContext);
+	static const char *getContainerLength(const char *pJson, struct ReadElement *pResult, const ReadContext *pContext);
+	static IndexEntry *findIndexEntry(const ReadContext *pContext, const char *pJson);
+	static const KeySlot *getKeyTable(const char *pJson, IndexEntry *pEntry, const ReadContext *pContext);
+	static const KeySlot *getElementTable(const char *pJson, IndexEntry *pEntry, const ReadContext *pContext);
 	static char *copyElementValue(char *destBuffer, int destLength, struct ReadElement *pElement);
+	static const char *getElement(const char *pJson, const char *pQuery, int *queryParams, struct ReadElement *pResult, const ReadContext *pContext, bool toEnd = true);
+	static const char *getElement(const char *pJson, const Query &query, int *queryParams, struct ReadElement *pResult, const ReadContext *pContext);
+	static const char *getBatchValue(const char *pJson, Batch &batch, int node, const ReadContext *pContext);
+	static int getValues(const char *pJson, Batch &batch, const ReadContext *pContext);
+	static int decode(const char *pJson, const char *pQuery, const Binding &binding, void *pStruct, const ReadContext *pContext);
+	static ReadError readField(struct ReadElement *pElem, const BindField &field, void *pStruct);
+	static const char *relativeRoot(const struct ReadElement &root, struct ReadElement *pResult);
+	static int readNumbers(const struct ReadElement *pArray, double *pValues, int maxValues, const ReadContext *pContext);
+	static int parse(const char *pJson, Handler &handler, const ReadContext *pContext);
+	static const char *skipRest(const char *pOpen, const char *pJson, const ReadContext *pContext);
+	static const char *matchValue(const char *pJson, int step, int wildcards, bool toEnd, Matcher &matcher, const ReadContext *pContext);
+	static int getMatches(const char *pJson, const Query &query, int *queryParams, MatchHandler handler, void *pUser, const ReadContext *pContext);
+	static ReadError readValue(struct ReadElement *pElem, long *value);
+	static ReadError readValue(struct ReadElement *pElem, int *value);
+	static ReadError readValue(struct ReadElement *pElem, long long *value);
+	static ReadError readValue(struct ReadElement *pElem, unsigned long *value);
+	static ReadError readValue(struct ReadElement *pElem, unsigned long long *value);
+	static ReadError readValue(struct ReadElement *pElem, double *value);
+	static ReadError readValue(struct ReadElement *pElem, bool *value);
+	static ReadError readValue(struct ReadElement *pElem, char *pDest, int destlen);
+	static ReadError readString(const struct ReadElement *pElem, char *pDest, size_t destLen, size_t *pLength);
 	//=======================================================
 
 public:
 	Json(char *pbuffer, int buf_len);
 
+	/**
+		 * @brief Read-only JSON object of a mapped file
+		 *
+		 * Queries read the file in place, bounded by its size (the mapping
+		 * is not '\0'-terminated). file must stay open while the object is used.
+		 * Writing is not possible, open() and add() report JWRITE_BUF_FULL
+		 *
+		 * @param file Mapped JSON file, see JsonFile::open()
+		 */
+	explicit Json(const JsonFile &file);
+
 	/**
 		 * @brief open writing of JSON
 		 * 
@@ -337,6 +1150,18 @@ public:
 		 */
 	void add(const char *key, bool oneOrZero);
 
+	/**
+		 * @brief Object struct insert function
+		 * 
+		 * Used to insert the members of a struct as "key":"value" pairs into an object,
+		 * in the order of the fields of the binding (see decode()).
+		 * Strings are written as by add(key, value), not escaped
+		 * 
+		 * @param binding Members and keys
+		 * @param pStruct Struct to write
+		 */
+	void add(const Binding &binding, const void *pStruct);
+
 	/**
 		 * @brief Array string insert functions
 		 * 
@@ -415,13 +1240,102 @@ public:
 	// The JSON reader functions
 	//------------------------------------------------------
 
+	/**
+		 * @brief Build structural index of the JSON in buffer
+		 * 
+		 * One pass over the JSON text recording the position of every
+		 * object/array, its matching close bracket and its element count.
+		 * Following getElement()/getValue() calls on this instance use the
+		 * index to skip unwanted objects/arrays with a single lookup
+		 * instead of re-reading them.
+		 * 
+		 * The index holds objects and arrays only: without useKeyTables() a key
+		 * or [n lookup still reads the keys (or elements) before it, skipping
+		 * their objects/arrays through the index. With key tables, objects and
+		 * arrays of JREAD_WIDE_OBJECT or more members are looked up directly.
+		 * 
+		 * The index assumes well formed JSON, it is dropped by any
+		 * writer call that changes the buffer
+		 * 
+		 * @param pEntries Application storage for the index, one entry per object/array
+		 * @param maxEntries Number of entries in pEntries
+		 * @return int Number of entries used, or -1 if pEntries is too small or the JSON is unbalanced (no index is used)
+		 */
+	int buildIndex(struct IndexEntry *pEntries, int maxEntries);
+
+	/**
+		 * @brief Stop using the structural index
+		 * 
+		 */
+	void clearIndex();
+
+	/**
+		 * @brief Use key tables for wide objects and arrays
+		 * 
+		 * With an index (see buildIndex()) objects of JREAD_WIDE_OBJECT or
+		 * more members get a hash table of their keys, built on the first
+		 * key lookup in the object. Following lookups in the object take one
+		 * hash and one compare, instead of reading the members before the key.
+		 * A table takes the smallest power of 2 >= 2 * members slots.
+		 * Arrays of JREAD_WIDE_OBJECT or more elements get a table of their
+		 * element offsets (one slot per element) on the first [n lookup, [n
+		 * then goes straight to element n.
+		 * Objects/arrays whose table does not fit in the slots left are read
+		 * as without tables. Tables are dropped with the index.
+		 * 
+		 * @param pSlots Application storage for key tables
+		 * @param maxSlots Number of slots in pSlots, 0 to stop using key tables
+		 */
+	void useKeyTables(struct KeySlot *pSlots, int maxSlots);
+
+	/**
+		 * @brief Cache query results
+		 * 
+		 * Following queries on this instance by query string (getElement(),
+		 * getValue(), getString(), getNumbers()) look up the query string and
+		 * its '*' parameters in the cache before reading the JSON, a miss
+		 * stores the result, replacing the entries round robin.
+		 * Queries longer than JREAD_CACHE_QUERY - 1 chars or with more than
+		 * JREAD_CACHE_PARAMS parameters are not cached (counted as misses).
+		 * 
+		 * The cached results are dropped by any writer call that changes the
+		 * buffer, call clearCache() after changing the buffer by other means
+		 * 
+		 * @param pEntries Application storage for the cache
+		 * @param maxEntries Number of entries in pEntries
+		 */
+	void useCache(struct CacheEntry *pEntries, int maxEntries);
+
+	/**
+		 * @brief Drop the cached query results
+		 * 
+		 * The cache stays in use, empty
+		 * 
+		 */
+	void clearCache();
+
+	/**
+		 * @brief Queries answered from the cache
+		 * 
+		 * @return unsigned long Hits since useCache()
+		 */
+	unsigned long getCacheHits() const;
+
+	/**
+		 * @brief Queries not answered from the cache
+		 * 
+		 * @return unsigned long Misses since useCache(), including queries that can not be cached
+		 */
+	unsigned long getCacheMisses() const;
+
 	/**
 		 * @brief Get the Element object
 		 * 
 		 * Traverses the JSON according to the pQuery string
 		 * matches pQuery against JSON and return match as an element struct
 		 * 
-		 * Note: is recursive
+		 * Nesting depth is not limited: skipped objects and arrays are passed by
+		 * bracket counting (jScanSkip()), error 16 is reported by parse(), validate() and JsonPush only
 		 * 
 		 * @param pQuery Query string to match object, array and key
 		 * @param pResult Return of element matching the query string
@@ -442,7 +1356,8 @@ public:
 		 * You can supply an array of integers which are indexed for each '*' in pQuery
 		 * however, horrid things will happen if you don't supply enough parameters
 		 * 
-		 * Note: is recursive
+		 * Nesting depth is not limited: skipped objects and arrays are passed by
+		 * bracket counting (jScanSkip()), error 16 is reported by parse(), validate() and JsonPush only
 		 * 
 		 * @param pQuery Query string to match object, array and key
 		 * @param queryParams Array of integers as index for each '*' in pQuery
@@ -459,7 +1374,8 @@ public:
 		 * Traverses the JSON according to the pQuery string
 		 * matches pQuery against JSON and return match as an element struct
 		 * 
-		 * Note: is recursive
+		 * Nesting depth is not limited: skipped objects and arrays are passed by
+		 * bracket counting (jScanSkip()), error 16 is reported by parse(), validate() and JsonPush only
 		 * 
 		 * @param pJson '\0'-terminated JSON text string to query
 		 * @param pQuery Query string to match object, array and key
@@ -483,7 +1399,8 @@ public:
 		 * You can supply an array of integers which are indexed for each '*' in pQuery
 		 * however, horrid things will happen if you don't supply enough parameters
 		 * 
-		 * Note: is recursive
+		 * Nesting depth is not limited: skipped objects and arrays are passed by
+		 * bracket counting (jScanSkip()), error 16 is reported by parse(), validate() and JsonPush only
 		 * 
 		 * @param pJson '\0'-terminated JSON text string to query
 		 * @param pQuery Query string to match object, array and key
@@ -493,6 +1410,50 @@ public:
 		 */
 	static const char *getElement(const char *pJson, const char *pQuery, int *queryParams, struct ReadElement *pResult);
 
+	/**
+		 * @brief Get the Element object
+		 * 
+		 * Same as getElement(const char *pQuery, int *queryParams, struct ReadElement &pResult)
+		 * for a compiled query
+		 * 
+		 * @param query Compiled query
+		 * @param queryParams Array of integers as index for each '*' in the query, may be NULL
+		 * @param pResult Return of element matching the query
+		 * @return const char* Pointer into JSON after the queried value
+		 */
+	const char *getElement(const Query &query, int *queryParams, struct ReadElement &pResult);
+
+	/**
+		 * @brief Get the Element object
+		 * 
+		 * Static implementation of getElement() for a compiled query
+		 * 
+		 * @param pJson '\0'-terminated JSON text string to query
+		 * @param query Compiled query
+		 * @param queryParams Array of integers as index for each '*' in the query, may be NULL
+		 * @param pResult Return of element matching the query
+		 * @return const char* Pointer into JSON after the queried value
+		 */
+	static const char *getElement(const char *pJson, const Query &query, int *queryParams, struct ReadElement *pResult);
+
+	/**
+		 * @brief Get the Element object relative to a returned element
+		 * 
+		 * Queries the object/array root (returned by an earlier getElement() on this
+		 * instance) as if it was the whole JSON, e.g. read "{'order'{'lines'[0" once
+		 * and then "{'sku'" and "{'qty'" inside it without reading the outer JSON again
+		 * 
+		 * If root is not an object or array pResult->error = 1 "JSON does not match Query"
+		 * 
+		 * @param root Object or array element to query
+		 * @param pQuery Query string (or compiled query) to match object, array and key
+		 * @param queryParams Array of integers as index for each '*' in the query, may be NULL
+		 * @param pResult Return of element matching the query
+		 * @return const char* Pointer into JSON after the queried value, NULL if root is not an object or array
+		 */
+	const char *getElement(const struct ReadElement &root, const char *pQuery, int *queryParams, struct ReadElement &pResult);
+	const char *getElement(const struct ReadElement &root, const Query &query, int *queryParams, struct ReadElement &pResult);
+
 	/**
 		 * @brief Get the Array Element object
 		 * 
@@ -506,6 +1467,17 @@ public:
 		 */
 	static const char *getArrayElement(const char *pJsonArray, struct ReadElement *pResult);
 
+	/**
+		 * @brief Get a Cursor over an object or array
+		 * 
+		 * Same as Cursor(container), the cursor uses the structural index
+		 * of this instance (if built) to skip values
+		 * 
+		 * @param container Object or array element returned by getElement()
+		 * @return Cursor Cursor before the first element
+		 */
+	Cursor iterate(const struct ReadElement &container) const;
+
 	//------------------------------------------------------
 	// "Helper" Functions
 	//------------------------------------------------------
@@ -519,6 +1491,7 @@ public:
 		 * Returns number from NUMBER or STRING elements (if possible)
 		 * Returns 1 or 0 from BOOL elements
 		 * Otherwise returns 0
+		 * Returns JS_ERROR if the number does not fit (value is not changed)
 		 *
 		 * @param pQuery Query string to match object, array and key
 		 * @param value Ref for return of JSON value
@@ -535,6 +1508,7 @@ public:
 		 * Returns number from NUMBER or STRING elements (if possible)
 		 * Returns 1 or 0 from BOOL elements
 		 * Otherwise returns 0
+		 * Returns JS_ERROR if the number does not fit (value is not changed)
 		 * 
 		 * Allows one or more queryParam integers to be substituted
 		 * for array or object indexes marked by a '*' in the query
@@ -561,6 +1535,7 @@ public:
 		 * Returns number from NUMBER or STRING elements (if possible)
 		 * Returns 1 or 0 from BOOL elements
 		 * Otherwise returns 0
+		 * Returns JS_ERROR if the number does not fit (value is not changed)
 		 * 
 		 * Allows one or more queryParam integers to be substituted
 		 * for array or object indexes marked by a '*' in the query
@@ -586,6 +1561,7 @@ public:
 		 * Returns number from NUMBER or STRING elements (if possible)
 		 * Returns 1 or 0 from BOOL elements
 		 * Otherwise returns 0
+		 * Returns JS_ERROR if the number does not fit (value is not changed)
 		 *
 		 * @param pQuery Query string to match object, array and key
 		 * @param value Ref for return of JSON value
@@ -602,6 +1578,7 @@ public:
 		 * Returns number from NUMBER or STRING elements (if possible)
 		 * Returns 1 or 0 from BOOL elements
 		 * Otherwise returns 0
+		 * Returns JS_ERROR if the number does not fit (value is not changed)
 		 * 
 		 * Allows one or more queryParam integers to be substituted
 		 * for array or object indexes marked by a '*' in the query
@@ -628,6 +1605,7 @@ public:
 		 * Returns number from NUMBER or STRING elements (if possible)
 		 * Returns 1 or 0 from BOOL elements
 		 * Otherwise returns 0
+		 * Returns JS_ERROR if the number does not fit (value is not changed)
 		 * 
 		 * Allows one or more queryParam integers to be substituted
 		 * for array or object indexes marked by a '*' in the query
@@ -644,6 +1622,31 @@ public:
 		 */
 	static ReadError getValue(const char *pJson, const char *pQuery, int *queryParams, int *value);
 
+	/**
+		 * @brief Get the Value object as 64 bit integer
+		 * 
+		 * Same as the getValue() functions for signed long, for int64_t/uint64_t
+		 * values like IDs and timestamps, digits are converted 8 at a time
+		 * 
+		 * Returns JS_ERROR if the number does not fit (value is not changed),
+		 * negative numbers do not fit the unsigned types
+		 *
+		 * @param pJson '\0'-terminated JSON text string to query
+		 * @param pQuery Query string to match object, array and key
+		 * @param queryParams Array of integers as index for each '*' in pQuery
+		 * @param value Ref/pointer for return of JSON value
+		 * @return ReadError Error code, JS_OK or JS_ERROR
+		 */
+	ReadError getValue(const char *pQuery, long long &value);
+	ReadError getValue(const char *pQuery, int *queryParams, long long &value);
+	static ReadError getValue(const char *pJson, const char *pQuery, int *queryParams, long long *value);
+	ReadError getValue(const char *pQuery, unsigned long &value);
+	ReadError getValue(const char *pQuery, int *queryParams, unsigned long &value);
+	static ReadError getValue(const char *pJson, const char *pQuery, int *queryParams, unsigned long *value);
+	ReadError getValue(const char *pQuery, unsigned long long &value);
+	ReadError getValue(const char *pQuery, int *queryParams, unsigned long long &value);
+	static ReadError getValue(const char *pJson, const char *pQuery, int *queryParams, unsigned long long *value);
+
 	/**
 		 * @brief Get the Value object as double
 		 * 
@@ -842,6 +1845,455 @@ public:
 		 */
 	static ReadError getValue(const char *pJson, const char *pQuery, int *queryParams, char *pDest, int destlen);
 
+	/**
+		 * @brief Get the Value object for a compiled query
+		 * 
+		 * Same as the getValue() functions taking a query string,
+		 * instance functions query buffer, static functions query pJson
+		 * 
+		 * @param pJson '\0'-terminated JSON text string to query
+		 * @param query Compiled query
+		 * @param queryParams Array of integers as index for each '*' in the query, may be NULL
+		 * @param value Ref/pointer for return of JSON value
+		 * @return ReadError Error code, JS_OK or JS_ERROR
+		 */
+	ReadError getValue(const Query &query, int *queryParams, long &value);
+	ReadError getValue(const Query &query, int *queryParams, int &value);
+	ReadError getValue(const Query &query, int *queryParams, long long &value);
+	ReadError getValue(const Query &query, int *queryParams, unsigned long &value);
+	ReadError getValue(const Query &query, int *queryParams, unsigned long long &value);
+	ReadError getValue(const Query &query, int *queryParams, double &value);
+	ReadError getValue(const Query &query, int *queryParams, bool &value);
+	ReadError getValue(const Query &query, int *queryParams, char *pDest, int destlen);
+	static ReadError getValue(const char *pJson, const Query &query, int *queryParams, long *value);
+	static ReadError getValue(const char *pJson, const Query &query, int *queryParams, int *value);
+	static ReadError getValue(const char *pJson, const Query &query, int *queryParams, long long *value);
+	static ReadError getValue(const char *pJson, const Query &query, int *queryParams, unsigned long *value);
+	static ReadError getValue(const char *pJson, const Query &query, int *queryParams, unsigned long long *value);
+	static ReadError getValue(const char *pJson, const Query &query, int *queryParams, double *value);
+	static ReadError getValue(const char *pJson, const Query &query, int *queryParams, bool *value);
+	static ReadError getValue(const char *pJson, const Query &query, int *queryParams, char *pDest, int destlen);
+
+	/**
+		 * @brief Get the Value object relative to a returned element
+		 * 
+		 * Same as the getValue() functions of this instance,
+		 * with root as the JSON to query, see getElement(root, ...)
+		 * 
+		 * @param root Object or array element to query
+		 * @param pQuery Query string (or compiled query) to match object, array and key
+		 * @param queryParams Array of integers as index for each '*' in the query, may be NULL
+		 * @param value Ref for return of JSON value
+		 * @return ReadError Error code, JS_OK or JS_ERROR
+		 */
+	ReadError getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, long &value);
+	ReadError getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, int &value);
+	ReadError getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, long long &value);
+	ReadError getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, unsigned long &value);
+	ReadError getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, unsigned long long &value);
+	ReadError getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, double &value);
+	ReadError getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, bool &value);
+	ReadError getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, char *pDest, int destlen);
+	ReadError getValue(const struct ReadElement &root, const Query &query, int *queryParams, long &value);
+	ReadError getValue(const struct ReadElement &root, const Query &query, int *queryParams, int &value);
+	ReadError getValue(const struct ReadElement &root, const Query &query, int *queryParams, long long &value);
+	ReadError getValue(const struct ReadElement &root, const Query &query, int *queryParams, unsigned long &value);
+	ReadError getValue(const struct ReadElement &root, const Query &query, int *queryParams, unsigned long long &value);
+	ReadError getValue(const struct ReadElement &root, const Query &query, int *queryParams, double &value);
+	ReadError getValue(const struct ReadElement &root, const Query &query, int *queryParams, bool &value);
+	ReadError getValue(const struct ReadElement &root, const Query &query, int *queryParams, char *pDest, int destlen);
+
+	/**
+		 * @brief Get the Element of length-bounded JSON text
+		 * 
+		 * Same as the static getElement() functions, pJson does not have to be
+		 * '\0'-terminated, no char at or after pJson + jsonLen is read
+		 * (e.g. one frame of a receive buffer or a memory mapped file)
+		 * 
+		 * @param pJson JSON text to query
+		 * @param jsonLen Length of JSON text
+		 * @param pQuery Query string (or compiled query) to match object, array and key
+		 * @param queryParams Array of integers as index for each '*' in the query, may be NULL
+		 * @param pResult Pointer for return of JSON element
+		 * @return const char* Pointer into pJson after the element, at most pJson + jsonLen
+		 */
+	static const char *getElement(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, struct ReadElement *pResult);
+	static const char *getElement(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, struct ReadElement *pResult);
+
+	/**
+		 * @brief Get the Value object of length-bounded JSON text
+		 * 
+		 * Same as the static getValue() functions, see getElement(pJson, jsonLen, ...)
+		 * 
+		 * @param pJson JSON text to query
+		 * @param jsonLen Length of JSON text
+		 * @param pQuery Query string (or compiled query) to match object, array and key
+		 * @param queryParams Array of integers as index for each '*' in the query, may be NULL
+		 * @param value Pointer for return of JSON value
+		 * @return ReadError Error code, JS_OK or JS_ERROR
+		 */
+	static ReadError getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, long *value);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, int *value);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, long long *value);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, unsigned long *value);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, unsigned long long *value);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, double *value);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, bool *value);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, char *pDest, int destlen);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, long *value);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, int *value);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, long long *value);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, unsigned long *value);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, unsigned long long *value);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, double *value);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, bool *value);
+	static ReadError getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, char *pDest, int destlen);
+
+	/**
+		 * @brief Get the Value of an element
+		 * 
+		 * Converts an element returned by a query (e.g. JsonLines results)
+		 * with the coercion of the getValue() functions
+		 * 
+		 * @param element Element to convert
+		 * @param value Ref for return of JSON value
+		 * @return ReadError Error code, JS_OK or JS_ERROR
+		 */
+	static ReadError getValue(const struct ReadElement &element, long &value);
+	static ReadError getValue(const struct ReadElement &element, int &value);
+	static ReadError getValue(const struct ReadElement &element, long long &value);
+	static ReadError getValue(const struct ReadElement &element, unsigned long &value);
+	static ReadError getValue(const struct ReadElement &element, unsigned long long &value);
+	static ReadError getValue(const struct ReadElement &element, double &value);
+	static ReadError getValue(const struct ReadElement &element, bool &value);
+	static ReadError getValue(const struct ReadElement &element, char *pDest, int destlen);
+
+	/**
+		 * @brief Get the Values of a Batch
+		 * 
+		 * Reads all fields of the batch in one pass over the JSON,
+		 * see Batch::result() for the result of each field
+		 * 
+		 * @param batch Fields to read
+		 * @return int Number of fields found
+		 */
+	int getValues(Batch &batch);
+
+	/**
+		 * @brief Get the Values of a Batch
+		 * 
+		 * Static implementation to quickly query JSON string without creating an JSON object
+		 * 
+		 * @param pJson '\0'-terminated JSON text string to query
+		 * @param batch Fields to read
+		 * @return int Number of fields found
+		 */
+	static int getValues(const char *pJson, Batch &batch);
+
+	/**
+		 * @brief Get the Values of a Batch from length-bounded JSON text
+		 * 
+		 * @param pJson JSON text to query, no char at or after pJson + jsonLen is read
+		 * @param jsonLen Length of JSON text
+		 * @param batch Fields to read
+		 * @return int Number of fields found
+		 */
+	static int getValues(const char *pJson, size_t jsonLen, Batch &batch);
+
+	/**
+		 * @brief Decode an object into a struct
+		 * 
+		 * One pass over the members of the object, each key is looked up in
+		 * the binding and its value converted into the member (as by
+		 * getValue(), strings as by getString()). Members of keys not in the
+		 * object, or with values that do not convert, are not changed,
+		 * values of keys not in the binding are skipped.
+		 * Keys are compared as they are in the JSON text (escapes are not decoded).
+		 * 
+		 * @param pQuery Query string to match the object, "" for the root
+		 * @param binding Members and keys
+		 * @param pStruct Struct to fill
+		 * @return int Number of members set, -1 if pQuery does not match an object
+		 */
+	int decode(const char *pQuery, const Binding &binding, void *pStruct);
+
+	/**
+		 * @brief Decode an object into a struct
+		 * 
+		 * Static implementation to quickly read JSON string without creating an JSON object
+		 * 
+		 * @param pJson '\0'-terminated JSON text string to read
+		 * @param pQuery Query string to match the object, "" for the root
+		 * @param binding Members and keys
+		 * @param pStruct Struct to fill
+		 * @return int Number of members set, -1 if pQuery does not match an object
+		 */
+	static int decode(const char *pJson, const char *pQuery, const Binding &binding, void *pStruct);
+
+	/**
+		 * @brief Decode an object of length-bounded JSON text into a struct
+		 * 
+		 * @param pJson JSON text to read, no char at or after pJson + jsonLen is read
+		 * @param jsonLen Length of JSON text
+		 * @param pQuery Query string to match the object, "" for the root
+		 * @param binding Members and keys
+		 * @param pStruct Struct to fill
+		 * @return int Number of members set, -1 if pQuery does not match an object
+		 */
+	static int decode(const char *pJson, size_t jsonLen, const char *pQuery, const Binding &binding, void *pStruct);
+
+	/**
+		 * @brief Get the numbers of an array
+		 * 
+		 * Reads the elements of the array matching pQuery into pValues in one pass,
+		 * elements are converted as by getValue(..., double &value)
+		 * 
+		 * @param pQuery Query string to match an array
+		 * @param queryParams Array of integers as index for each '*' in pQuery, may be NULL
+		 * @param pValues Returns the values
+		 * @param maxValues Size of pValues, following elements are not read
+		 * @return int Number of values read, -1 if pQuery does not match an array or the array is not valid JSON
+		 */
+	int getNumbers(const char *pQuery, int *queryParams, double *pValues, int maxValues);
+
+	/**
+		 * @brief Get the numbers of an array
+		 * 
+		 * Same as getNumbers() relative to root, see getElement(root, ...)
+		 * 
+		 * @param root Object or array element to query
+		 * @param pQuery Query string to match an array
+		 * @param queryParams Array of integers as index for each '*' in pQuery, may be NULL
+		 * @param pValues Returns the values
+		 * @param maxValues Size of pValues, following elements are not read
+		 * @return int Number of values read, -1 if pQuery does not match an array or the array is not valid JSON
+		 */
+	int getNumbers(const struct ReadElement &root, const char *pQuery, int *queryParams, double *pValues, int maxValues);
+
+	/**
+		 * @brief Get the numbers of an array
+		 * 
+		 * Static implementation to quickly query JSON string without creating an JSON object
+		 * 
+		 * @param pJson '\0'-terminated JSON text string to query
+		 * @param pQuery Query string to match an array
+		 * @param queryParams Array of integers as index for each '*' in pQuery, may be NULL
+		 * @param pValues Returns the values
+		 * @param maxValues Size of pValues, following elements are not read
+		 * @return int Number of values read, -1 if pQuery does not match an array or the array is not valid JSON
+		 */
+	static int getNumbers(const char *pJson, const char *pQuery, int *queryParams, double *pValues, int maxValues);
+
+	/**
+		 * @brief Get the numbers of an array in length-bounded JSON text
+		 * 
+		 * @param pJson JSON text to query, no char at or after pJson + jsonLen is read
+		 * @param jsonLen Length of JSON text
+		 * @param pQuery Query string to match an array
+		 * @param queryParams Array of integers as index for each '*' in pQuery, may be NULL
+		 * @param pValues Returns the values
+		 * @param maxValues Size of pValues, following elements are not read
+		 * @return int Number of values read, -1 if pQuery does not match an array or the array is not valid JSON
+		 */
+	static int getNumbers(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, double *pValues, int maxValues);
+
+	/**
+		 * @brief Get the decoded Value of a string
+		 * 
+		 * Copies a string to pDest decoding its escapes in one pass,
+		 * "\uXXXX" (and surrogate pairs) is written as UTF-8, a lone surrogate as U+FFFD.
+		 * Runs without '\\' are copied whole, a string without escapes is a plain copy.
+		 * Other elements are copied as by getValue(..., char *pDest, int destlen)
+		 * 
+		 * pDest is '\0'-terminated, at most destLen - 1 chars are written
+		 * (an escape is written whole or not at all)
+		 * 
+		 * @param pQuery Query string to match object, array and key
+		 * @param queryParams Array of integers as index for each '*' in pQuery, may be NULL
+		 * @param pDest Pointer for return of the decoded string
+		 * @param destLen Size of pDest
+		 * @param pLength Returns the decoded length (also when more than destLen - 1, the string is then cut), may be NULL
+		 * @return ReadError Error code, JS_OK or JS_ERROR (not found or bad escape)
+		 */
+	ReadError getString(const char *pQuery, int *queryParams, char *pDest, size_t destLen, size_t *pLength);
+
+	/**
+		 * @brief Get the decoded Value of a string
+		 * 
+		 * Same as getString(pQuery, ...) with a compiled query
+		 * 
+		 * @param query Compiled query
+		 * @param queryParams Array of integers as index for each '*' in query, may be NULL
+		 * @param pDest Pointer for return of the decoded string
+		 * @param destLen Size of pDest
+		 * @param pLength Returns the decoded length, may be NULL
+		 * @return ReadError Error code, JS_OK or JS_ERROR
+		 */
+	ReadError getString(const Query &query, int *queryParams, char *pDest, size_t destLen, size_t *pLength);
+
+	/**
+		 * @brief Get the decoded Value of a string
+		 * 
+		 * Static implementation to quickly query JSON string without creating an JSON object
+		 * 
+		 * @param pJson '\0'-terminated JSON text string to query
+		 * @param pQuery Query string to match object, array and key
+		 * @param queryParams Array of integers as index for each '*' in pQuery, may be NULL
+		 * @param pDest Pointer for return of the decoded string
+		 * @param destLen Size of pDest
+		 * @param pLength Returns the decoded length, may be NULL
+		 * @return ReadError Error code, JS_OK or JS_ERROR
+		 */
+	static ReadError getString(const char *pJson, const char *pQuery, int *queryParams, char *pDest, size_t destLen, size_t *pLength);
+
+	/**
+		 * @brief Get the decoded Value of a string in length-bounded JSON text
+		 * 
+		 * @param pJson JSON text to query, no char at or after pJson + jsonLen is read
+		 * @param jsonLen Length of JSON text
+		 * @param pQuery Query string to match object, array and key
+		 * @param queryParams Array of integers as index for each '*' in pQuery, may be NULL
+		 * @param pDest Pointer for return of the decoded string
+		 * @param destLen Size of pDest
+		 * @param pLength Returns the decoded length, may be NULL
+		 * @return ReadError Error code, JS_OK or JS_ERROR
+		 */
+	static ReadError getString(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, char *pDest, size_t destLen, size_t *pLength);
+
+	/**
+		 * @brief Get the decoded Value of a string element
+		 * 
+		 * @param element Element returned by a query (e.g. JsonLines results or a Handler event)
+		 * @param pDest Pointer for return of the decoded string
+		 * @param destLen Size of pDest
+		 * @param pLength Returns the decoded length, may be NULL
+		 * @return ReadError Error code, JS_OK or JS_ERROR
+		 */
+	static ReadError getString(const struct ReadElement &element, char *pDest, size_t destLen, size_t *pLength);
+
+	/**
+		 * @brief Parse the JSON with a handler
+		 * 
+		 * One pass over the document calling handler for every value,
+		 * nothing is allocated
+		 * 
+		 * @param handler Events of the values read
+		 * @return int 0 if the document was read, else error code (see jReadErrorToString()), 17 if stopped by handler
+		 */
+	int parse(Handler &handler);
+
+	/**
+		 * @brief Parse the JSON with a handler
+		 * 
+		 * Static implementation to quickly read JSON string without creating an JSON object
+		 * 
+		 * @param pJson '\0'-terminated JSON text string to read
+		 * @param handler Events of the values read
+		 * @return int 0 if the document was read, else error code (see jReadErrorToString()), 17 if stopped by handler
+		 */
+	static int parse(const char *pJson, Handler &handler);
+
+	/**
+		 * @brief Parse length-bounded JSON text with a handler
+		 * 
+		 * @param pJson JSON text to read, no char at or after pJson + jsonLen is read
+		 * @param jsonLen Length of JSON text
+		 * @param handler Events of the values read
+		 * @return int 0 if the document was read, else error code (see jReadErrorToString()), 17 if stopped by handler
+		 */
+	static int parse(const char *pJson, size_t jsonLen, Handler &handler);
+
+	/**
+		 * @brief Get all values matching a wildcard or slice query
+		 * 
+		 * Besides key and index steps the query may have steps matching many values:
+		 * 
+		 *    [*]    every element of an array
+		 *    {*}    every member of an object
+		 *    [a:b]  elements a to b - 1, a or b may be left out ("[2:]", "[:10]")
+		 * 
+		 * The JSON is read once, each value matched is passed to handler in document order:
+		 * 
+		 *    static bool onPrice(const Json::Match &match, void *pUser)
+		 *    {
+		 *        double price;
+		 *        if (Json::getValue(match.value, price) == ReadError::JS_OK)
+		 *            *(double *)pUser += price;
+		 *        return true;
+		 *    }
+		 * 
+		 *    jw.getMatches("{'items'[*]{'price'", NULL, onPrice, &total);
+		 * 
+		 * Members and elements without the steps that follow (e.g. an item
+		 * without "price") are not matched, a key matches the first member with the key.
+		 * '*' parameters are supplied by queryParams as for getElement().
+		 * 
+		 * @param query Query, compiled or a query string
+		 * @param queryParams Array of integers as index for each '*' in the query, may be NULL
+		 * @param handler Called for each value matched
+		 * @param pUser Passed to handler
+		 * @return int Number of values matched, -1 if the query is bad or the JSON is not valid where read
+		 */
+	int getMatches(const Query &query, int *queryParams, MatchHandler handler, void *pUser);
+
+	/**
+		 * @brief Get all values matching a wildcard or slice query
+		 * 
+		 * Same as getMatches(query, queryParams, handler, pUser), the first
+		 * maxResults values matched are stored, reading stops when pResults is full
+		 * 
+		 * @param query Query, compiled or a query string
+		 * @param queryParams Array of integers as index for each '*' in the query, may be NULL
+		 * @param pResults Returns the values matched
+		 * @param maxResults Size of pResults
+		 * @return int Number of values stored, -1 if the query is bad or the JSON is not valid where read
+		 */
+	int getMatches(const Query &query, int *queryParams, struct ReadElement *pResults, int maxResults);
+
+	/**
+		 * @brief Get all values matching a wildcard or slice query
+		 * 
+		 * Static implementation to quickly query JSON string without creating an JSON object
+		 * 
+		 * @param pJson '\0'-terminated JSON text string to query
+		 * @param query Query, compiled or a query string
+		 * @param queryParams Array of integers as index for each '*' in the query, may be NULL
+		 * @param handler Called for each value matched
+		 * @param pUser Passed to handler
+		 * @return int Number of values matched, -1 if the query is bad or the JSON is not valid where read
+		 */
+	static int getMatches(const char *pJson, const Query &query, int *queryParams, MatchHandler handler, void *pUser);
+	static int getMatches(const char *pJson, const Query &query, int *queryParams, struct ReadElement *pResults, int maxResults);
+
+	/**
+		 * @brief Get all values matching a wildcard or slice query in length-bounded JSON text
+		 * 
+		 * @param pJson JSON text to query, no char at or after pJson + jsonLen is read
+		 * @param jsonLen Length of JSON text
+		 * @param query Query, compiled or a query string
+		 * @param queryParams Array of integers as index for each '*' in the query, may be NULL
+		 * @param handler Called for each value matched
+		 * @param pUser Passed to handler
+		 * @return int Number of values matched, -1 if the query is bad or the JSON is not valid where read
+		 */
+	static int getMatches(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, MatchHandler handler, void *pUser);
+	static int getMatches(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, struct ReadElement *pResults, int maxResults);
+
+	/**
+		 * @brief Validate JSON text
+		 * 
+		 * Checks the text is one JSON value (RFC 8259) with valid UTF-8 in
+		 * its strings, in one pass and without allocating. The reader
+		 * itself accepts malformed text, validate untrusted text before
+		 * running queries on it.
+		 * 
+		 * @param pJson JSON text, no char at or after pJson + jsonLen is read
+		 * @param jsonLen Length of JSON text
+		 * @param pOffset Returns the offset of the first char in error, jsonLen if valid or the text ends early, may be NULL
+		 * @return int 0 if the text is valid, else error code (see jReadErrorToString()), 18 if a string is not UTF-8
+		 */
+	static int validate(const char *pJson, size_t jsonLen, size_t *pOffset);
+
 	//------------------------------------------------------
 	// Optional String output Functions
 	//
@@ -849,3 +2301,17 @@ public:
 	const char *jReadErrorToString(int error);   // string descibes error code
 };
 } // namespace jonaskgandersson
+
+//------------------------------------------------------
+// JSON_QUERY
+// - query literal compiled by the compiler, see Json::Query::literal()
+// - the query is a constexpr static, so it is never parsed at run time
+//   and a bad query does not compile
+//
+#define JSON_QUERY(literalText)                                                                       \
+	([]() -> const jonaskgandersson::Json::Query & {                                                   \
+		static constexpr jonaskgandersson::Json::Query query = jonaskgandersson::Json::Query::literal(literalText); \
+		return query;                                                                                 \
+	}())
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * @brief jsonScan.hpp
+ * Block scanning kernels used by the JSON reader
+ *
+ * The JSON text is classified 64 bytes at a time into bitmasks
+ * (bit n = byte n of the block). The kernel is picked at runtime
+ * from the instruction sets supported by the CPU:
+ * AVX-512BW, AVX2, SSE4.2 or a portable scalar fallback.
+ *
+ * *NOTES*
+ *    blocks are read at 64 byte aligned addresses, an aligned block never
+ *    crosses a page so reading past a '\0' terminator or pEnd can not fault.
+ *    Bytes past the terminator are ignored by the callers.
+ *
+ */
+
+#ifndef JSONSCAN_HPP
+#define JSONSCAN_HPP
+
+#include <stddef.h>
+
+#define JSCAN_BLOCK 64 // bytes classified per block
+
+// Kernel levels for jScanSelect()
+#define JSCAN_SCALAR 0
+#define JSCAN_SSE42 1
+#define JSCAN_AVX2 2
+#define JSCAN_AVX512 3
+
+namespace jonaskgandersson
+{
+//------------------------------------------------------
+// ScanBlock
+// - classification of one 64 byte block
+//
+struct ScanBlock
+{
+	unsigned long long whitespace; // control chars and ' ' (as skipped by the reader), not '\0'
+	unsigned long long quote;	  // '"'
+	unsigned long long backslash;  // '\\'
+	unsigned long long structural; // '{' '}' '[' ']' ':' ','
+	unsigned long long open;	   // '{' '['
+	unsigned long long close;	   // '}' ']'
+	unsigned long long eol;		   // '\0'
+};
+
+/**
+	 * @brief Classify one block
+	 *
+	 * @param pBlock 64 byte aligned pointer into JSON text
+	 * @param pScan Returns the bitmasks of the block
+	 */
+void jScanBlock(const char *pBlock, struct ScanBlock *pScan);
+
+/**
+	 * @brief Skip whitespace
+	 *
+	 * @param sp Pointer into '\0'-terminated JSON text
+	 * @param pEnd End of JSON text, NULL if '\0'-terminated only
+	 * @return const char* Pointer to first char that is not whitespace (may be the '\0' or pEnd)
+	 */
+const char *jScanWhitespace(const char *sp, const char *pEnd);
+
+/**
+	 * @brief Find end of string
+	 *
+	 * Finds the closing '"' of a JSON string, '"' preceded by an odd
+	 * number of '\\' are escaped and skipped.
+	 *
+	 * @param sp Pointer to first char after the opening '"'
+	 * @param pEnd End of JSON text, NULL if '\0'-terminated only
+	 * @return const char* Pointer to the closing '"', or to the '\0' or pEnd if the string is not terminated
+	 */
+const char *jScanString(const char *sp, const char *pEnd);
+
+/**
+	 * @brief Skip an object or array
+	 *
+	 * Finds the '}' or ']' closing an object or array by counting
+	 * brackets outside strings, nothing else is checked ('{' may be
+	 * closed by ']').
+	 *
+	 * @param sp Pointer to first char after the opening '{' or '['
+	 * @param pEnd End of JSON text, NULL if '\0'-terminated only
+	 * @return const char* Pointer to the closing '}' or ']', or to the '\0' or pEnd if the object/array is not closed
+	 */
+const char *jScanSkip(const char *sp, const char *pEnd);
+
+/**
+	 * @brief Find the separators of an object or array
+	 *
+	 * Finds the ',' between the members of an object or the elements of
+	 * an array (not those in strings or nested objects/arrays) and the
+	 * '}' or ']' closing it, brackets are counted as by jScanSkip().
+	 *
+	 * @param sp Pointer to first char after the opening '{' or '[', or after a ',' found
+	 * @param pEnd End of JSON text, NULL if '\0'-terminated only
+	 * @param pSeparators Returns pointers to the ',' found, in text order
+	 * @param maxSeparators Size of pSeparators
+	 * @param pCount Returns the number of ',' found
+	 * @return const char* Pointer to the closing '}' or ']' (or to the '\0' or pEnd if not closed),
+	 *         NULL if maxSeparators ',' were found first, call again from after the last one
+	 */
+const char *jScanSeparators(const char *sp, const char *pEnd, const char **pSeparators, size_t maxSeparators, size_t *pCount);
+
+/**
+	 * @brief Unescape a JSON string
+	 *
+	 * Copies the string text to pDest decoding escapes, "\\uXXXX" (and
+	 * surrogate pairs) is written as UTF-8, a lone surrogate as U+FFFD.
+	 * At most destLen - 1 chars are written (an escape whole or not at all)
+	 * and pDest is '\0'-terminated.
+	 *
+	 * @param sp String text, after the opening '"'
+	 * @param length Length of the string text, up to the closing '"'
+	 * @param pDest Destination
+	 * @param destLen Size of pDest
+	 * @return long long Decoded length (also when more than destLen - 1), -1 if an escape is bad
+	 */
+long long jScanUnescape(const char *sp, size_t length, char *pDest, size_t destLen);
+
+/**
+	 * @brief Check a JSON string
+	 *
+	 * Finds the closing '"' of a JSON string checking its text on the
+	 * way: no control chars, escapes as in JSON and valid UTF-8 (no
+	 * overlong forms, no surrogates, nothing above U+10FFFF).
+	 *
+	 * @param sp Pointer to first char after the opening '"'
+	 * @param pEnd End of JSON text, no char at or after pEnd is read
+	 * @return const char* Pointer to the closing '"', to the first char in error
+	 *         (the first byte of a bad UTF-8 sequence or the '\\' of a bad escape)
+	 *         or pEnd if the string is not terminated
+	 */
+const char *jScanCheckString(const char *sp, const char *pEnd);
+
+/**
+	 * @brief Select scanning kernel
+	 *
+	 * By default the best kernel supported by the CPU is used,
+	 * use this to force a lower level (e.g. for benchmarking).
+	 * Thread safe, scans running during the call finish with the kernel they started with
+	 *
+	 * @param level One of JSCAN_..., higher than supported selects the best supported
+	 * @return int The level selected
+	 */
+int jScanSelect(int level);
+
+/**
+	 * @brief Name of the kernel in use
+	 *
+	 * @return const char* "scalar", "sse4.2", "avx2" or "avx512bw"
+	 */
+const char *jScanKernelName();
+
+} // namespace jonaskgandersson
+
+#endif
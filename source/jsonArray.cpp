@@ -0,0 +1,371 @@
+/**
+ * @brief jsonArray.cpp
+ *
+ * Parallel reader for a large top-level JSON array
+ *
+ */
+
+#include "../jsonArray.hpp"
+#include "../jsonFile.hpp"
+#include "../jsonScan.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace jonaskgandersson;
+
+//------------------------------------------------------
+// Element
+// - boundaries of an element, found before the workers start
+//
+struct JsonArray::Element
+{
+	size_t offset; // offset of the element in the text read
+	size_t length; // length of element text
+};
+
+//------------------------------------------------------
+// Queue
+// - batches [begin, end) owned by a worker, the owner takes them from
+//   begin, other workers steal them from end
+//
+struct JsonArray::Queue
+{
+	size_t begin;
+	size_t end;
+	std::mutex lock; // begin and end
+
+	Queue() : begin(0), end(0), lock() {}
+};
+
+//------------------------------------------------------
+// Batch
+// - results of a batch, kept until the batches before it are delivered
+//
+struct JsonArray::Batch
+{
+	std::vector<struct ReadElement> results; // queries.size() per element
+	bool done;
+
+	Batch() : results(), done(false) {}
+};
+
+//------------------------------------------------------
+// Reader
+// - state of one read() shared by the workers
+// - batch n covers elements n * JARRAY_BATCH to (n + 1) * JARRAY_BATCH - 1,
+//   each worker starts with an equal run of batches
+//
+struct JsonArray::Reader
+{
+	const char *pJson;
+	std::vector<Element> elements;
+	Handler handler;
+	void *pUser;
+	int order;
+	size_t batches;
+	std::vector<Queue> queues;	// one per worker
+	std::vector<Batch> pending; // JARRAY_ORDERED, batches read
+	size_t nextDelivery;		// JARRAY_ORDERED, next batch to deliver
+	bool delivering;			// JARRAY_ORDERED, a worker is calling the handler
+	std::mutex lock;			// pending, nextDelivery and delivering
+
+	Reader(int threads) : pJson(NULL), elements(), handler(NULL), pUser(NULL), order(JARRAY_UNORDERED), batches(0),
+						  queues(threads), pending(), nextDelivery(0), delivering(false), lock() {}
+
+private:
+	Reader(const Reader &);			   // not copyable, shared by the workers
+	Reader &operator=(const Reader &); // not copyable
+};
+
+//------------------------------------------------------
+// Pool
+// - workers 1 .. threads - 1 kept between reads, worker 0 is the
+//   thread calling read()
+// - read() publishes its Reader and bumps generation, each worker reads
+//   batches once per generation (if the read uses it) and counts busy down
+//
+struct JsonArray::Pool
+{
+	std::vector<std::thread> workers; // worker n is workers[n - 1]
+	Reader *pReader;				  // read() in progress
+	unsigned long generation;		  // reads started
+	int busy;						  // workers still reading batches of *pReader
+	bool stop;						  // ~JsonArray(), workers exit
+	std::mutex lock;				  // all of the above
+	std::condition_variable start;	  // generation or stop changed
+	std::condition_variable done;	  // busy reached 0
+
+	Pool() : workers(), pReader(NULL), generation(0), busy(0), stop(false), lock(), start(), done() {}
+
+private:
+	Pool(const Pool &);			   // not copyable, shared by the workers
+	Pool &operator=(const Pool &); // not copyable
+};
+
+JsonArray::JsonArray() : queries(), threads(0), error(0), pPool(new Pool)
+{
+}
+
+JsonArray::~JsonArray()
+{
+	{
+		std::lock_guard<std::mutex> guard(pPool->lock);
+		pPool->stop = true;
+	}
+	pPool->start.notify_all();
+	for (size_t i = 0; i < pPool->workers.size(); i++)
+		pPool->workers[i].join();
+	delete pPool;
+}
+
+int JsonArray::addQuery(const char *pQuery)
+{
+	Json::Query query(pQuery);
+	if (query.getError() != 0)
+		return -1;
+	queries.push_back(query);
+	return (int)queries.size() - 1;
+}
+
+int JsonArray::getThreads() const
+{
+	return threads;
+}
+
+int JsonArray::getError() const
+{
+	return error;
+}
+
+// findElements
+// - the ',' between elements and the closing ']' are found in one pass
+//   with jScanSeparators(), a batch of separators at a time
+// - an element is the text between separators less the whitespace
+//   around it, as skipped by the reader (any char <= ' ')
+//
+int JsonArray::findElements(const char *pJson, size_t length, std::vector<Element> &elements)
+{
+	const char *separators[JARRAY_BATCH + 1];
+	const char *pEnd = pJson + length;
+	const char *sp = jScanWhitespace(pJson, pEnd);
+	const char *pClose, *pStart, *pElementEnd;
+	Element element;
+	size_t count, i;
+
+	if ((sp == pEnd) || (*sp != '['))
+		return 8; // Unexpected character, not an array
+	sp++;
+	do
+	{
+		pClose = jScanSeparators(sp, pEnd, separators, JARRAY_BATCH, &count);
+		if (pClose != NULL)
+		{
+			if ((pClose == pEnd) || (*pClose != ']'))
+				return 2; // array not closed
+			separators[count++] = pClose; // end of the last element
+		}
+		for (i = 0; i < count; i++)
+		{
+			pStart = jScanWhitespace(sp, separators[i]);
+			pElementEnd = separators[i];
+			while ((pElementEnd > pStart) && (pElementEnd[-1] <= ' '))
+				pElementEnd--;
+			sp = separators[i] + 1;
+			if (pElementEnd == pStart)
+				return ((pClose != NULL) && (i + 1 == count) && elements.empty()) ? 0 : 2; // "[]" or no element
+			element.offset = pStart - pJson;
+			element.length = pElementEnd - pStart;
+			elements.push_back(element);
+		}
+	} while (pClose == NULL);
+	return 0;
+}
+
+// takeBatch
+// - a worker takes the first batch of its own queue
+// - when its queue is empty it steals the last half of the first queue
+//   with batches left (looking from the next worker on), takes the first
+//   of them and keeps the rest in its own queue
+// - returns false when no queue has batches left, no batches are added
+//   after read() starts so the worker is done
+//
+bool JsonArray::takeBatch(Reader &reader, int worker, size_t *pBatch) const
+{
+	Queue &own = reader.queues[worker];
+	size_t threads = reader.queues.size();
+	size_t i, begin, end;
+
+	{
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (own.begin != own.end)
+		{
+			*pBatch = own.begin++;
+			return true;
+		}
+	}
+	for (i = 1; i < threads; i++)
+	{
+		Queue &victim = reader.queues[(worker + i) % threads];
+		{
+			std::lock_guard<std::mutex> guard(victim.lock);
+			if (victim.begin == victim.end)
+				continue;
+			end = victim.end;
+			begin = end - (end - victim.begin + 1) / 2; // half, at least one
+			victim.end = begin;
+		}
+		std::lock_guard<std::mutex> guard(own.lock);
+		own.begin = begin + 1;
+		own.end = end;
+		*pBatch = begin;
+		return true;
+	}
+	return false;
+}
+
+// readBatches
+// - run by each worker, takes batches 'til all are taken
+// - JARRAY_ORDERED: results are kept in pending[batch], the worker that
+//   completes the next batch to deliver delivers it and any completed
+//   batches after it
+//
+void JsonArray::readBatches(Reader &reader, int worker) const
+{
+	size_t nQueries = queries.size();
+	std::vector<struct ReadElement> results;
+	size_t batch, first, last, i, q;
+	Record record;
+
+	record.worker = worker;
+	while (takeBatch(reader, worker, &batch))
+	{
+		first = batch * JARRAY_BATCH;
+		last = first + JARRAY_BATCH;
+		if (last > reader.elements.size())
+			last = reader.elements.size();
+		results.resize((last - first) * nQueries);
+		for (i = first; i < last; i++)
+		{
+			record.pElement = reader.pJson + reader.elements[i].offset;
+			record.length = reader.elements[i].length;
+			record.index = i;
+			record.pResults = results.data() + (i - first) * nQueries;
+			for (q = 0; q < nQueries; q++)
+				Json::getElement(record.pElement, record.length, queries[q], NULL, &results[(i - first) * nQueries + q]);
+			if (reader.order == JARRAY_UNORDERED)
+				reader.handler(record, reader.pUser);
+		}
+		if (reader.order == JARRAY_UNORDERED)
+			continue;
+
+		std::unique_lock<std::mutex> guard(reader.lock);
+		reader.pending[batch].results.swap(results);
+		reader.pending[batch].done = true;
+		if (reader.delivering)
+			continue; // the delivering worker picks this batch up
+		reader.delivering = true;
+		while ((reader.nextDelivery < reader.batches) && reader.pending[reader.nextDelivery].done)
+		{
+			Batch ready;
+			ready.results.swap(reader.pending[reader.nextDelivery].results);
+			first = reader.nextDelivery * JARRAY_BATCH;
+			last = first + JARRAY_BATCH;
+			if (last > reader.elements.size())
+				last = reader.elements.size();
+			reader.nextDelivery++;
+			guard.unlock(); // other workers store batches while this one delivers
+			for (i = first; i < last; i++)
+			{
+				record.pElement = reader.pJson + reader.elements[i].offset;
+				record.length = reader.elements[i].length;
+				record.index = i;
+				record.pResults = ready.results.data() + (i - first) * nQueries;
+				reader.handler(record, reader.pUser);
+			}
+			guard.lock();
+		}
+		reader.delivering = false;
+	}
+}
+
+// work
+// - run by pool worker 'worker' 'til ~JsonArray(), waits for each read()
+//   and reads its batches, a read() with fewer threads leaves it idle
+// - workers a read() uses count busy down before it returns, others may
+//   wake after it did (pReader NULL) and wait for the next
+//
+void JsonArray::work(int worker) const
+{
+	std::unique_lock<std::mutex> guard(pPool->lock);
+	unsigned long seen = 0;
+	Reader *pReader;
+
+	while (1)
+	{
+		while (!pPool->stop && (pPool->generation == seen))
+			pPool->start.wait(guard);
+		if (pPool->stop)
+			return;
+		seen = pPool->generation;
+		pReader = pPool->pReader;
+		if ((pReader == NULL) || (worker >= (int)pReader->queues.size()))
+			continue; // not used by this read(), or woken after it returned
+		guard.unlock();
+		readBatches(*pReader, worker);
+		guard.lock();
+		if (--pPool->busy == 0)
+			pPool->done.notify_one();
+	}
+}
+
+// read
+// - workers missing for this many threads are started and kept in the pool
+//
+size_t JsonArray::read(const char *pJson, size_t length, Handler handler, void *pUser, int order, int threads)
+{
+	int i;
+
+	if (threads <= 0)
+		threads = (int)std::thread::hardware_concurrency();
+	if (threads <= 0)
+		threads = 1;
+	this->threads = threads;
+
+	Reader reader(threads);
+	error = findElements(pJson, length, reader.elements);
+	if (error != 0)
+		return 0;
+	reader.pJson = pJson;
+	reader.handler = handler;
+	reader.pUser = pUser;
+	reader.order = order;
+	reader.batches = (reader.elements.size() + JARRAY_BATCH - 1) / JARRAY_BATCH;
+	for (i = 0; i < threads; i++)
+	{
+		reader.queues[i].begin = reader.batches * i / threads;
+		reader.queues[i].end = reader.batches * (i + 1) / threads;
+	}
+	if (order == JARRAY_ORDERED)
+		reader.pending.resize(reader.batches);
+	for (i = (int)pPool->workers.size() + 1; i < threads; i++)
+		pPool->workers.push_back(std::thread(&JsonArray::work, this, i));
+	{
+		std::lock_guard<std::mutex> guard(pPool->lock);
+		pPool->pReader = &reader;
+		pPool->busy = threads - 1;
+		pPool->generation++;
+	}
+	pPool->start.notify_all();
+	readBatches(reader, 0); // the calling thread is worker 0
+	std::unique_lock<std::mutex> guard(pPool->lock);
+	while (pPool->busy != 0)
+		pPool->done.wait(guard);
+	pPool->pReader = NULL;
+	return reader.elements.size();
+}
+
+size_t JsonArray::read(const JsonFile &file, Handler handler, void *pUser, int order, int threads)
+{
+	return read(file.data(), file.size(), handler, pUser, order, threads);
+}
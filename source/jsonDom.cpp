@@ -0,0 +1,624 @@
+/**
+ * @brief jsonDom.cpp
+ *
+ * Mutable document tree held in a caller supplied arena
+ *
+ */
+
+#include "../jsonDom.hpp"
+#include "../ascii_num.h"
+#include "../jsonScan.hpp"
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace jonaskgandersson;
+
+//------------------------------------------------------
+// Builder
+// - nodes are made in document order on a stack at the end of the arena,
+//   growing down, strings and child arrays are allocated from the start
+// - an open object/array is on the stack above its children, while open
+//   its pChildren holds the object/array it is in
+// - at the end of an object/array its children are copied in order to one
+//   array at the start of the arena and taken off the stack, so the stack
+//   holds only the open objects/arrays and their children read so far
+//
+class JsonDom::Builder : public Json::Handler
+{
+public:
+	Builder(JsonDom &dom) : dom(dom), pTop(NULL), pOpen(NULL), pKey(NULL), keyLen(0), error(0)
+	{
+		uintptr_t end = (uintptr_t)(dom.pArena + dom.arenaSize);
+		pTop = (Node *)(end - end % alignof(Node));
+		if ((char *)pTop < dom.pArena)
+			pTop = (Node *)dom.pArena;
+		dom.limit = (char *)pTop - dom.pArena;
+	}
+
+	bool startObject() { return open(JREAD_OBJECT); }
+	bool endObject() { return close(); }
+	bool startArray() { return open(JREAD_ARRAY); }
+	bool endArray() { return close(); }
+
+	bool key(const char *pKey, size_t keyLen)
+	{
+		this->pKey = text(pKey, keyLen, &this->keyLen);
+		return this->pKey != NULL;
+	}
+
+	bool string(const struct ReadElement &element)
+	{
+		Node *pNode = push(JREAD_STRING);
+		if (pNode == NULL)
+			return false;
+		pNode->pText = text((const char *)element.pValue, element.bytelen, &pNode->length);
+		return pNode->pText != NULL;
+	}
+
+	bool number(const struct ReadElement &element)
+	{
+		Node *pNode = push(JREAD_NUMBER);
+		if (pNode == NULL)
+			return false;
+		pNode->pText = (const char *)element.pValue;
+		pNode->length = (unsigned int)element.bytelen;
+		return true;
+	}
+
+	bool boolean(bool value)
+	{
+		Node *pNode = push(JREAD_BOOL);
+		if (pNode == NULL)
+			return false;
+		dom.setBool(pNode, value);
+		return true;
+	}
+
+	bool null()
+	{
+		Node *pNode = push(JREAD_NULL);
+		if (pNode == NULL)
+			return false;
+		dom.setNull(pNode);
+		return true;
+	}
+
+	// root
+	// - the root is the last node on the stack, moved to the start of the arena
+	//
+	Node *root()
+	{
+		Node *pRoot = (Node *)dom.allocate(sizeof(Node), alignof(Node));
+		if (pRoot != NULL)
+			*pRoot = *pTop;
+		return pRoot;
+	}
+
+	int getError() const
+	{
+		return error;
+	}
+
+private:
+	Node *push(int type)
+	{
+		if ((size_t)((char *)pTop - dom.pArena) < dom.used + sizeof(Node))
+		{
+			error = 19; // Arena full
+			return NULL;
+		}
+		Node *pNode = --pTop;
+		dom.limit = (char *)pTop - dom.pArena;
+		pNode->pKey = pKey;
+		pNode->keyLen = keyLen;
+		pNode->pText = NULL;
+		pNode->length = 0;
+		pNode->capacity = 0;
+		pNode->type = type;
+		pKey = NULL;
+		keyLen = 0;
+		return pNode;
+	}
+
+	bool open(int type)
+	{
+		Node *pNode = push(type);
+		if (pNode == NULL)
+			return false;
+		pNode->pChildren = pOpen;
+		pOpen = pNode;
+		return true;
+	}
+
+	bool close()
+	{
+		Node *pNode = pOpen;
+		unsigned int count = (unsigned int)(pNode - pTop), i;
+		Node *pChildren = NULL;
+		if (count > 0)
+		{
+			pChildren = (Node *)dom.allocate(count * sizeof(Node), alignof(Node));
+			if (pChildren == NULL)
+			{
+				error = 19; // Arena full
+				return false;
+			}
+			for (i = 0; i < count; i++) // stack holds them last first
+				pChildren[i] = pNode[-1 - (int)i];
+		}
+		pTop = pNode;
+		dom.limit = (char *)pTop - dom.pArena;
+		pOpen = pNode->pChildren;
+		pNode->pChildren = pChildren;
+		pNode->length = count;
+		pNode->capacity = count;
+		return true;
+	}
+
+	// text
+	// - strings and keys without '\' are used where they are in the JSON text,
+	//   others are decoded into the arena
+	//
+	const char *text(const char *pText, size_t length, unsigned int *pLength)
+	{
+		char *pDest;
+		long long decoded;
+		if (length > UINT_MAX)
+		{
+			error = 2; // Error reading JSON value
+			return NULL;
+		}
+		*pLength = (unsigned int)length;
+		if (memchr(pText, '\\', length) == NULL)
+			return pText;
+		pDest = (char *)dom.allocate(length + 1, 1); // decoded is never longer
+		if (pDest == NULL)
+		{
+			error = 19; // Arena full
+			return NULL;
+		}
+		decoded = jScanUnescape(pText, length, pDest, length + 1);
+		if (decoded < 0)
+		{
+			error = 2; // Error reading JSON value, bad escape
+			return NULL;
+		}
+		dom.used = (pDest - dom.pArena) + (size_t)decoded; // give back the rest
+		*pLength = (unsigned int)decoded;
+		return pDest;
+	}
+
+	JsonDom &dom;
+	Node *pTop;			 // last node on the stack
+	Node *pOpen;		 // innermost open object/array
+	const char *pKey;	 // key of the next node
+	unsigned int keyLen; // length of key
+	int error;			 // error that stopped the build, 0 if none
+
+	Builder(const Builder &);			 // not copyable
+	Builder &operator=(const Builder &); // not copyable
+};
+
+JsonDom::JsonDom(char *pArena, size_t arenaSize) : pArena(pArena), arenaSize(arenaSize), used(0), limit(arenaSize), pRoot(NULL)
+{
+}
+
+// allocate
+// - bump allocation, size bytes at the next multiple of align
+//
+void *JsonDom::allocate(size_t size, size_t align)
+{
+	size_t start = used + (align - (uintptr_t)(pArena + used) % align) % align;
+	if ((start > limit) || (size > limit - start))
+		return NULL;
+	used = start + size;
+	return pArena + start;
+}
+
+const char *JsonDom::copyText(const char *pText, size_t length)
+{
+	char *pDest = (char *)allocate(length, 1);
+	if (pDest != NULL)
+		memcpy(pDest, pText, length);
+	return pDest;
+}
+
+int JsonDom::build(const char *pJson, size_t jsonLen)
+{
+	clear();
+	Builder builder(*this);
+	int error = Json::parse(pJson, jsonLen, builder);
+	if (error == 0)
+		pRoot = builder.root();
+	else if (builder.getError() != 0)
+		error = builder.getError();
+	limit = arenaSize;
+	if ((error == 0) && (pRoot == NULL))
+		error = 19; // Arena full
+	if (error != 0)
+		clear();
+	return error;
+}
+
+int JsonDom::build(const char *pJson)
+{
+	return build(pJson, strlen(pJson));
+}
+
+void JsonDom::clear()
+{
+	used = 0;
+	limit = arenaSize;
+	pRoot = NULL;
+}
+
+JsonDom::Node *JsonDom::getRoot()
+{
+	return pRoot;
+}
+
+size_t JsonDom::getUsed() const
+{
+	return used;
+}
+
+//------------------------------------------------------
+// Queries
+//------------------------------------------------------
+
+JsonDom::Node *JsonDom::find(const char *pQuery, int *queryParams)
+{
+	Json::Query query(pQuery);
+	if (query.getError() != 0)
+		return NULL;
+	return find(query, queryParams);
+}
+
+// find
+// - steps are taken as by Json::getElement(), '*' without queryParams is index 0
+// - members are compared by length first, children are one array so the
+//   compare runs over adjacent nodes
+//
+JsonDom::Node *JsonDom::find(const Json::Query &query, int *queryParams)
+{
+	Node *pNode = pRoot;
+	unsigned int index;
+	int step;
+
+	for (step = 0; (pNode != NULL) && (step < query.count); step++)
+	{
+		const Json::Query::Step &qStep = query.steps[step];
+		index = qStep.param ? ((queryParams != NULL) ? (unsigned int)queryParams[qStep.value] : 0) : qStep.value;
+		if ((qStep.type == JREAD_QKEY) && (pNode->type == JREAD_OBJECT))
+		{
+			const char *pKey = query.keys + qStep.value;
+			Node *pChild = pNode->pChildren;
+			Node *pLast = pChild + pNode->length;
+			while ((pChild != pLast) &&
+				   ((pChild->keyLen != qStep.keyLen) || (memcmp(pChild->pKey, pKey, qStep.keyLen) != 0)))
+				pChild++;
+			pNode = (pChild != pLast) ? pChild : NULL;
+		}
+		else if ((qStep.type == JREAD_QINDEX) && (pNode->type == JREAD_ARRAY))
+			pNode = child(pNode, index);
+		else
+			pNode = NULL;
+	}
+	return pNode;
+}
+
+JsonDom::Node *JsonDom::member(Node *pObject, const char *key)
+{
+	size_t keyLen = strlen(key);
+	unsigned int i;
+	if ((pObject == NULL) || (pObject->type != JREAD_OBJECT))
+		return NULL;
+	for (i = 0; i < pObject->length; i++)
+	{
+		Node *pChild = &pObject->pChildren[i];
+		if ((pChild->keyLen == keyLen) && (memcmp(pChild->pKey, key, keyLen) == 0))
+			return pChild;
+	}
+	return NULL;
+}
+
+JsonDom::Node *JsonDom::child(Node *pContainer, unsigned int index)
+{
+	if ((pContainer == NULL) || ((pContainer->type != JREAD_OBJECT) && (pContainer->type != JREAD_ARRAY)) ||
+		(index >= pContainer->length))
+		return NULL;
+	return &pContainer->pChildren[index];
+}
+
+// element
+// - a value as read by Json::getElement(), objects and arrays do not convert
+//
+struct ReadElement JsonDom::element(const Node *pNode)
+{
+	struct ReadElement elem;
+	elem.dataType = JREAD_ERROR;
+	elem.elements = 1;
+	elem.bytelen = 0;
+	elem.pValue = "";
+	elem.error = 0;
+	if ((pNode != NULL) && (pNode->type != JREAD_OBJECT) && (pNode->type != JREAD_ARRAY))
+	{
+		elem.dataType = pNode->type;
+		elem.bytelen = pNode->length;
+		elem.pValue = pNode->pText;
+	}
+	return elem;
+}
+
+ReadError JsonDom::getValue(const Node *pNode, long &value)
+{
+	return Json::getValue(element(pNode), value);
+}
+
+ReadError JsonDom::getValue(const Node *pNode, int &value)
+{
+	return Json::getValue(element(pNode), value);
+}
+
+ReadError JsonDom::getValue(const Node *pNode, long long &value)
+{
+	return Json::getValue(element(pNode), value);
+}
+
+ReadError JsonDom::getValue(const Node *pNode, double &value)
+{
+	return Json::getValue(element(pNode), value);
+}
+
+ReadError JsonDom::getValue(const Node *pNode, bool &value)
+{
+	return Json::getValue(element(pNode), value);
+}
+
+//------------------------------------------------------
+// Changes
+//------------------------------------------------------
+
+// add
+// - a full child array is copied to one twice its size, the old one is
+//   left in the arena
+//
+JsonDom::Node *JsonDom::add(Node *pContainer, const char *key)
+{
+	Node *pChildren, *pChild;
+	unsigned int capacity;
+	const char *pKey = NULL;
+	size_t keyLen = 0;
+
+	if ((pContainer == NULL) || ((pContainer->type != JREAD_OBJECT) && (pContainer->type != JREAD_ARRAY)) ||
+		((pContainer->type == JREAD_OBJECT) != (key != NULL)))
+		return NULL;
+	if (key != NULL)
+	{
+		keyLen = strlen(key);
+		if ((keyLen > UINT_MAX) || ((pKey = copyText(key, keyLen)) == NULL))
+			return NULL;
+	}
+	if (pContainer->length == pContainer->capacity)
+	{
+		capacity = (pContainer->capacity > 0) ? pContainer->capacity * 2 : JDOM_MIN_CHILDREN;
+		pChildren = (Node *)allocate(capacity * sizeof(Node), alignof(Node));
+		if (pChildren == NULL)
+			return NULL;
+		if (pContainer->length > 0)
+			memcpy(pChildren, pContainer->pChildren, pContainer->length * sizeof(Node));
+		pContainer->pChildren = pChildren;
+		pContainer->capacity = capacity;
+	}
+	pChild = &pContainer->pChildren[pContainer->length++];
+	pChild->pKey = pKey;
+	pChild->keyLen = (unsigned int)keyLen;
+	pChild->capacity = 0;
+	setNull(pChild);
+	return pChild;
+}
+
+bool JsonDom::remove(Node *pContainer, unsigned int index)
+{
+	if (child(pContainer, index) == NULL)
+		return false;
+	memmove(&pContainer->pChildren[index], &pContainer->pChildren[index + 1],
+			(pContainer->length - index - 1) * sizeof(Node));
+	pContainer->length--;
+	return true;
+}
+
+bool JsonDom::setString(Node *pNode, const char *value, size_t length)
+{
+	const char *pText;
+	if ((length > UINT_MAX) || ((pText = copyText(value, length)) == NULL))
+		return false;
+	pNode->type = JREAD_STRING;
+	pNode->pText = pText;
+	pNode->length = (unsigned int)length;
+	pNode->capacity = 0;
+	return true;
+}
+
+bool JsonDom::setString(Node *pNode, const char *value)
+{
+	return setString(pNode, value, strlen(value));
+}
+
+bool JsonDom::setNumber(Node *pNode, long long value)
+{
+	char text[32];
+	snprintf(text, sizeof(text), "%lld", value);
+	if (!setString(pNode, text))
+		return false;
+	pNode->type = JREAD_NUMBER;
+	return true;
+}
+
+// setNumber
+// - shortest of 15, 16 or 17 significant digits that reads back as value,
+//   17 always does
+//
+bool JsonDom::setNumber(Node *pNode, double value)
+{
+	char text[32];
+	double readBack;
+	int precision;
+
+	if (!isfinite(value)) // no JSON number for NaN or infinity
+		return false;
+	for (precision = 15; precision <= 17; precision++)
+	{
+		snprintf(text, sizeof(text), "%.*g", precision, value);
+		if ((precision == 17) || ((jRead_atof(text, &readBack) != NULL) && (readBack == value)))
+			break;
+	}
+	if (!setString(pNode, text))
+		return false;
+	pNode->type = JREAD_NUMBER;
+	return true;
+}
+
+void JsonDom::setBool(Node *pNode, bool value)
+{
+	pNode->type = JREAD_BOOL;
+	pNode->pText = value ? "true" : "false";
+	pNode->length = value ? 4 : 5;
+	pNode->capacity = 0;
+}
+
+void JsonDom::setNull(Node *pNode)
+{
+	pNode->type = JREAD_NULL;
+	pNode->pText = "null";
+	pNode->length = 4;
+	pNode->capacity = 0;
+}
+
+void JsonDom::setObject(Node *pNode)
+{
+	pNode->type = JREAD_OBJECT;
+	pNode->pChildren = NULL;
+	pNode->length = 0;
+	pNode->capacity = 0;
+}
+
+void JsonDom::setArray(Node *pNode)
+{
+	setObject(pNode);
+	pNode->type = JREAD_ARRAY;
+}
+
+//------------------------------------------------------
+// Output
+//------------------------------------------------------
+
+// Output
+// - text written so far, chars past destLen - 1 are counted, not written
+//
+struct Output
+{
+	char *pDest;
+	size_t destLen;
+	size_t length;
+};
+
+static inline void putChar(Output &out, char c)
+{
+	if (out.length + 1 < out.destLen)
+		out.pDest[out.length] = c;
+	out.length++;
+}
+
+// putString
+// - '"' and '\' are escaped, control chars as \b \f \n \r \t or \u00XX
+//
+static void putString(Output &out, const char *pText, size_t length)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t i;
+	char c;
+	putChar(out, '\"');
+	for (i = 0; i < length; i++)
+	{
+		c = pText[i];
+		if ((c == '\"') || (c == '\\'))
+			putChar(out, '\\');
+		else if ((unsigned char)c < 0x20)
+		{
+			putChar(out, '\\');
+			switch (c)
+			{
+			case '\b':
+				c = 'b';
+				break;
+			case '\f':
+				c = 'f';
+				break;
+			case '\n':
+				c = 'n';
+				break;
+			case '\r':
+				c = 'r';
+				break;
+			case '\t':
+				c = 't';
+				break;
+			default:
+				putChar(out, 'u');
+				putChar(out, '0');
+				putChar(out, '0');
+				putChar(out, hex[(c >> 4) & 0xf]);
+				c = hex[c & 0xf];
+				break;
+			}
+		}
+		putChar(out, c);
+	}
+	putChar(out, '\"');
+}
+
+static void putValue(Output &out, const JsonDom::Node *pNode)
+{
+	unsigned int i;
+	switch (pNode->type)
+	{
+	case JREAD_OBJECT:
+	case JREAD_ARRAY:
+		putChar(out, (pNode->type == JREAD_OBJECT) ? '{' : '[');
+		for (i = 0; i < pNode->length; i++)
+		{
+			const JsonDom::Node *pChild = &pNode->pChildren[i];
+			if (i > 0)
+				putChar(out, ',');
+			if (pNode->type == JREAD_OBJECT)
+			{
+				putString(out, pChild->pKey, pChild->keyLen);
+				putChar(out, ':');
+			}
+			putValue(out, pChild);
+		}
+		putChar(out, (pNode->type == JREAD_OBJECT) ? '}' : ']');
+		break;
+	case JREAD_STRING:
+		putString(out, pNode->pText, pNode->length);
+		break;
+	default: // number, true, false or null
+		for (i = 0; i < pNode->length; i++)
+			putChar(out, pNode->pText[i]);
+		break;
+	}
+}
+
+size_t JsonDom::print(const Node *pNode, char *pDest, size_t destLen)
+{
+	Output out = {pDest, destLen, 0};
+	if (pNode != NULL)
+		putValue(out, pNode);
+	if (destLen > 0)
+		pDest[(out.length < destLen) ? out.length : destLen - 1] = '\0';
+	return out.length;
+}
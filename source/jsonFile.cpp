@@ -0,0 +1,144 @@
+/**
+ * @brief jsonFile.cpp
+ *
+ * Read-only memory mapped JSON file
+ *
+ */
+
+#define _FILE_OFFSET_BITS 64 // files over 2 GB on 32 bit systems (fail with JFILE_TOO_LARGE)
+
+#include "../jsonFile.hpp"
+#include <stdint.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JFILE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define JFILE_MMAP 0
+#endif
+
+using namespace jonaskgandersson;
+
+JsonFile::JsonFile() : pData(NULL), length(0)
+{
+}
+
+JsonFile::~JsonFile()
+{
+	close();
+}
+
+#if JFILE_MMAP
+
+// prefault
+// - reads every page of the mapping so queries do not fault
+// - one page is touched at a time where the system can not populate a range
+//
+static void prefault(const char *pData, size_t length)
+{
+	volatile char sink;
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t offset;
+
+#ifdef MADV_POPULATE_READ
+	if (madvise((void *)pData, length, MADV_POPULATE_READ) == 0)
+		return;
+#endif
+	for (offset = 0; offset < length; offset += page)
+		sink = pData[offset];
+	(void)sink;
+}
+
+int JsonFile::open(const char *path, int hints)
+{
+	struct stat st;
+	int fd, flags = MAP_SHARED;
+	void *pMap;
+
+	close();
+	fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return JFILE_OPEN_FAILED;
+	if (fstat(fd, &st) != 0)
+	{
+		::close(fd);
+		return JFILE_OPEN_FAILED;
+	}
+	if ((unsigned long long)st.st_size > SIZE_MAX)
+	{
+		::close(fd);
+		return JFILE_TOO_LARGE;
+	}
+	if (st.st_size == 0) // nothing to map
+	{
+		::close(fd);
+		return JFILE_OK;
+	}
+#ifdef MAP_POPULATE
+	if ((hints & JFILE_PREFAULT) && !(hints & JFILE_HUGEPAGES))
+		flags |= MAP_POPULATE; // huge pages are advised before faulting, see below
+#endif
+	pMap = mmap(NULL, (size_t)st.st_size, PROT_READ, flags, fd, 0);
+	::close(fd); // the mapping keeps the file open
+	if (pMap == MAP_FAILED)
+		return JFILE_MAP_FAILED;
+	pData = (const char *)pMap;
+	length = (size_t)st.st_size;
+
+	// hints are advisory, errors are ignored
+	if (hints & JFILE_SEQUENTIAL)
+		madvise(pMap, length, MADV_SEQUENTIAL);
+	if (hints & JFILE_WILLNEED)
+		madvise(pMap, length, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+	if (hints & JFILE_HUGEPAGES)
+		madvise(pMap, length, MADV_HUGEPAGE);
+#endif
+#ifdef MAP_POPULATE
+	if ((hints & JFILE_PREFAULT) && (hints & JFILE_HUGEPAGES))
+		prefault(pData, length);
+#else
+	if (hints & JFILE_PREFAULT)
+		prefault(pData, length);
+#endif
+	return JFILE_OK;
+}
+
+void JsonFile::close()
+{
+	if (pData != NULL)
+		munmap((void *)pData, length);
+	pData = NULL;
+	length = 0;
+}
+
+#else
+
+int JsonFile::open(const char *path, int hints)
+{
+	(void)path;
+	(void)hints;
+	close();
+	return JFILE_NOT_SUPPORTED;
+}
+
+void JsonFile::close()
+{
+	pData = NULL;
+	length = 0;
+}
+
+#endif
+
+const char *JsonFile::data() const
+{
+	return (pData != NULL) ? pData : "";
+}
+
+size_t JsonFile::size() const
+{
+	return length;
+}
@@ -0,0 +1,202 @@
+/**
+ * @brief jsonLines.cpp
+ *
+ * Parallel reader for newline-delimited JSON (NDJSON, JSON Lines)
+ *
+ */
+
+#include "../jsonLines.hpp"
+#include "../jsonFile.hpp"
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+using namespace jonaskgandersson;
+
+//------------------------------------------------------
+// Chunk
+// - records of a chunk, kept until the chunks before it are delivered
+//
+struct JsonLines::Chunk
+{
+	std::vector<Record> records;
+	std::vector<struct ReadElement> results; // queries.size() per record
+	bool done;
+
+	Chunk() : records(), results(), done(false) {}
+};
+
+//------------------------------------------------------
+// Reader
+// - state of one read() shared by the workers
+// - chunk n covers the text from the first line starting at or after
+//   n * JLINES_CHUNK to the first line starting at or after (n + 1) * JLINES_CHUNK,
+//   so every worker finds the line boundaries of its chunk itself
+//
+struct JsonLines::Reader
+{
+	const char *pText;
+	size_t length;
+	Handler handler;
+	void *pUser;
+	int order;
+	size_t chunks;
+	std::atomic<size_t> nextChunk;	  // next chunk to read
+	std::atomic<size_t> records;	  // records read
+	std::vector<Chunk> pending;		  // JLINES_ORDERED, chunks read
+	size_t nextDelivery;			  // JLINES_ORDERED, next chunk to deliver
+	bool delivering;				  // JLINES_ORDERED, a worker is calling the handler
+	std::mutex lock;				  // pending, nextDelivery and delivering
+
+	Reader() : pText(NULL), length(0), handler(NULL), pUser(NULL), order(JLINES_UNORDERED), chunks(0),
+			   nextChunk(0), records(0), pending(), nextDelivery(0), delivering(false), lock() {}
+
+private:
+	Reader(const Reader &);			   // not copyable, shared by the workers
+	Reader &operator=(const Reader &); // not copyable
+};
+
+// lineStart
+// - start of the first line at or after offset
+//
+static size_t lineStart(const char *pText, size_t length, size_t offset)
+{
+	const char *pNewline;
+	if ((offset == 0) || (offset >= length))
+		return (offset == 0) ? 0 : length;
+	pNewline = (const char *)memchr(pText + offset - 1, '\n', length - offset + 1);
+	return (pNewline == NULL) ? length : (size_t)(pNewline - pText) + 1;
+}
+
+JsonLines::JsonLines() : queries(), threads(0)
+{
+}
+
+int JsonLines::addQuery(const char *pQuery)
+{
+	Json::Query query(pQuery);
+	if (query.getError() != 0)
+		return -1;
+	queries.push_back(query);
+	return (int)queries.size() - 1;
+}
+
+int JsonLines::getThreads() const
+{
+	return threads;
+}
+
+// readChunks
+// - run by each worker, takes chunks 'til all are taken
+// - JLINES_ORDERED: results are kept in pending[chunk], the worker that
+//   completes the next chunk to deliver delivers it and any completed
+//   chunks after it
+//
+void JsonLines::readChunks(Reader &reader, int worker) const
+{
+	size_t nQueries = queries.size();
+	std::vector<Record> records;
+	std::vector<struct ReadElement> results;
+	size_t chunk, i, q, count;
+	const char *sp, *pChunkEnd, *pLineEnd, *pRecordEnd;
+	Record record;
+
+	while ((chunk = reader.nextChunk++) < reader.chunks)
+	{
+		sp = reader.pText + lineStart(reader.pText, reader.length, chunk * JLINES_CHUNK);
+		pChunkEnd = reader.pText + lineStart(reader.pText, reader.length, (chunk + 1) * JLINES_CHUNK);
+		records.clear();
+		results.clear();
+		count = 0;
+		while (sp < pChunkEnd)
+		{
+			pLineEnd = (const char *)memchr(sp, '\n', pChunkEnd - sp);
+			if (pLineEnd == NULL)
+				pLineEnd = pChunkEnd;
+			pRecordEnd = pLineEnd;
+			if ((pRecordEnd > sp) && (pRecordEnd[-1] == '\r'))
+				pRecordEnd--;
+			if (pRecordEnd > sp) // empty lines are skipped
+			{
+				record.pLine = sp;
+				record.length = pRecordEnd - sp;
+				record.offset = sp - reader.pText;
+				record.worker = worker;
+				record.pResults = NULL;
+				i = results.size();
+				results.resize(i + nQueries);
+				for (q = 0; q < nQueries; q++)
+					Json::getElement(sp, record.length, queries[q], NULL, &results[i + q]);
+				if (reader.order == JLINES_UNORDERED)
+				{
+					record.pResults = results.data() + i;
+					reader.handler(record, reader.pUser);
+					results.clear();
+				}
+				else
+					records.push_back(record);
+				count++;
+			}
+			sp = pLineEnd + 1;
+		}
+		reader.records += count;
+		if (reader.order == JLINES_UNORDERED)
+			continue;
+
+		std::unique_lock<std::mutex> guard(reader.lock);
+		reader.pending[chunk].records.swap(records);
+		reader.pending[chunk].results.swap(results);
+		reader.pending[chunk].done = true;
+		if (reader.delivering)
+			continue; // the delivering worker picks this chunk up
+		reader.delivering = true;
+		while ((reader.nextDelivery < reader.chunks) && reader.pending[reader.nextDelivery].done)
+		{
+			Chunk ready;
+			ready.records.swap(reader.pending[reader.nextDelivery].records);
+			ready.results.swap(reader.pending[reader.nextDelivery].results);
+			reader.nextDelivery++;
+			guard.unlock(); // other workers store chunks while this one delivers
+			for (i = 0; i < ready.records.size(); i++)
+			{
+				ready.records[i].pResults = ready.results.data() + i * nQueries;
+				reader.handler(ready.records[i], reader.pUser);
+			}
+			guard.lock();
+		}
+		reader.delivering = false;
+	}
+}
+
+size_t JsonLines::read(const char *pText, size_t length, Handler handler, void *pUser, int order, int threads)
+{
+	Reader reader;
+	std::vector<std::thread> workers;
+	int i;
+
+	if (threads <= 0)
+		threads = (int)std::thread::hardware_concurrency();
+	if (threads <= 0)
+		threads = 1;
+	this->threads = threads;
+	reader.pText = pText;
+	reader.length = length;
+	reader.handler = handler;
+	reader.pUser = pUser;
+	reader.order = order;
+	reader.chunks = (length + JLINES_CHUNK - 1) / JLINES_CHUNK;
+	if (order == JLINES_ORDERED)
+		reader.pending.resize(reader.chunks);
+	for (i = 1; i < threads; i++)
+		workers.push_back(std::thread(&JsonLines::readChunks, this, std::ref(reader), i));
+	readChunks(reader, 0); // the calling thread is worker 0
+	for (i = 0; i < (int)workers.size(); i++)
+		workers[i].join();
+	return reader.records;
+}
+
+size_t JsonLines::read(const JsonFile &file, Handler handler, void *pUser, int order, int threads)
+{
+	return read(file.data(), file.size(), handler, pUser, order, threads);
+}
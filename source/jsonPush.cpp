@@ -0,0 +1,344 @@
+/**
+ * @brief jsonPush.cpp
+ *
+ * Resumable push tokenizer for JSON received in fragments
+ *
+ */
+
+#include "../jsonPush.hpp"
+
+using namespace jonaskgandersson;
+
+// states, what is expected next
+#define PUSH_VALUE 0	 // value, substate 1: first in array ']' allowed
+#define PUSH_KEY 1		 // "key", substate 1: first in object '}' allowed
+#define PUSH_COLON 2	 // ':'
+#define PUSH_NEXT 3		 // ',' or end of object/array
+#define PUSH_STRING 4	 // in string value
+#define PUSH_KEYSTRING 5 // in "key"
+#define PUSH_NUMBER 6	 // in number
+#define PUSH_LITERAL 7	 // in true, false or null
+
+// string substates
+#define STR_CHARS 0	 // chars
+#define STR_ESCAPE 1 // after '\'
+#define STR_HEX 2	 // 2..5 reading \uXXXX digits
+
+// number substates
+#define NUM_MINUS 0	   // after '-', digit expected
+#define NUM_ZERO 1	   // leading '0'
+#define NUM_INT 2	   // integer digits
+#define NUM_DOT 3	   // after '.', digit expected
+#define NUM_FRAC 4	   // fraction digits
+#define NUM_E 5		   // after 'e', sign or digit expected
+#define NUM_ESIGN 6	   // after exponent sign, digit expected
+#define NUM_EXP 7	   // exponent digits
+
+// isWhitespace
+// - JSON whitespace
+//
+static inline int isWhitespace(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+static inline int isDigit(char c)
+{
+	return (c >= '0') && (c <= '9');
+}
+
+static inline int isHex(char c)
+{
+	return isDigit(c) || ((c >= 'a') && (c <= 'f')) || ((c >= 'A') && (c <= 'F'));
+}
+
+JsonPush::JsonPush() : state(PUSH_VALUE), substate(0), depth(0), isObject(0), error(0),
+					   consumed(0), offset(0), pLiteral(NULL), stack()
+{
+}
+
+void JsonPush::reset()
+{
+	state = PUSH_VALUE;
+	substate = 0;
+	depth = 0;
+	isObject = 0;
+	error = 0;
+	consumed = 0;
+	offset = 0;
+	pLiteral = NULL;
+}
+
+// pop
+// - end of the innermost object/array
+//
+void JsonPush::pop()
+{
+	depth--;
+	isObject = (depth > 0) ? (stack[(depth - 1) / 8] >> ((depth - 1) % 8)) & 1 : 0;
+}
+
+// feed
+// - one char at a time through the state machine, except runs of plain
+//   string chars which are read in a loop
+// - a value ending at depth 0 returns JPUSH_COMPLETE, the state is left
+//   ready for the next top-level value
+// - numbers have no end char, the char after a number is read again in
+//   PUSH_NEXT (or ends a top-level number)
+//
+int JsonPush::feed(const char *pText, size_t length)
+{
+	const char *sp = pText;
+	const char *pEnd = pText + length;
+	int valueEnd;
+	char c;
+
+	consumed = 0;
+	if (error)
+		return JPUSH_ERROR;
+	while (sp != pEnd)
+	{
+		c = *sp;
+		valueEnd = 0;
+		switch (state)
+		{
+		case PUSH_VALUE:
+			if (isWhitespace(c))
+				break;
+			if ((c == ']') && (substate == 1)) // empty array
+			{
+				valueEnd = 1;
+				pop();
+				break;
+			}
+			substate = 0;
+			if ((c == '{') || (c == '['))
+			{
+				if (depth >= JREAD_STACK_DEPTH)
+				{
+					error = 16; // Nesting > JREAD_STACK_DEPTH
+					break;
+				}
+				isObject = (c == '{');
+				if (isObject) // push
+					stack[depth / 8] |= (unsigned char)(1 << (depth % 8));
+				else
+					stack[depth / 8] &= (unsigned char)~(1 << (depth % 8));
+				depth++;
+				state = isObject ? PUSH_KEY : PUSH_VALUE;
+				substate = 1;
+			}
+			else if (c == '\"')
+				state = PUSH_STRING;
+			else if (c == '-')
+				state = PUSH_NUMBER;
+			else if (isDigit(c))
+			{
+				state = PUSH_NUMBER;
+				substate = (c == '0') ? NUM_ZERO : NUM_INT;
+			}
+			else if ((c == 't') || (c == 'f') || (c == 'n'))
+			{
+				state = PUSH_LITERAL;
+				pLiteral = (c == 't') ? "true" : (c == 'f') ? "false" : "null";
+				substate = 1;
+			}
+			else
+				error = 8; // Unexpected character
+			break;
+
+		case PUSH_KEY:
+			if (isWhitespace(c))
+				break;
+			if ((c == '}') && (substate == 1)) // empty object
+			{
+				valueEnd = 1;
+				pop();
+			}
+			else if (c == '\"')
+			{
+				state = PUSH_KEYSTRING;
+				substate = STR_CHARS;
+			}
+			else
+				error = 3; // Expected "key"
+			break;
+
+		case PUSH_COLON:
+			if (isWhitespace(c))
+				break;
+			if (c == ':')
+			{
+				state = PUSH_VALUE;
+				substate = 0;
+			}
+			else
+				error = 4; // Expected ':'
+			break;
+
+		case PUSH_NEXT:
+			if (isWhitespace(c))
+				break;
+			if (c == ',')
+			{
+				state = isObject ? PUSH_KEY : PUSH_VALUE;
+				substate = 0;
+			}
+			else if (c == (isObject ? '}' : ']'))
+			{
+				valueEnd = 1;
+				pop();
+			}
+			else
+				error = isObject ? 6 : 9; // Expected "," in object/array
+			break;
+
+		case PUSH_STRING:
+		case PUSH_KEYSTRING:
+			if (substate == STR_CHARS)
+			{
+				while ((c != '\"') && (c != '\\') && ((unsigned char)c >= 0x20))
+				{
+					if (++sp == pEnd)
+						break;
+					c = *sp;
+				}
+				if (sp == pEnd)
+					continue;
+				if (c == '\"')
+				{
+					if (state == PUSH_KEYSTRING)
+						state = PUSH_COLON;
+					else
+						valueEnd = 1;
+				}
+				else if (c == '\\')
+					substate = STR_ESCAPE;
+				else
+					error = 2; // control char in string
+			}
+			else if (substate == STR_ESCAPE)
+			{
+				if (c == 'u')
+					substate = STR_HEX;
+				else if ((c == '\"') || (c == '\\') || (c == '/') || (c == 'b') ||
+						 (c == 'f') || (c == 'n') || (c == 'r') || (c == 't'))
+					substate = STR_CHARS;
+				else
+					error = 2; // bad escape
+			}
+			else if (!isHex(c))
+				error = 2; // bad \uXXXX
+			else if (++substate == STR_HEX + 4)
+				substate = STR_CHARS;
+			break;
+
+		case PUSH_NUMBER:
+			if (isDigit(c))
+			{
+				if (substate == NUM_MINUS)
+					substate = (c == '0') ? NUM_ZERO : NUM_INT;
+				else if (substate == NUM_ZERO)
+					substate = -1; // no digits after a leading '0'
+				else if ((substate == NUM_DOT) || (substate == NUM_FRAC))
+					substate = NUM_FRAC;
+				else if (substate >= NUM_E)
+					substate = NUM_EXP;
+			}
+			else if ((c == '.') && ((substate == NUM_ZERO) || (substate == NUM_INT)))
+				substate = NUM_DOT;
+			else if (((c == 'e') || (c == 'E')) &&
+					 ((substate == NUM_ZERO) || (substate == NUM_INT) || (substate == NUM_FRAC)))
+				substate = NUM_E;
+			else if (((c == '+') || (c == '-')) && (substate == NUM_E))
+				substate = NUM_ESIGN;
+			else if ((substate == NUM_ZERO) || (substate == NUM_INT) ||
+					 (substate == NUM_FRAC) || (substate == NUM_EXP))
+			{
+				// c is after the number, read it again after the value
+				if (depth == 0)
+				{
+					state = PUSH_VALUE;
+					substate = 0;
+					consumed = sp - pText;
+					offset += consumed;
+					return JPUSH_COMPLETE;
+				}
+				state = PUSH_NEXT;
+				continue;
+			}
+			else
+				substate = -1;
+			if (substate < 0)
+				error = 2; // bad number
+			break;
+
+		case PUSH_LITERAL:
+			if (c != pLiteral[substate])
+				error = 2; // bad true, false or null
+			else if (pLiteral[++substate] == '\0')
+				valueEnd = 1;
+			break;
+		}
+		if (error)
+		{
+			consumed = sp - pText;
+			offset += consumed;
+			return JPUSH_ERROR;
+		}
+		sp++;
+		if (valueEnd)
+		{
+			substate = 0;
+			if (depth == 0)
+			{
+				state = PUSH_VALUE;
+				consumed = sp - pText;
+				offset += consumed;
+				return JPUSH_COMPLETE;
+			}
+			state = PUSH_NEXT;
+		}
+	}
+	consumed = length;
+	offset += consumed;
+	return JPUSH_MORE;
+}
+
+int JsonPush::finish()
+{
+	consumed = 0;
+	if (error)
+		return JPUSH_ERROR;
+	if ((state == PUSH_NUMBER) && (depth == 0) &&
+		((substate == NUM_ZERO) || (substate == NUM_INT) || (substate == NUM_FRAC) || (substate == NUM_EXP)))
+	{
+		state = PUSH_VALUE;
+		substate = 0;
+		return JPUSH_COMPLETE;
+	}
+	if ((state == PUSH_VALUE) && (depth == 0))
+		return JPUSH_MORE;
+	error = 2; // input ended in a value
+	return JPUSH_ERROR;
+}
+
+size_t JsonPush::getConsumed() const
+{
+	return consumed;
+}
+
+size_t JsonPush::getOffset() const
+{
+	return offset;
+}
+
+int JsonPush::getDepth() const
+{
+	return depth;
+}
+
+int JsonPush::getError() const
+{
+	return error;
+}
@@ -11,18 +11,33 @@
 
 #include "../jsonRW.hpp"
 #include "../ascii_num.h"
+#include "../jsonScan.hpp"
+#include "../jsonFile.hpp"
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
 using namespace jonaskgandersson;
 
-Json::Json(char *pbuffer, int buf_len) : buffer(pbuffer), buflen(buf_len), bufp(buffer), error(JWRITE_OK), callNo(0), stackpos(0), isPretty(false)
+Json::Json(char *pbuffer, int buf_len) : buffer(pbuffer), buflen(buf_len), bufp(buffer), error(JWRITE_OK), callNo(0), stackpos(0), isPretty(false), readContext(), queryCache()
 {
+	readContext.pJson = buffer;
+	readContext.pEnd = buffer + buflen; // reading stops at '\0' or the end of buffer
+	clearIndex();
+}
+
+Json::Json(const JsonFile &file) : buffer(NULL), buflen(0), bufp(NULL), error(JWRITE_OK), callNo(0), stackpos(0), isPretty(false), readContext(), queryCache()
+{
+	readContext.pJson = file.data();
+	readContext.pEnd = file.data() + file.size();
+	clearIndex();
 }
 
 void Json::open(NodeType rootType, int is_Pretty)
 {
-	memset(buffer, 0, buflen); // zap the whole destination buffer (all string terminators)
+	invalidate();
+	if (buffer != NULL) // read-only instance, writes report JWRITE_BUF_FULL
+		memset(buffer, 0, buflen); // zap the whole destination buffer (all string terminators)
 	bufp = buffer;
 	nodeStack[0].nodeType = rootType;
 	nodeStack[0].elementNo = 0;
@@ -35,6 +50,7 @@ void Json::open(NodeType rootType, int is_Pretty)
 
 int Json::close()
 {
+	invalidate();
 	if (error == JWRITE_OK)
 	{
 		if (stackpos == 0)
@@ -54,6 +70,7 @@ int Json::close()
 
 int Json::end()
 {
+	invalidate();
 	if (error == JWRITE_OK)
 	{
 		NodeType node;
@@ -167,6 +184,40 @@ void Json::add(const char *key, bool oneOrZero)
 	addRaw(key, (oneOrZero) ? "true" : "false");
 }
 
+void Json::add(const Binding &binding, const void *pStruct)
+{
+	const char *pMember;
+	int i;
+	for (i = 0; i < binding.count; i++)
+	{
+		const BindField &field = binding.pFields[i];
+		pMember = (const char *)pStruct + field.offset;
+		switch (field.type)
+		{
+		case JBIND_INT:
+			add(field.key, *(const int *)pMember);
+			break;
+		case JBIND_LONG:
+			snprintf(tmpbuf, sizeof(tmpbuf), "%ld", *(const long *)pMember);
+			addRaw(field.key, tmpbuf);
+			break;
+		case JBIND_LLONG:
+			snprintf(tmpbuf, sizeof(tmpbuf), "%lld", *(const long long *)pMember);
+			addRaw(field.key, tmpbuf);
+			break;
+		case JBIND_DOUBLE:
+			add(field.key, *(const double *)pMember);
+			break;
+		case JBIND_BOOL:
+			add(field.key, *(const bool *)pMember);
+			break;
+		default:
+			add(field.key, pMember);
+			break;
+		}
+	}
+}
+
 void Json::addRaw(const char *rawtext)
 {
 	if (_jwArr() == JWRITE_OK)
@@ -267,6 +318,12 @@ NodeType Json::pop()
 	return retval;
 }
 
+void Json::invalidate()
+{
+	clearIndex();
+	clearCache();
+}
+
 void Json::putch(const char c)
 {
 	if ((unsigned int)(bufp - buffer + 1) >= buflen)
@@ -295,6 +352,7 @@ void Json::putraw(const char *str)
 
 int Json::_jwObj(const char *key)
 {
+	invalidate();
 	if (error == JWRITE_OK)
 	{
 		callNo++;
@@ -313,6 +371,7 @@ int Json::_jwObj(const char *key)
 
 int Json::_jwArr()
 {
+	invalidate();
 	if (error == JWRITE_OK)
 	{
 		callNo++;
@@ -348,31 +407,27 @@ char *Json::copyElementValue(char *destBuffer, int destLength, struct ReadElemen
 }
 
 // getObjectLength
-// - used when query ends at an object, we want to return the object length
+// - used for "{NUMBER" and "{*" queries, returns the "key" at keyIndex
 // - on entry pJson -> "{... "
-// - used to skip unwanted values which are objects
-// - keyIndex normally passed as -1 unless we're looking for the nth "key" value
-//   in which case keyIndex is the index of the key we want
+// - keyIndex -1 returns the object length, see getContainerLength()
 //
-const char *Json::getObjectLength(const char *pJson, struct ReadElement *pResult, int keyIndex)
+const char *Json::getObjectLength(const char *pJson, struct ReadElement *pResult, int keyIndex, const ReadContext *pContext)
 {
 	struct ReadElement jElement;
 	int jTok;
-	const char *sp;
+	const char *pEnd = contextEnd(pContext);
+	if (keyIndex < 0)
+		return getContainerLength(pJson, pResult, pContext);
 	pResult->dataType = JREAD_OBJECT;
 	pResult->error = 0;
 	pResult->elements = 0;
 	pResult->pValue = pJson;
-	sp = findTok(pJson + 1, &jTok); // check for empty object
-	if (jTok == JREAD_EOBJECT)
-	{
-		pJson = sp + 1;
-	}
-	else
+	findTok(pJson + 1, &jTok, pEnd); // check for empty object
+	if (jTok != JREAD_EOBJECT)
 	{
 		while (1)
 		{
-			pJson = getElementString(++pJson, &jElement, '\"');
+			pJson = getElementString(++pJson, &jElement, '\"', pEnd);
 			if (jElement.dataType != JREAD_STRING)
 			{
 				pResult->error = 3; // Expected "key"
@@ -384,22 +439,17 @@ const char *Json::getObjectLength(const char *pJson, struct ReadElement *pResult
 				pResult->dataType = JREAD_KEY;
 				return pJson;
 			}
-			pJson = findTok(pJson, &jTok);
+			pJson = findTok(pJson, &jTok, pEnd);
 			if (jTok != JREAD_COLON)
 			{
 				pResult->error = 4; // Expected ":"
 				break;
 			}
-			pJson = getElement(++pJson, "", &jElement);
-			if (pResult->error)
-				break;
-			pJson = findTok(pJson, &jTok);
+			pJson = skipValue(++pJson, pContext);
+			pJson = findTok(pJson, &jTok, pEnd);
 			pResult->elements++;
 			if (jTok == JREAD_EOBJECT)
-			{
-				pJson++;
 				break;
-			}
 			if (jTok != JREAD_COMMA)
 			{
 				pResult->error = 6; // Expected "," in object
@@ -407,60 +457,109 @@ const char *Json::getObjectLength(const char *pJson, struct ReadElement *pResult
 			}
 		}
 	}
-	if (keyIndex >= 0)
-	{
-		// we wanted a "key" value - that we didn't find
-		pResult->dataType = JREAD_ERROR;
-		pResult->error = 11; // Object key not found (bad index)
-	}
-	else
+	// we wanted a "key" value - that we didn't find
+	pResult->dataType = JREAD_ERROR;
+	pResult->error = 11; // Object key not found (bad index)
+	return pJson;
+}
+
+// skipValue
+// - skips the value at pJson, used where the value is not wanted
+// - objects and arrays are skipped by bracket depth only (jScanSkip()),
+//   their members are not read or checked, with an index the end is looked up
+// - strings, numbers, true, false and null are skipped as by getElement()
+//
+// returns: pointer into pJson after the value (at the token if it is not a value)
+//
+inline const char *Json::skipValue(const char *pJson, const ReadContext *pContext)
+{
+	struct ReadElement jElement;
+	const IndexEntry *pEntry;
+	int jTok;
+	const char *pEnd = contextEnd(pContext);
+	pJson = findTok(pJson, &jTok, pEnd);
+	switch (jTok)
 	{
-		pResult->bytelen = pJson - (char *)pResult->pValue;
+	case JREAD_OBJECT:
+	case JREAD_ARRAY:
+		if ((pEntry = findIndexEntry(pContext, pJson)) != NULL)
+			return pJson + (pEntry->close - pEntry->open + 1);
+		pJson = jScanSkip(pJson + 1, pEnd);
+		return ((pJson != pEnd) && (*pJson != '\0')) ? pJson + 1 : pJson;
+	case JREAD_STRING:
+		return getElementString(pJson, &jElement, '\"', pEnd);
+	case JREAD_NUMBER:
+	case JREAD_BOOL:
+	case JREAD_NULL:
+		return pJson + getElementStringLenght(pJson, pEnd);
+	default:
+		return pJson;
 	}
-	return pJson;
 }
 
-// getArrayLength
-// - used when query ends at an array, we want to return the array length
-// - on entry pJson -> "[... "
-// - used to skip unwanted values which are arrays
+// getContainerLength
+// - used when query ends at an object or array, we want to return its length
+// - on entry pJson -> "{... " or "[... "
+// - members/elements are counted, their values are skipped by skipValue()
+// - with an index lengths are looked up instead of read
 //
-const char *Json::getArrayLength(const char *pJson, struct ReadElement *pResult)
+const char *Json::getContainerLength(const char *pJson, struct ReadElement *pResult, const ReadContext *pContext)
 {
 	struct ReadElement jElement;
 	int jTok;
-	const char *sp;
-	pResult->dataType = JREAD_ARRAY;
+	int isObject = (*pJson == '{');
+	const IndexEntry *pEntry;
+	const char *pEnd = contextEnd(pContext);
+	pResult->dataType = isObject ? JREAD_OBJECT : JREAD_ARRAY;
 	pResult->error = 0;
 	pResult->elements = 0;
 	pResult->pValue = pJson;
-	sp = findTok(pJson + 1, &jTok); // check for empty array
-	if (jTok == JREAD_EARRAY)
+	if ((pEntry = findIndexEntry(pContext, pJson)) != NULL)
 	{
-		pJson = sp + 1;
+		pResult->elements = pEntry->elements;
+		pResult->bytelen = pEntry->close - pEntry->open + 1;
+		return pJson + pResult->bytelen;
 	}
+	pJson = findTok(pJson + 1, &jTok, pEnd); // check for empty object/array
+	if (jTok == (isObject ? JREAD_EOBJECT : JREAD_EARRAY))
+		pJson++;
 	else
 	{
 		while (1)
 		{
-			pJson = getElement(++pJson, "", &jElement); // array value
-			if (pResult->error)
-				break;
-			pJson = findTok(pJson, &jTok); // , or ]
+			if (isObject)
+			{
+				pJson = getElementString(pJson, &jElement, '\"', pEnd);
+				if (jElement.dataType != JREAD_STRING)
+				{
+					pResult->error = 3; // Expected "key"
+					break;
+				}
+				pJson = findTok(pJson, &jTok, pEnd);
+				if (jTok != JREAD_COLON)
+				{
+					pResult->error = 4; // Expected ":"
+					break;
+				}
+				pJson++;
+			}
+			pJson = skipValue(pJson, pContext);
 			pResult->elements++;
-			if (jTok == JREAD_EARRAY)
+			pJson = findTok(pJson, &jTok, pEnd);
+			if (jTok == (isObject ? JREAD_EOBJECT : JREAD_EARRAY))
 			{
 				pJson++;
 				break;
 			}
 			if (jTok != JREAD_COMMA)
 			{
-				pResult->error = 9; // Expected "," in array
+				pResult->error = isObject ? 6 : 9; // Expected "," in object/array
 				break;
 			}
+			pJson++;
 		}
 	}
-	pResult->bytelen = pJson - (char *)pResult->pValue;
+	pResult->bytelen = pJson - (const char *)pResult->pValue;
 	return pJson;
 }
 
@@ -488,426 +587,3025 @@ const char *Json::getArrayElement(const char *pJsonArray, struct ReadElement *pR
 
 const char *Json::getElement(const char *pQuery, struct ReadElement &pResult)
 {
-	return getElement((const char *)buffer, pQuery, NULL, &pResult);
+	return getRootElement(pQuery, NULL, &pResult);
 }
 
 const char *Json::getElement(const char *pQuery, int *queryParams, struct ReadElement &pResult)
 {
-	return getElement((const char *)buffer, pQuery, queryParams, &pResult);
+	return getRootElement(pQuery, queryParams, &pResult);
 }
 
 const char *Json::getElement(const char *pJson, const char *pQuery, struct ReadElement *pResult)
 {
-	return getElement(pJson, pQuery, NULL, pResult);
+	return getElement(pJson, pQuery, NULL, pResult, NULL);
 }
 
 const char *Json::getElement(const char *pJson, const char *pQuery, int *queryParams, struct ReadElement *pResult)
 {
-	int qTok, jTok, bytelen;
-	unsigned int index, count;
-	struct ReadElement qElement, jElement;
-
-	pJson = findTok(pJson, &jTok);
-	pQuery = findTok(pQuery, &qTok);
-
-	pResult->dataType = jTok;
-	pResult->bytelen = pResult->elements = pResult->error = 0;
-	pResult->pValue = pJson;
+	return getElement(pJson, pQuery, queryParams, pResult, NULL);
+}
 
-	if ((qTok != JREAD_EOL) && (qTok != jTok))
-	{
-		pResult->error = 1; // JSON does not match Query
-		return pJson;
-	}
+// getElement
+// - toEnd false: a query ending at an object or array returns at its
+//   opening bracket, elements and bytelen are left 0 (see readNumbers())
+//
+const char *Json::getElement(const char *pJson, const char *pQuery, int *queryParams, struct ReadElement *pResult, const ReadContext *pContext, bool toEnd)
+{
+	int qTok, jTok;
+	size_t bytelen;
+	unsigned int index, hash;
+	struct ReadElement qElement;
+	const char *pEnd = contextEnd(pContext);
 
-	switch (jTok)
+	while (1)
 	{
-	case JREAD_ERROR:		// general error, eof etc.
-		pResult->error = 2; // Error reading JSON value
-		break;
+		// one query step per pass, the matched value is the JSON of the next step
+		pJson = findTok(pJson, &jTok, pEnd);
+		pQuery = findTok(pQuery, &qTok);
 
-	case JREAD_OBJECT: // "{"
-		if (qTok == JREAD_EOL)
-			return getObjectLength(pJson, pResult, -1); // return length of object
+		pResult->dataType = jTok;
+		pResult->bytelen = pResult->elements = pResult->error = 0;
+		pResult->pValue = pJson;
 
-		pQuery = findTok(++pQuery, &qTok); // "('key'...", "{NUMBER", "{*" or EOL
-		if (qTok != JREAD_STRING)
+		if ((qTok != JREAD_EOL) && (qTok != jTok))
 		{
-			index = 0;
-			switch (qTok)
-			{
-			case JREAD_NUMBER:
-				pQuery = jRead_atoi((char *)pQuery, &index); // index value
-				break;
-			case JREAD_QPARAM:
-				pQuery++;
-				index = (queryParams != NULL) ? *queryParams++ : 0; // substitute parameter
-				break;
-			default:
-				pResult->error = 12; // Bad Object key
-				return pJson;
-			}
-			return getObjectLength(pJson, pResult, index);
+			pResult->error = 1; // JSON does not match Query
+			return pJson;
 		}
 
-		pQuery = getElementString(pQuery, &qElement, QUERY_QUOTE); // qElement = query 'key'
-		//
-		// read <key> : <value> , ... }
-		// loop 'til key matched
-		//
-		while (1)
+		switch (jTok)
 		{
-			pJson = getElementString(++pJson, &jElement, '\"');
-			if (jElement.dataType != JREAD_STRING)
-			{
-				pResult->error = 3; // Expected "key"
-				break;
-			}
-			pJson = findTok(pJson, &jTok);
-			if (jTok != JREAD_COLON)
-			{
-				pResult->error = 4; // Expected ":"
-				break;
-			}
-			// compare object keys
-			if (equalElement(&qElement, &jElement) == 0)
+		case JREAD_ERROR:		// general error, eof etc.
+			pResult->error = 2; // Error reading JSON value
+			break;
+
+		case JREAD_OBJECT: // "{"
+			if (qTok == JREAD_EOL)
+				return toEnd ? getObjectLength(pJson, pResult, -1, pContext) : pJson; // return length of object
+
+			pQuery = findTok(++pQuery, &qTok); // "('key'...", "{NUMBER", "{*" or EOL
+			if (qTok != JREAD_STRING)
 			{
-				// found object key
-				return getElement(++pJson, pQuery, queryParams, pResult);
+				index = 0;
+				switch (qTok)
+				{
+				case JREAD_NUMBER:
+					pQuery = jRead_atoi((char *)pQuery, &index); // index value
+					break;
+				case JREAD_QPARAM:
+					pQuery++;
+					index = (queryParams != NULL) ? *queryParams++ : 0; // substitute parameter
+					break;
+				default:
+					pResult->error = 12; // Bad Object key
+					return pJson;
+				}
+				return getObjectLength(pJson, pResult, index, pContext);
 			}
-			// no key match... skip this value
-			pJson = getElement(++pJson, "", NULL, pResult);
-			pJson = findTok(pJson, &jTok);
-			if (jTok == JREAD_EOBJECT)
+
+			pQuery = getElementString(pQuery, &qElement, QUERY_QUOTE); // qElement = query 'key'
+			if (qElement.dataType != JREAD_STRING)
+				qElement.pValue = NULL; // matches no key
+			hash = ((qElement.pValue != NULL) && (pContext != NULL) && (pContext->pSlots != NULL)) ? hashKey((const char *)qElement.pValue, qElement.bytelen) : 0;
+			pJson = findObjectKey(pJson, (const char *)qElement.pValue, qElement.bytelen, hash, pResult, pContext);
+			if (!pResult->error)
+				continue; // found object key
+			break;
+		case JREAD_ARRAY: // "[NUMBER" or "[*"
+			//
+			// read index, skip values 'til index
+			//
+			if (qTok == JREAD_EOL)
+				return toEnd ? getContainerLength(pJson, pResult, pContext) : pJson; // return length of array
+
+			index = 0;
+			pQuery = findTok(++pQuery, &qTok); // "[NUMBER" or "[*"
+			if (qTok == JREAD_NUMBER)
 			{
-				pResult->error = 5; // Object key not found
-				break;
+				pQuery = jRead_atoi(pQuery, &index); // get array index
 			}
-			if (jTok != JREAD_COMMA)
+			else if (qTok == JREAD_QPARAM)
 			{
-				pResult->error = 6; // Expected "," in object
-				break;
+				pQuery++;
+				index = (queryParams != NULL) ? *queryParams++ : 0; // substitute parameter
 			}
-		}
-		break;
-	case JREAD_ARRAY: // "[NUMBER" or "[*"
-		//
-		// read index, skip values 'til index
-		//
-		if (qTok == JREAD_EOL)
-			return getArrayLength(pJson, pResult); // return length of object
 
-		index = 0;
-		pQuery = findTok(++pQuery, &qTok); // "[NUMBER" or "[*"
-		if (qTok == JREAD_NUMBER)
-		{
-			pQuery = jRead_atoi(pQuery, &index); // get array index
+			pJson = findArrayIndex(pJson, index, pResult, pContext);
+			if (!pResult->error)
+				continue; // return value at index
+			break;
+		case JREAD_STRING: // "string"
+			pJson = getElementString(pJson, pResult, '\"', pEnd);
+			break;
+		case JREAD_NUMBER: // number (may be -ve) int or float
+		case JREAD_BOOL:   // true or false
+		case JREAD_NULL:   // null
+			bytelen = getElementStringLenght(pJson, pEnd);
+			pResult->dataType = jTok;
+			pResult->bytelen = bytelen;
+			pResult->pValue = pJson;
+			pResult->elements = 1;
+			pJson += bytelen;
+			break;
+		default:
+			pResult->error = 8; // unexpected character (in pResult->dataType)
 		}
-		else if (qTok == JREAD_QPARAM)
+		// We get here on a 'terminal value'
+		// - make sure the query string is empty also
+		pQuery = findTok(pQuery, &qTok);
+		if (!pResult->error && (qTok != JREAD_EOL))
+			pResult->error = 7; // terminal value found before end of query
+		if (pResult->error)
 		{
-			pQuery++;
-			index = (queryParams != NULL) ? *queryParams++ : 0; // substitute parameter
+			pResult->dataType = JREAD_ERROR;
+			pResult->elements = pResult->bytelen = 0;
+			pResult->pValue = pJson; // return pointer into JSON at error point
 		}
+		return pJson;
+	}
+}
 
-		count = 0;
-		while (1)
+// findObjectKey
+// - on entry pJson -> "{... "
+// - reads <key> : <value> , ... } 'til key matched, skipping unmatched values
+// - key = NULL matches no key
+// - hash is hashKey() of key, only read when the object has a key table
+//   (compiled steps keep it in Query::Step::hash)
+//
+// returns: pointer into pJson after the ':' of the matched key
+//			pResult->error set if key not found or JSON error
+//
+const char *Json::findObjectKey(const char *pJson, const char *key, size_t keyLen, unsigned int hash, struct ReadElement *pResult, const ReadContext *pContext)
+{
+	struct ReadElement jElement;
+	IndexEntry *pEntry;
+	const KeySlot *pTable, *pSlot;
+	unsigned int mask;
+	int jTok;
+	const char *pEnd = contextEnd(pContext);
+
+	// wide object with a key table: one hash, compares only on equal hashes
+	if ((key != NULL) && (pContext != NULL) && (pContext->pSlots != NULL) &&
+		((pEntry = findIndexEntry(pContext, pJson)) != NULL) && (pEntry->elements >= JREAD_WIDE_OBJECT) &&
+		((pTable = getKeyTable(pJson, pEntry, pContext)) != NULL))
+	{
+		for (mask = 2; mask < 2 * (unsigned int)pEntry->elements; mask <<= 1)
+			;
+		mask--;
+		for (pSlot = &pTable[hash & mask]; pSlot->key != 0; pSlot = &pTable[(pSlot - pTable + 1) & mask])
 		{
-			if (count == index)
-				return getElement(++pJson, pQuery, queryParams, pResult); // return value at index
-			// not this index... skip this value
-			pJson = getElement(++pJson, "", NULL, &jElement);
-			if (pResult->error)
-				break;
-			count++;
-			pJson = findTok(pJson, &jTok); // , or ]
-			if (jTok == JREAD_EARRAY)
-			{
-				pResult->error = 10; // Array element not found (bad index)
-				break;
-			}
-			if (jTok != JREAD_COMMA)
-			{
-				pResult->error = 9; // Expected "," in array
-				break;
-			}
+			if ((pSlot->hash == hash) && (pSlot->keyLen == keyLen) &&
+				(memcmp(pContext->pJson + pSlot->key, key, keyLen) == 0))
+				return pContext->pJson + pSlot->value;
 		}
-		break;
-	case JREAD_STRING: // "string"
-		pJson = getElementString(pJson, pResult, '\"');
-		break;
-	case JREAD_NUMBER: // number (may be -ve) int or float
-	case JREAD_BOOL:   // true or false
-	case JREAD_NULL:   // null
-		bytelen = getElementStringLenght(pJson);
-		pResult->dataType = jTok;
-		pResult->bytelen = bytelen;
-		pResult->pValue = pJson;
-		pResult->elements = 1;
-		pJson += bytelen;
-		break;
-	default:
-		pResult->error = 8; // unexpected character (in pResult->dataType)
+		pResult->error = 5; // Object key not found
+		return pContext->pJson + pEntry->close;
 	}
-	// We get here on a 'terminal value'
-	// - make sure the query string is empty also
-	pQuery = findTok(pQuery, &qTok);
-	if (!pResult->error && (qTok != JREAD_EOL))
-		pResult->error = 7; // terminal value found before end of query
-	if (pResult->error)
+	while (1)
 	{
-		pResult->dataType = JREAD_ERROR;
-		pResult->elements = pResult->bytelen = 0;
-		pResult->pValue = pJson; // return pointer into JSON at error point
+		pJson = getElementString(++pJson, &jElement, '\"', pEnd);
+		if (jElement.dataType != JREAD_STRING)
+		{
+			pResult->error = 3; // Expected "key"
+			break;
+		}
+		pJson = findTok(pJson, &jTok, pEnd);
+		if (jTok != JREAD_COLON)
+		{
+			pResult->error = 4; // Expected ":"
+			break;
+		}
+		// compare object keys
+		if ((key != NULL) && (jElement.bytelen == keyLen) && (memcmp(jElement.pValue, key, keyLen) == 0))
+			return ++pJson;
+		// no key match... skip this value
+		pJson = skipValue(++pJson, pContext);
+		pJson = findTok(pJson, &jTok, pEnd);
+		if (jTok == JREAD_EOBJECT)
+		{
+			pResult->error = 5; // Object key not found
+			break;
+		}
+		if (jTok != JREAD_COMMA)
+		{
+			pResult->error = 6; // Expected "," in object
+			break;
+		}
 	}
 	return pJson;
 }
 
-// Internal for reading
-const char *Json::skipWhitespace(const char *sp)
+// findArrayIndex
+// - on entry pJson -> "[... "
+// - skips values 'til index, a wide indexed array with an element table
+//   (see getElementTable()) is not read
+//
+// returns: pointer into pJson at the value at index
+//			pResult->error set if index not found or JSON error
+//
+const char *Json::findArrayIndex(const char *pJson, unsigned int index, struct ReadElement *pResult, const ReadContext *pContext)
 {
-	while ((*sp != '\0') && (*sp <= ' '))
-		sp++;
-	return sp;
+	unsigned int count = 0;
+	int jTok;
+	IndexEntry *pEntry;
+	const KeySlot *pTable;
+	const char *pEnd = contextEnd(pContext);
+
+	// wide array with an element table: element index is looked up
+	if ((pContext != NULL) && (pContext->pSlots != NULL) &&
+		((pEntry = findIndexEntry(pContext, pJson)) != NULL) && (pEntry->elements >= JREAD_WIDE_OBJECT) &&
+		((pTable = getElementTable(pJson, pEntry, pContext)) != NULL))
+	{
+		if (index < (unsigned int)pEntry->elements)
+			return pContext->pJson + pTable[index].value;
+		pResult->error = 10; // Array element not found (bad index)
+		return pContext->pJson + pEntry->close;
+	}
+	while (1)
+	{
+		if (count == index)
+			return ++pJson;
+		// not this index... skip this value
+		pJson = skipValue(++pJson, pContext);
+		count++;
+		pJson = findTok(pJson, &jTok, pEnd); // , or ]
+		if (jTok == JREAD_EARRAY)
+		{
+			pResult->error = 10; // Array element not found (bad index)
+			break;
+		}
+		if (jTok != JREAD_COMMA)
+		{
+			pResult->error = 9; // Expected "," in array
+			break;
+		}
+	}
+	return pJson;
 }
 
-// Find start of a token
-// - returns pointer to start of next token or element
-//   returns type via tokType
+//------------------------------------------------------
+// Compiled queries
+//------------------------------------------------------
+
+// hashKey
+// - FNV-1a hash of key text
 //
-const char *Json::findTok(const char *sp, int *tokType)
+unsigned int Json::hashKey(const char *key, int keyLen)
 {
-	char c;
-	sp = skipWhitespace(sp);
-	c = *sp;
-	if (c == '\0')
-		*tokType = JREAD_EOL;
-	else if ((c == '"') || (c == QUERY_QUOTE))
-		*tokType = JREAD_STRING;
-	else if ((c >= '0') && (c <= '9'))
-		*tokType = JREAD_NUMBER;
-	else if (c == '-')
-		*tokType = JREAD_NUMBER;
-	else if (c == '{')
-		*tokType = JREAD_OBJECT;
-	else if (c == '[')
-		*tokType = JREAD_ARRAY;
-	else if (c == '}')
-		*tokType = JREAD_EOBJECT;
-	else if (c == ']')
-		*tokType = JREAD_EARRAY;
-	else if ((c == 't') || (c == 'f'))
-		*tokType = JREAD_BOOL;
-	else if (c == 'n')
-		*tokType = JREAD_NULL;
-	else if (c == ':')
-		*tokType = JREAD_COLON;
-	else if (c == ',')
-		*tokType = JREAD_COMMA;
-	else if (c == '*')
-		*tokType = JREAD_QPARAM;
-	else
-		*tokType = JREAD_ERROR;
-	return sp;
+	unsigned int hash = 2166136261u;
+	while (keyLen-- > 0)
+		hash = (hash ^ (unsigned char)*key++) * 16777619u;
+	return hash;
 }
 
-// getElementString
-// - assumes next element is "string" which may include "\" sequences
-// - returns pointer to -------------^
-// - pElem contains result ( JREAD_STRING, length, pointer to string)
-// - pass quote = '"' for Json, quote = '\'' for query scanning
-//
-// returns: pointer into pJson after the string (char after the " terminator)
-//			pElem contains pointer and length of string (or dataType=JREAD_ERROR)
-//
-const char *Json::getElementString(const char *pJson, struct ReadElement *pElem, char quote)
+Json::Query::Query(const char *pQuery) : steps(), count(0), params(0), keyBytes(0), keys(), error(0)
 {
-	short skipch;
-	pElem->dataType = JREAD_ERROR;
-	pElem->elements = 1;
-	pElem->bytelen = 0;
-	pJson = skipWhitespace(pJson);
-	if (*pJson == quote)
+	struct ReadElement qElement;
+	unsigned int index;
+	int qTok;
+
+	while (1)
 	{
-		pJson++;
-		pElem->pValue = pJson; // -> start of actual string
-		pElem->bytelen = 0;
-		skipch = 0;
-		while (*pJson != '\0')
+		pQuery = findTok(pQuery, &qTok);
+		if (qTok == JREAD_EOL)
+			break;
+		if ((count >= JREAD_QUERY_STEPS) || ((qTok != JREAD_OBJECT) && (qTok != JREAD_ARRAY)))
 		{
-			if (skipch)
-				skipch = 0;
-			else if (*pJson == '\\') //  "\" sequence
-				skipch = 1;
-			else if (*pJson == quote)
+			error = 15; // Bad query
+			return;
+		}
+		Step &step = steps[count++];
+		step.type = (qTok == JREAD_OBJECT) ? JREAD_QKEYINDEX : JREAD_QINDEX;
+		step.param = 0;
+		step.keyLen = 0;
+		step.hash = 0;
+		step.value = 0;
+		step.end = 0;
+
+		pQuery = findTok(++pQuery, &qTok); // "{'key'", "{NUMBER", "{*", "{*}", "[NUMBER", "[*", "[*]" or "[a:b]"
+		switch (qTok)
+		{
+		case JREAD_NUMBER:
+			pQuery = jRead_atoi(pQuery, &index);
+			step.value = index;
+			break;
+		case JREAD_QPARAM:
+			pQuery = findTok(++pQuery, &qTok);
+			if (qTok == ((step.type == JREAD_QINDEX) ? JREAD_EARRAY : JREAD_EOBJECT))
 			{
-				pElem->dataType = JREAD_STRING;
-				pJson++;
+				pQuery++; // "[*]" or "{*}"
+				step.type = (step.type == JREAD_QINDEX) ? JREAD_QSLICE : JREAD_QMEMBERS;
+				step.end = (step.type == JREAD_QSLICE) ? JREAD_QUERY_END : 0;
 				break;
 			}
-			pElem->bytelen++;
-			pJson++;
-		};
-	};
-	return pJson;
-}
+			step.param = 1;
+			step.value = params++;
+			break;
+		case JREAD_STRING:
+			if (step.type == JREAD_QINDEX)
+				break; // "[" without index is index 0
+			pQuery = getElementString(pQuery, &qElement, QUERY_QUOTE);
+			if ((qElement.dataType != JREAD_STRING) || (keyBytes + qElement.bytelen > JREAD_QUERY_KEYS))
+			{
+				error = 15; // Bad query
+				return;
+			}
+			memcpy(keys + keyBytes, qElement.pValue, qElement.bytelen);
+			step.type = JREAD_QKEY;
+			step.keyLen = qElement.bytelen;
+			step.hash = hashKey(keys + keyBytes, qElement.bytelen);
+			step.value = keyBytes;
+			keyBytes += qElement.bytelen;
+			break;
+		default:
+			if (step.type == JREAD_QINDEX)
+				break; // "[" without index is index 0
+			error = 12; // Bad object key
+			return;
+		}
 
-// getElementStringLenght
-// - used to identify length of element text
-// - returns no. of chars from pJson upto a terminator
-// - terminators: ' ' , } ]
-//
-int Json::getElementStringLenght(const char *pJson)
-{
-	int len = 0;
-	while ((*pJson > ' ') && // any ctrl char incl '\0'
-		   (*pJson != ',') &&
-		   (*pJson != '}') &&
-		   (*pJson != ']'))
-	{
-		len++;
-		pJson++;
+		// "[a:b]" slice, a and b may be left out
+		if ((step.type != JREAD_QINDEX) || step.param)
+			continue;
+		pQuery = findTok(pQuery, &qTok);
+		if (qTok != JREAD_COLON)
+			continue;
+		pQuery = findTok(++pQuery, &qTok);
+		step.end = JREAD_QUERY_END;
+		if (qTok == JREAD_NUMBER)
+		{
+			pQuery = jRead_atoi(pQuery, &index);
+			step.end = index;
+			pQuery = findTok(pQuery, &qTok);
+		}
+		if (qTok != JREAD_EARRAY)
+		{
+			error = 15; // Bad query
+			return;
+		}
+		pQuery++;
+		step.type = JREAD_QSLICE;
 	}
-	return len;
 }
 
-// compare two json elements
-// returns: 0 if they are identical strings, else 1
+// badQueryLiteral
+// - called by literal() for a bad query, not constexpr so a constexpr
+//   query fails to compile, at run time the query gets the error
 //
-int Json::equalElement(struct ReadElement *j1, struct ReadElement *j2)
+int Json::Query::badQueryLiteral(int error)
 {
-	int i;
-	if ((j1->dataType != JREAD_STRING) ||
-		(j2->dataType != JREAD_STRING) ||
-		(j1->bytelen != j2->bytelen))
-		return 1;
-
-	for (i = 0; i < j1->bytelen; i++)
-		if (((char *)(j1->pValue))[i] != ((char *)(j2->pValue))[i])
-			return 1;
-	return 0;
+	return error;
 }
 
-//--------------------------------------------------------------------
-// Optional helper functions
-//--------------------------------------------------------------------
-
-ReadError Json::getValue(const char *pQuery, long &value)
+int Json::Query::getError() const
 {
-	return getValue(buffer, pQuery, NULL, &value);
+	return error;
 }
 
-ReadError Json::getValue(const char *pQuery, int *queryParams, long &value)
-{
-	return getValue(buffer, pQuery, queryParams, &value);
-}
-ReadError Json::getValue(const char *pJson, const char *pQuery, int *queryParams, long *value)
+bool Json::Query::operator==(const Query &query) const
 {
-	struct ReadElement elem;
-	getElement(pJson, pQuery, queryParams, &elem);
-	if ((elem.dataType == JREAD_ERROR) || (elem.dataType == JREAD_NULL))
+	int i;
+
+	if ((count != query.count) || (params != query.params) || (keyBytes != query.keyBytes) || (error != query.error) ||
+		(memcmp(keys, query.keys, keyBytes) != 0))
+		return false;
+	for (i = 0; i < count; i++)
 	{
-		return ReadError::JS_ERROR;
+		const Step &a = steps[i], &b = query.steps[i];
+		if ((a.type != b.type) || (a.param != b.param) || (a.keyLen != b.keyLen) || (a.hash != b.hash) ||
+			(a.value != b.value) || (a.end != b.end))
+			return false;
 	}
-	else if (elem.dataType == JREAD_BOOL)
+	return true;
+}
+
+// getElement for a compiled query
+// - same traversal and results as for the query string it was compiled from
+//
+const char *Json::getElement(const char *pJson, const Query &query, int *queryParams, struct ReadElement *pResult, const ReadContext *pContext)
+{
+	const Query::Step *pStep = query.steps;
+	const Query::Step *pLast = query.steps + query.count;
+	unsigned int index;
+	int jTok;
+	const char *pEnd = contextEnd(pContext);
+
+	if (query.error)
 	{
-		*value = *((char *)elem.pValue) == 't' ? 1 : 0;
+		pResult->dataType = JREAD_ERROR;
+		pResult->elements = pResult->bytelen = 0;
+		pResult->pValue = pJson;
+		pResult->error = query.error;
+		return pJson;
 	}
-	else
+	for (; pStep < pLast; pStep++)
 	{
-		jRead_atol((char *)elem.pValue, value);
+		pJson = findTok(pJson, &jTok, pEnd);
+		pResult->dataType = jTok;
+		pResult->bytelen = pResult->elements = pResult->error = 0;
+		pResult->pValue = pJson;
+		if ((pStep->type == JREAD_QMEMBERS) || (pStep->type == JREAD_QSLICE))
+		{
+			pResult->dataType = JREAD_ERROR;
+			pResult->error = 15; // Bad query, wildcards match many values (see getMatches())
+			return pJson;
+		}
+		if (jTok != ((pStep->type == JREAD_QINDEX) ? JREAD_ARRAY : JREAD_OBJECT))
+		{
+			pResult->error = 1; // JSON does not match Query
+			return pJson;
+		}
+		index = pStep->value;
+		if (pStep->param)
+			index = (queryParams != NULL) ? queryParams[index] : 0; // substitute parameter
+
+		switch (pStep->type)
+		{
+		case JREAD_QKEY:
+			pJson = findObjectKey(pJson, query.keys + pStep->value, pStep->keyLen, pStep->hash, pResult, pContext);
+			break;
+		case JREAD_QINDEX:
+			pJson = findArrayIndex(pJson, index, pResult, pContext);
+			break;
+		default:
+			return getObjectLength(pJson, pResult, index, pContext); // "key" at index
+		}
+		if (pResult->error)
+		{
+			pResult->dataType = JREAD_ERROR;
+			pResult->elements = pResult->bytelen = 0;
+			pResult->pValue = pJson; // return pointer into JSON at error point
+			return pJson;
+		}
 	}
-	return ReadError::JS_OK;
+	return getElement(pJson, "", NULL, pResult, pContext);
+}
+
+const char *Json::getElement(const Query &query, int *queryParams, struct ReadElement &pResult)
+{
+	return getElement(readContext.pJson, query, queryParams, &pResult, &readContext);
+}
+
+const char *Json::getElement(const char *pJson, const Query &query, int *queryParams, struct ReadElement *pResult)
+{
+	return getElement(pJson, query, queryParams, pResult, NULL);
+}
+
+//------------------------------------------------------
+// Relative queries
+//------------------------------------------------------
+
+// relativeRoot
+// - JSON text of an object/array element to use as root of a query
+// - NULL and pResult set to error if root is not an object or array
+//
+const char *Json::relativeRoot(const struct ReadElement &root, struct ReadElement *pResult)
+{
+	if (((root.dataType == JREAD_OBJECT) || (root.dataType == JREAD_ARRAY)) && (root.pValue != NULL))
+		return (const char *)root.pValue;
+	pResult->dataType = JREAD_ERROR;
+	pResult->elements = 0;
+	pResult->bytelen = 0;
+	pResult->pValue = NULL;
+	pResult->error = 1; // JSON does not match Query
+	return NULL;
+}
+
+const char *Json::getElement(const struct ReadElement &root, const char *pQuery, int *queryParams, struct ReadElement &pResult)
+{
+	const char *pJson = relativeRoot(root, &pResult);
+	if (pJson == NULL)
+		return NULL;
+	return getElement(pJson, pQuery, queryParams, &pResult, &readContext);
+}
+
+const char *Json::getElement(const struct ReadElement &root, const Query &query, int *queryParams, struct ReadElement &pResult)
+{
+	const char *pJson = relativeRoot(root, &pResult);
+	if (pJson == NULL)
+		return NULL;
+	return getElement(pJson, query, queryParams, &pResult, &readContext);
+}
+
+//------------------------------------------------------
+// Batch queries
+//------------------------------------------------------
+
+Json::Batch::Batch() : fields(), nodes(), fieldCount(0), nodeCount(1), keyBytes(0), keys(), pending(0)
+{
+	nodes[0].parent = nodes[0].child = nodes[0].sibling = nodes[0].field = -1;
+	nodes[0].fields = nodes[0].pending = nodes[0].visited = 0;
+}
+
+int Json::Batch::add(const char *pQuery, long &value)
+{
+	return addField(pQuery, BATCH_LONG, &value, 0);
+}
+
+int Json::Batch::add(const char *pQuery, int &value)
+{
+	return addField(pQuery, BATCH_INT, &value, 0);
+}
+
+int Json::Batch::add(const char *pQuery, double &value)
+{
+	return addField(pQuery, BATCH_DOUBLE, &value, 0);
+}
+
+int Json::Batch::add(const char *pQuery, bool &value)
+{
+	return addField(pQuery, BATCH_BOOL, &value, 0);
+}
+
+int Json::Batch::add(const char *pQuery, char *pDest, int destlen)
+{
+	return addField(pQuery, BATCH_STRING, pDest, destlen);
+}
+
+int Json::Batch::add(const char *pQuery, struct ReadElement &value)
+{
+	return addField(pQuery, BATCH_ELEMENT, &value, 0);
+}
+
+ReadError Json::Batch::result(int field) const
+{
+	if ((field < 0) || (field >= fieldCount))
+		return ReadError::JS_ERROR;
+	return fields[field].result;
+}
+
+// addField
+// - compiles the query and adds its steps to the prefix tree,
+//   steps equal to an existing child of a node share that child
+//
+int Json::Batch::addField(const char *pQuery, FieldType type, void *pDest, int destlen)
+{
+	Query query(pQuery);
+	int node = 0;
+	int i, child;
+
+	if (query.error || query.params || (fieldCount >= JREAD_BATCH_FIELDS))
+		return -1;
+	for (i = 0; i < query.count; i++)
+	{
+		const Query::Step &step = query.steps[i];
+		const char *key = query.keys + step.value;
+		if ((step.type == JREAD_QMEMBERS) || (step.type == JREAD_QSLICE))
+			return -1; // one value per field
+		for (child = nodes[node].child; child >= 0; child = nodes[child].sibling)
+		{
+			const Query::Step &other = nodes[child].step;
+			if ((other.type == step.type) &&
+				((step.type == JREAD_QKEY) ? ((other.keyLen == step.keyLen) && (other.hash == step.hash) &&
+											  (memcmp(keys + other.value, key, step.keyLen) == 0))
+										   : (other.value == step.value)))
+				break;
+		}
+		if (child < 0)
+		{
+			if ((nodeCount >= JREAD_BATCH_NODES) ||
+				((step.type == JREAD_QKEY) && (keyBytes + step.keyLen > JREAD_BATCH_KEYS)))
+				return -1;
+			child = nodeCount++;
+			nodes[child].step = step;
+			if (step.type == JREAD_QKEY)
+			{
+				memcpy(keys + keyBytes, key, step.keyLen);
+				nodes[child].step.value = keyBytes;
+				keyBytes += step.keyLen;
+			}
+			nodes[child].parent = node;
+			nodes[child].child = nodes[child].field = -1;
+			nodes[child].sibling = nodes[node].child;
+			nodes[child].fields = nodes[child].pending = nodes[child].visited = 0;
+			nodes[node].child = child;
+		}
+		node = child;
+		if (step.type == JREAD_QKEYINDEX)
+			break; // "key" at index ends the query
+	}
+
+	fields[fieldCount].type = type;
+	fields[fieldCount].pDest = pDest;
+	fields[fieldCount].destlen = destlen;
+	fields[fieldCount].next = nodes[node].field;
+	fields[fieldCount].result = ReadError::JS_ERROR;
+	nodes[node].field = fieldCount;
+	for (; node >= 0; node = nodes[node].parent)
+		nodes[node].fields++;
+	return fieldCount++;
+}
+
+// found
+// - stores pElem in all fields ending at node
+//
+void Json::Batch::found(int node, struct ReadElement *pElem)
+{
+	int field, count = 0;
+	for (field = nodes[node].field; field >= 0; field = fields[field].next, count++)
+	{
+		Field &f = fields[field];
+		switch (f.type)
+		{
+		case BATCH_LONG:
+			f.result = readValue(pElem, (long *)f.pDest);
+			break;
+		case BATCH_INT:
+			f.result = readValue(pElem, (int *)f.pDest);
+			break;
+		case BATCH_DOUBLE:
+			f.result = readValue(pElem, (double *)f.pDest);
+			break;
+		case BATCH_BOOL:
+			f.result = readValue(pElem, (bool *)f.pDest);
+			break;
+		case BATCH_STRING:
+			*(char *)f.pDest = '\0';
+			f.result = readValue(pElem, (char *)f.pDest, f.destlen);
+			break;
+		case BATCH_ELEMENT:
+			*(struct ReadElement *)f.pDest = *pElem;
+			f.result = ((pElem->dataType == JREAD_ERROR) || pElem->error) ? ReadError::JS_ERROR : ReadError::JS_OK;
+			break;
+		}
+	}
+	pending -= count;
+	for (; node >= 0; node = nodes[node].parent)
+		nodes[node].pending -= count;
+}
+
+// getBatchValue
+// - on entry pJson -> value matched by node
+// - reads the value once, matching members/elements against the children of node
+// - members/elements not matched are skipped, once all fields of node are
+//   found the rest of the value is skipped to its end by skipRest()
+// - a node that is a field and has children gets the element delimited by
+//   reading its members/elements, the value is not read again for the field
+//
+// returns: pointer into pJson after the value
+//			NULL when all fields of the batch are found
+//
+const char *Json::getBatchValue(const char *pJson, Batch &batch, int node, const ReadContext *pContext)
+{
+	struct ReadElement jElement;
+	Batch::Node *pNode = &batch.nodes[node];
+	const char *pValue, *pOpen;
+	unsigned int count, hash;
+	int jTok, child, hashed, isObject;
+	const char *pEnd = contextEnd(pContext);
+
+	pJson = findTok(pJson, &jTok, pEnd);
+	if (((jTok != JREAD_OBJECT) && (jTok != JREAD_ARRAY)) || (pNode->child < 0))
+	{
+		if (pNode->field < 0)
+			return skipValue(pJson, pContext); // children can not match
+		pValue = getElement(pJson, "", NULL, &jElement, pContext);
+		batch.found(node, &jElement);
+		return (batch.pending == 0) ? NULL : pValue;
+	}
+	isObject = (jTok == JREAD_OBJECT);
+	pOpen = pJson;
+	findTok(pJson + 1, &jTok, pEnd);
+	if ((jTok == JREAD_EOBJECT) || (jTok == JREAD_EARRAY))
+	{
+		pJson = findTok(pJson + 1, &jTok, pEnd) + 1; // empty
+		count = 0;
+	}
+	else
+	{
+		for (count = 0;; count++)
+		{
+			child = -1;
+			if (isObject)
+			{
+				pJson = getElementString(++pJson, &jElement, '\"', pEnd);
+				if (jElement.dataType != JREAD_STRING)
+					return pJson; // Expected "key"
+				pJson = findTok(pJson, &jTok, pEnd);
+				if (jTok != JREAD_COLON)
+					return pJson; // Expected ":"
+				pJson++;
+				hashed = 0;
+				hash = 0;
+				for (int c = (pNode->pending > 0) ? pNode->child : -1; c >= 0; c = batch.nodes[c].sibling)
+				{
+					Batch::Node &n = batch.nodes[c];
+					if (n.visited || (n.pending == 0))
+						continue;
+					if ((n.step.type == JREAD_QKEYINDEX) && (n.step.value == count))
+					{
+						// "key" at index
+						n.visited = 1;
+						jElement.dataType = JREAD_KEY;
+						batch.found(c, &jElement);
+						if (batch.pending == 0)
+							return NULL;
+					}
+					else if ((n.step.type == JREAD_QKEY) && (child < 0) && (n.step.keyLen == jElement.bytelen))
+					{
+						if (!hashed)
+						{
+							hash = hashKey((const char *)jElement.pValue, jElement.bytelen);
+							hashed = 1;
+						}
+						if ((n.step.hash == hash) &&
+							(memcmp(batch.keys + n.step.value, jElement.pValue, jElement.bytelen) == 0))
+							child = c; // keep looking for "key" at index
+					}
+				}
+			}
+			else
+			{
+				pJson++;
+				for (int c = (pNode->pending > 0) ? pNode->child : -1; c >= 0; c = batch.nodes[c].sibling)
+				{
+					if (!batch.nodes[c].visited && (batch.nodes[c].step.type == JREAD_QINDEX) && (batch.nodes[c].step.value == count))
+					{
+						child = c;
+						break;
+					}
+				}
+			}
+
+			if (child >= 0)
+			{
+				batch.nodes[child].visited = 1;
+				pJson = getBatchValue(pJson, batch, child, pContext);
+				if (pJson == NULL)
+					return NULL;
+			}
+			else
+				pJson = skipValue(pJson, pContext);
+			if (pNode->pending == 0)
+			{
+				pJson = skipRest(pOpen, pJson, pContext); // all fields of node found
+				break;
+			}
+			pJson = findTok(pJson, &jTok, pEnd);
+			if ((jTok == JREAD_EOBJECT) || (jTok == JREAD_EARRAY))
+			{
+				pJson++;
+				count++;
+				break;
+			}
+			if (jTok != JREAD_COMMA)
+				return pJson; // Expected ","
+		}
+	}
+	if (pNode->field >= 0)
+	{
+		// the value delimited above, as returned by getElement()
+		jElement.dataType = isObject ? JREAD_OBJECT : JREAD_ARRAY;
+		jElement.pValue = pOpen;
+		jElement.bytelen = pJson - pOpen;
+		jElement.elements = (int)count;
+		jElement.error = 0;
+		batch.found(node, &jElement);
+		if (batch.pending == 0)
+			return NULL;
+	}
+	return pJson;
+}
+
+int Json::getValues(const char *pJson, Batch &batch, const ReadContext *pContext)
+{
+	int i;
+	for (i = 0; i < batch.fieldCount; i++)
+		batch.fields[i].result = ReadError::JS_ERROR;
+	for (i = 0; i < batch.nodeCount; i++)
+	{
+		batch.nodes[i].pending = batch.nodes[i].fields;
+		batch.nodes[i].visited = 0;
+	}
+	batch.pending = batch.fieldCount;
+	if (batch.pending)
+		getBatchValue(pJson, batch, 0, pContext);
+	return batch.fieldCount - batch.pending;
+}
+
+int Json::getValues(Batch &batch)
+{
+	return getValues(readContext.pJson, batch, &readContext);
+}
+
+int Json::getValues(const char *pJson, Batch &batch)
+{
+	return getValues(pJson, batch, NULL);
+}
+
+ReadError Json::getValue(const struct ReadElement &element, long &value)
+{
+	struct ReadElement elem = element;
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const struct ReadElement &element, int &value)
+{
+	struct ReadElement elem = element;
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const struct ReadElement &element, long long &value)
+{
+	struct ReadElement elem = element;
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const struct ReadElement &element, unsigned long &value)
+{
+	struct ReadElement elem = element;
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const struct ReadElement &element, unsigned long long &value)
+{
+	struct ReadElement elem = element;
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const struct ReadElement &element, double &value)
+{
+	struct ReadElement elem = element;
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const struct ReadElement &element, bool &value)
+{
+	struct ReadElement elem = element;
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const struct ReadElement &element, char *pDest, int destlen)
+{
+	struct ReadElement elem = element;
+	return readValue(&elem, pDest, destlen);
+}
+
+//------------------------------------------------------
+// Wildcard queries
+//------------------------------------------------------
+
+// Matcher
+// - state of one getMatches(), indexes[n] is the element/member taken by
+//   the n'th [*], {*} or [a:b] step of the value being matched
+//
+struct Json::Matcher
+{
+	const Query &query;
+	int *queryParams;
+	MatchHandler handler;
+	void *pUser;
+	Match match;
+	unsigned int indexes[JREAD_QUERY_STEPS];
+	int count;	// values matched
+	int error;	// JSON error, 0 if none
+	bool stopped; // handler returned false
+
+	Matcher(const Query &query, int *queryParams, MatchHandler handler, void *pUser)
+		: query(query), queryParams(queryParams), handler(handler), pUser(pUser), match(), indexes(), count(0), error(0), stopped(false)
+	{
+		match.key.dataType = JREAD_ERROR;
+		match.pIndexes = indexes;
+	}
+
+	// found
+	// - passes match to the handler, false if it stopped
+	//
+	bool found()
+	{
+		count++;
+		stopped = !handler(match, pUser);
+		return !stopped;
+	}
+
+private:
+	Matcher(const Matcher &);			 // not copyable
+	Matcher &operator=(const Matcher &); // not copyable
+};
+
+// skipRest
+// - pJson inside the object/array opened at pOpen, after a value or key
+// - the end is looked up with an index, else found by jScanSkip()
+//
+// returns: pointer into pJson after the closing '}' or ']'
+//
+const char *Json::skipRest(const char *pOpen, const char *pJson, const ReadContext *pContext)
+{
+	const IndexEntry *pEntry = findIndexEntry(pContext, pOpen);
+	const char *pEnd = contextEnd(pContext);
+	if (pEntry != NULL)
+		return pOpen + (pEntry->close - pEntry->open + 1);
+	pJson = jScanSkip(pJson, pEnd);
+	return ((pJson != pEnd) && (*pJson != '\0')) ? pJson + 1 : pJson;
+}
+
+// matchValue
+// - on entry pJson -> value matched by the steps before step
+// - key and index steps find their member/element as getElement(), [*], {*}
+//   and [a:b] steps read the array/object once, running the steps after
+//   them on each element/member taken
+// - a value not matching the step (not found, other type) is not a match
+// - toEnd: the value is in an array/object read by a wildcard step, after
+//   a key or index step the rest of the value is skipped by skipRest() so
+//   the caller reads on after it, each value is read once
+//
+// returns: pointer into pJson after the value (if toEnd), NULL if the
+//			handler stopped or on a JSON error (matcher.error set)
+//
+const char *Json::matchValue(const char *pJson, int step, int wildcards, bool toEnd, Matcher &matcher, const ReadContext *pContext)
+{
+	struct ReadElement result;
+	const char *pOpen;
+	unsigned int index, n;
+	int jTok;
+	const char *pEnd = contextEnd(pContext);
+
+	pJson = findTok(pJson, &jTok, pEnd);
+	if ((jTok == JREAD_ERROR) || (jTok > JREAD_NULL))
+	{
+		matcher.error = 2; // Error reading JSON value
+		return NULL;
+	}
+	if (step == matcher.query.count)
+	{
+		pJson = getElement(pJson, "", NULL, &matcher.match.value, pContext);
+		if (matcher.match.value.error)
+		{
+			matcher.error = matcher.match.value.error;
+			return NULL;
+		}
+		return matcher.found() ? pJson : NULL;
+	}
+
+	const Query::Step &qStep = matcher.query.steps[step];
+	if (jTok != (((qStep.type == JREAD_QINDEX) || (qStep.type == JREAD_QSLICE)) ? JREAD_ARRAY : JREAD_OBJECT))
+		return toEnd ? skipValue(pJson, pContext) : pJson;
+	pOpen = pJson;
+	findTok(pJson + 1, &jTok, pEnd);
+	if ((jTok == JREAD_EOBJECT) || (jTok == JREAD_EARRAY))
+		return findTok(pJson + 1, &jTok, pEnd) + 1; // empty, nothing matched
+	index = qStep.value;
+	if (qStep.param)
+		index = (matcher.queryParams != NULL) ? matcher.queryParams[index] : 0; // substitute parameter
+	result.error = 0;
+
+	switch (qStep.type)
+	{
+	case JREAD_QKEY:
+		pJson = findObjectKey(pJson, matcher.query.keys + qStep.value, qStep.keyLen, qStep.hash, &result, pContext);
+		if (result.error == 0)
+			pJson = matchValue(pJson, step + 1, wildcards, toEnd, matcher, pContext);
+		else if (result.error != 5) // Object key not found
+			pJson = NULL;
+		break;
+	case JREAD_QINDEX:
+		pJson = findArrayIndex(pJson, index, &result, pContext);
+		if (result.error == 0)
+			pJson = matchValue(pJson, step + 1, wildcards, toEnd, matcher, pContext);
+		else if (result.error != 10) // Array element not found
+			pJson = NULL;
+		break;
+	case JREAD_QKEYINDEX:
+		pJson = getObjectLength(pJson, &matcher.match.value, index, pContext); // "key" at index ends the query
+		if (matcher.match.value.error == 0)
+			pJson = matcher.found() ? pJson : NULL;
+		else if ((result.error = matcher.match.value.error) != 11) // Object key not found (bad index)
+			pJson = NULL;
+		break;
+	case JREAD_QMEMBERS:
+		for (n = 0;; n++)
+		{
+			pJson = getElementString(pJson + 1, &matcher.match.key, '\"', pEnd);
+			if (matcher.match.key.dataType != JREAD_STRING)
+			{
+				matcher.error = 3; // Expected "key"
+				return NULL;
+			}
+			matcher.match.key.dataType = JREAD_KEY;
+			pJson = findTok(pJson, &jTok, pEnd);
+			if (jTok != JREAD_COLON)
+			{
+				matcher.error = 4; // Expected ":"
+				return NULL;
+			}
+			matcher.indexes[wildcards] = n;
+			pJson = matchValue(pJson + 1, step + 1, wildcards + 1, true, matcher, pContext);
+			if (pJson == NULL)
+				return NULL;
+			pJson = findTok(pJson, &jTok, pEnd);
+			if (jTok == JREAD_EOBJECT)
+				return pJson + 1;
+			if (jTok != JREAD_COMMA)
+			{
+				matcher.error = 6; // Expected "," in object
+				return NULL;
+			}
+		}
+	default: // JREAD_QSLICE
+		pJson = findArrayIndex(pJson, qStep.value, &result, pContext);
+		if (result.error != 0)
+		{
+			if (result.error != 10) // Array element not found, fewer than a elements
+				pJson = NULL;
+			break;
+		}
+		for (n = qStep.value; n < qStep.end; n++)
+		{
+			matcher.indexes[wildcards] = n;
+			pJson = matchValue(pJson, step + 1, wildcards + 1, true, matcher, pContext);
+			if (pJson == NULL)
+				return NULL;
+			pJson = findTok(pJson, &jTok, pEnd);
+			if (jTok == JREAD_EARRAY)
+				return pJson + 1;
+			if (jTok != JREAD_COMMA)
+			{
+				matcher.error = 9; // Expected "," in array
+				return NULL;
+			}
+			pJson++;
+		}
+		break;
+	}
+	if (pJson == NULL)
+	{
+		if (!matcher.stopped && (matcher.error == 0))
+			matcher.error = result.error;
+		return NULL;
+	}
+	return toEnd ? skipRest(pOpen, pJson, pContext) : pJson;
+}
+
+int Json::getMatches(const char *pJson, const Query &query, int *queryParams, MatchHandler handler, void *pUser, const ReadContext *pContext)
+{
+	Matcher matcher(query, queryParams, handler, pUser);
+	if (query.error)
+		return -1;
+	if ((matchValue(pJson, 0, 0, false, matcher, pContext) == NULL) && !matcher.stopped)
+		return -1;
+	return matcher.count;
+}
+
+// MatchResults
+// - destination of getMatches() into an array, see storeMatch()
+//
+struct MatchResults
+{
+	struct ReadElement *pResults;
+	int maxResults;
+	int count;
+};
+
+static bool storeMatch(const Json::Match &match, void *pUser)
+{
+	MatchResults *pStore = (MatchResults *)pUser;
+	pStore->pResults[pStore->count++] = match.value;
+	return pStore->count < pStore->maxResults;
+}
+
+int Json::getMatches(const Query &query, int *queryParams, MatchHandler handler, void *pUser)
+{
+	return getMatches(readContext.pJson, query, queryParams, handler, pUser, &readContext);
+}
+
+int Json::getMatches(const Query &query, int *queryParams, struct ReadElement *pResults, int maxResults)
+{
+	MatchResults store = {pResults, maxResults, 0};
+	if (maxResults <= 0)
+		return 0;
+	return getMatches(readContext.pJson, query, queryParams, storeMatch, &store, &readContext);
+}
+
+int Json::getMatches(const char *pJson, const Query &query, int *queryParams, MatchHandler handler, void *pUser)
+{
+	return getMatches(pJson, query, queryParams, handler, pUser, NULL);
+}
+
+int Json::getMatches(const char *pJson, const Query &query, int *queryParams, struct ReadElement *pResults, int maxResults)
+{
+	MatchResults store = {pResults, maxResults, 0};
+	if (maxResults <= 0)
+		return 0;
+	return getMatches(pJson, query, queryParams, storeMatch, &store, NULL);
+}
+
+int Json::getMatches(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, MatchHandler handler, void *pUser)
+{
+	const ReadContext context = {pJson + jsonLen, NULL, NULL, 0, NULL, 0, 0};
+	return getMatches(pJson, query, queryParams, handler, pUser, &context);
+}
+
+int Json::getMatches(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, struct ReadElement *pResults, int maxResults)
+{
+	const ReadContext context = {pJson + jsonLen, NULL, NULL, 0, NULL, 0, 0};
+	MatchResults store = {pResults, maxResults, 0};
+	if (maxResults <= 0)
+		return 0;
+	return getMatches(pJson, query, queryParams, storeMatch, &store, &context);
+}
+
+//------------------------------------------------------
+// Struct binding
+//------------------------------------------------------
+
+#define BIND_SEEDS 1024 // seeds tried for each table size
+
+// bindSlot
+// - slot of a key: FNV-1a hash mixed with the seed, top bits of the product
+//
+static inline unsigned int bindSlot(unsigned int hash, unsigned int seed, unsigned int shift)
+{
+	return ((hash ^ seed) * 2654435761u) >> shift;
+}
+
+// Binding
+// - the table is the smallest power of 2 >= 2 * count slots that a seed
+//   places each key in its own slot, larger tables are tried 'til one is
+//   found, so a key read is looked up with one hash and one compare
+//
+Json::Binding::Binding(const BindField *pFields, int count) : pFields(pFields), count(count), seed(0), shift(0),
+															   keyLens(), slots(), error(0)
+{
+	unsigned int hashes[JREAD_BIND_FIELDS];
+	unsigned int size, bits, slot;
+	int i, j;
+
+	if ((count < 0) || (count > JREAD_BIND_FIELDS))
+	{
+		error = 15; // Bad query, too many fields
+		return;
+	}
+	for (i = 0; i < count; i++)
+	{
+		keyLens[i] = strlen(pFields[i].key);
+		hashes[i] = hashKey(pFields[i].key, (int)keyLens[i]);
+		for (j = 0; j < i; j++)
+		{
+			if ((keyLens[j] == keyLens[i]) && (memcmp(pFields[j].key, pFields[i].key, keyLens[i]) == 0))
+			{
+				error = 12; // Bad object key, same key twice
+				return;
+			}
+		}
+	}
+	for (size = 2, bits = 1; size < 2 * (unsigned int)count; size <<= 1, bits++)
+		;
+	for (; size <= JREAD_BIND_SLOTS; size <<= 1, bits++)
+	{
+		shift = 32 - bits;
+		for (seed = 0; seed < BIND_SEEDS; seed++)
+		{
+			memset(slots, -1, sizeof(slots));
+			for (i = 0; i < count; i++)
+			{
+				slot = bindSlot(hashes[i], seed, shift);
+				if (slots[slot] >= 0)
+					break;
+				slots[slot] = (signed char)i;
+			}
+			if (i == count)
+				return;
+		}
+	}
+	memset(slots, -1, sizeof(slots));
+	error = 15; // Bad query, no seed found
+}
+
+int Json::Binding::getError() const
+{
+	return error;
+}
+
+// find
+// - field of a key as read from JSON text, -1 if none
+//
+inline int Json::Binding::find(const char *pKey, size_t keyLen) const
+{
+	int field = slots[bindSlot(hashKey(pKey, (int)keyLen), seed, shift)];
+	if ((field < 0) || (keyLens[field] != keyLen) || (memcmp(pFields[field].key, pKey, keyLen) != 0))
+		return -1;
+	return field;
+}
+
+// readField
+// - converts an element to the member of a field, as readValue() / readString()
+//
+ReadError Json::readField(struct ReadElement *pElem, const BindField &field, void *pStruct)
+{
+	char *pMember = (char *)pStruct + field.offset;
+	switch (field.type)
+	{
+	case JBIND_INT:
+		return readValue(pElem, (int *)pMember);
+	case JBIND_LONG:
+		return readValue(pElem, (long *)pMember);
+	case JBIND_LLONG:
+		return readValue(pElem, (long long *)pMember);
+	case JBIND_DOUBLE:
+		return readValue(pElem, (double *)pMember);
+	case JBIND_BOOL:
+		return readValue(pElem, (bool *)pMember);
+	default:
+		return readString(pElem, pMember, field.size, NULL);
+	}
+}
+
+// decode
+// - members of the object are read once in order, each key is looked up
+//   in the binding, values of other keys are skipped by skipValue()
+// - objects and arrays are skipped, they do not convert to a member
+// - a member set twice (key repeated in the object) is counted once
+//
+int Json::decode(const char *pJson, const char *pQuery, const Binding &binding, void *pStruct, const ReadContext *pContext)
+{
+	struct ReadElement jElement;
+	unsigned int set = 0; // bit per field set
+	int jTok, field, count = 0;
+	const char *pEnd = contextEnd(pContext);
+
+	if (binding.error != 0)
+		return -1;
+	if (*pQuery != '\0')
+	{
+		getElement(pJson, pQuery, NULL, &jElement, pContext);
+		if (jElement.dataType != JREAD_OBJECT)
+			return -1;
+		pJson = (const char *)jElement.pValue;
+	}
+	pJson = findTok(pJson, &jTok, pEnd);
+	if (jTok != JREAD_OBJECT)
+		return -1;
+	pJson = findTok(pJson + 1, &jTok, pEnd);
+	if (jTok == JREAD_EOBJECT)
+		return 0;
+
+	for (;;)
+	{
+		pJson = getElementString(pJson, &jElement, '\"', pEnd);
+		if (jElement.dataType != JREAD_STRING)
+			break; // Expected "key"
+		field = binding.find((const char *)jElement.pValue, jElement.bytelen);
+		pJson = findTok(pJson, &jTok, pEnd);
+		if (jTok != JREAD_COLON)
+			break; // Expected ":"
+		pJson = findTok(pJson + 1, &jTok, pEnd);
+		if ((field < 0) || (jTok == JREAD_OBJECT) || (jTok == JREAD_ARRAY))
+			pJson = skipValue(pJson, pContext);
+		else
+		{
+			if (jTok == JREAD_STRING)
+				pJson = getElementString(pJson, &jElement, '\"', pEnd);
+			else if ((jTok == JREAD_NUMBER) || (jTok == JREAD_BOOL) || (jTok == JREAD_NULL))
+			{
+				jElement.dataType = jTok;
+				jElement.elements = 1;
+				jElement.error = 0;
+				jElement.pValue = pJson;
+				jElement.bytelen = getElementStringLenght(pJson, pEnd);
+				pJson += jElement.bytelen;
+			}
+			else
+				break; // Unexpected character
+			if ((readField(&jElement, binding.pFields[field], pStruct) == ReadError::JS_OK) && !(set & (1u << field)))
+			{
+				set |= 1u << field;
+				count++;
+			}
+		}
+		pJson = findTok(pJson, &jTok, pEnd);
+		if (jTok != JREAD_COMMA)
+			break; // end of object, or Expected ","
+		pJson++;
+	}
+	return count;
+}
+
+int Json::decode(const char *pQuery, const Binding &binding, void *pStruct)
+{
+	return decode(readContext.pJson, pQuery, binding, pStruct, &readContext);
+}
+
+int Json::decode(const char *pJson, const char *pQuery, const Binding &binding, void *pStruct)
+{
+	return decode(pJson, pQuery, binding, pStruct, NULL);
+}
+
+int Json::decode(const char *pJson, size_t jsonLen, const char *pQuery, const Binding &binding, void *pStruct)
+{
+	const ReadContext context = {pJson + jsonLen, NULL, NULL, 0, NULL, 0, 0};
+	return decode(pJson, pQuery, binding, pStruct, &context);
+}
+
+//------------------------------------------------------
+// Length-bounded JSON
+// - the text is read through a context with pEnd set,
+//   pEnd is read as the '\0' terminator
+//------------------------------------------------------
+
+const char *Json::getElement(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, struct ReadElement *pResult)
+{
+	const ReadContext context = {pJson + jsonLen, NULL, NULL, 0, NULL, 0, 0};
+	return getElement(pJson, pQuery, queryParams, pResult, &context);
+}
+
+const char *Json::getElement(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, struct ReadElement *pResult)
+{
+	const ReadContext context = {pJson + jsonLen, NULL, NULL, 0, NULL, 0, 0};
+	return getElement(pJson, query, queryParams, pResult, &context);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, pQuery, queryParams, &elem);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, query, queryParams, &elem);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, int *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, pQuery, queryParams, &elem);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, int *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, query, queryParams, &elem);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, long long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, pQuery, queryParams, &elem);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, long long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, query, queryParams, &elem);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, unsigned long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, pQuery, queryParams, &elem);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, unsigned long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, query, queryParams, &elem);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, unsigned long long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, pQuery, queryParams, &elem);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, unsigned long long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, query, queryParams, &elem);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, double *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, pQuery, queryParams, &elem);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, double *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, query, queryParams, &elem);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, bool *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, pQuery, queryParams, &elem);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, bool *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, query, queryParams, &elem);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, char *pDest, int destlen)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, pQuery, queryParams, &elem);
+	return readValue(&elem, pDest, destlen);
+}
+
+ReadError Json::getValue(const char *pJson, size_t jsonLen, const Query &query, int *queryParams, char *pDest, int destlen)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, query, queryParams, &elem);
+	return readValue(&elem, pDest, destlen);
+}
+
+int Json::getValues(const char *pJson, size_t jsonLen, Batch &batch)
+{
+	const ReadContext context = {pJson + jsonLen, NULL, NULL, 0, NULL, 0, 0};
+	return getValues(pJson, batch, &context);
+}
+
+int Json::getNumbers(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, double *pValues, int maxValues)
+{
+	const ReadContext context = {pJson + jsonLen, NULL, NULL, 0, NULL, 0, 0};
+	struct ReadElement elem;
+	getElement(pJson, pQuery, queryParams, &elem, &context, false);
+	return readNumbers(&elem, pValues, maxValues, &context);
+}
+
+//------------------------------------------------------
+// Cursor
+//------------------------------------------------------
+
+Json::Cursor::Cursor(const struct ReadElement &container) : pStart((const char *)container.pValue), pNext(pStart), pContext(NULL),
+																isObject(container.dataType == JREAD_OBJECT), count(-1), error(0), current(), member()
+{
+	if ((container.dataType != JREAD_OBJECT) && (container.dataType != JREAD_ARRAY))
+		pStart = pNext = NULL;
+	rewind();
+}
+
+Json::Cursor Json::iterate(const struct ReadElement &container) const
+{
+	Cursor cursor(container);
+	cursor.pContext = &readContext;
+	return cursor;
+}
+
+void Json::Cursor::rewind()
+{
+	pNext = pStart;
+	count = -1;
+	error = (pStart == NULL) ? 1 : 0; // JSON does not match Query
+	current.dataType = member.dataType = JREAD_ERROR;
+}
+
+// next
+// - on entry pNext -> "{" / "[" before the first element, else "," or end
+// - reads one "key": value (objects) or value (arrays)
+//
+bool Json::Cursor::next()
+{
+	int jTok;
+	const char *pJson;
+	const char *pEnd = Json::contextEnd(pContext);
+
+	if (error)
+		return false;
+	current.dataType = member.dataType = JREAD_ERROR;
+	pJson = findTok(pNext, &jTok, pEnd);
+	if ((jTok == JREAD_EOBJECT) || (jTok == JREAD_EARRAY))
+	{
+		error = isObject ? 14 : 13; // End of object/array found
+		return false;
+	}
+	if (pJson == pStart)
+	{
+		findTok(pJson + 1, &jTok, pEnd); // empty object/array
+		if ((jTok == JREAD_EOBJECT) || (jTok == JREAD_EARRAY))
+		{
+			error = isObject ? 14 : 13;
+			return false;
+		}
+	}
+	else if (jTok != JREAD_COMMA)
+	{
+		error = isObject ? 6 : 9; // Expected "," in object/array
+		return false;
+	}
+	pJson++;
+	if (isObject)
+	{
+		pJson = getElementString(pJson, &member, '\"', pEnd);
+		if (member.dataType != JREAD_STRING)
+		{
+			error = 3; // Expected "key"
+			return false;
+		}
+		member.dataType = JREAD_KEY;
+		pJson = findTok(pJson, &jTok, pEnd);
+		if (jTok != JREAD_COLON)
+		{
+			error = 4; // Expected ":"
+			return false;
+		}
+		pJson++;
+	}
+	pNext = Json::getElement(pJson, "", NULL, &current, pContext);
+	if (current.error)
+	{
+		error = current.error;
+		return false;
+	}
+	count++;
+	return true;
+}
+
+const struct ReadElement &Json::Cursor::value() const
+{
+	return current;
+}
+
+const struct ReadElement &Json::Cursor::key() const
+{
+	return member;
+}
+
+int Json::Cursor::index() const
+{
+	return count;
+}
+
+int Json::Cursor::getError() const
+{
+	return error;
+}
+
+const char *Json::Cursor::getElement(const char *pQuery, int *queryParams, struct ReadElement &pResult) const
+{
+	return Json::getElement((const char *)current.pValue, pQuery, queryParams, &pResult, pContext);
+}
+
+const char *Json::Cursor::getElement(const Query &query, int *queryParams, struct ReadElement &pResult) const
+{
+	return Json::getElement((const char *)current.pValue, query, queryParams, &pResult, pContext);
+}
+
+Json::Cursor::Iterator::Iterator(Cursor *pCursor) : pCursor(pCursor)
+{
+}
+
+Json::Cursor &Json::Cursor::Iterator::operator*() const
+{
+	return *pCursor;
+}
+
+Json::Cursor::Iterator &Json::Cursor::Iterator::operator++()
+{
+	if (!pCursor->next())
+		pCursor = NULL;
+	return *this;
+}
+
+bool Json::Cursor::Iterator::operator!=(const Iterator &other) const
+{
+	return pCursor != other.pCursor;
+}
+
+Json::Cursor::Iterator Json::Cursor::begin()
+{
+	rewind();
+	return next() ? Iterator(this) : Iterator(NULL);
+}
+
+Json::Cursor::Iterator Json::Cursor::end()
+{
+	return Iterator(NULL);
+}
+
+int Json::buildIndex(struct IndexEntry *pEntries, int maxEntries)
+{
+	const char *pJson = readContext.pJson;
+	const char *sp = pJson;
+	const char *pEnd = readContext.pEnd;
+	struct ReadElement jElement;
+	int count = 0;
+	int current = -1; // entry of innermost open object/array
+	int first = 0;	// 1= next token is first in current object/array
+	char c;
+
+	clearIndex();
+	while (sp < pEnd)
+	{
+		c = *sp;
+		if (c == '\0')
+			break;
+		if (c <= ' ')
+		{
+			sp++;
+			continue;
+		}
+		if (first)
+		{
+			first = 0;
+			if ((c != '}') && (c != ']'))
+				pEntries[current].elements = 1;
+		}
+		switch (c)
+		{
+		case '"':
+			sp = getElementString(sp, &jElement, '\"', pEnd);
+			if (jElement.dataType != JREAD_STRING)
+				return -1; // unterminated string
+			continue;
+		case '{':
+		case '[':
+			if (count >= maxEntries)
+				return -1; // out of entries
+			// while open, close holds the entry of the enclosing object/array
+			pEntries[count].open = sp - pJson;
+			pEntries[count].close = (size_t)current;
+			pEntries[count].elements = 0;
+			pEntries[count].keys = -1;
+			current = count++;
+			first = 1;
+			break;
+		case '}':
+		case ']':
+			if ((current < 0) ||
+				(pJson[pEntries[current].open] != ((c == '}') ? '{' : '[')))
+				return -1; // unbalanced
+			{
+				int parent = (int)pEntries[current].close;
+				pEntries[current].close = sp - pJson;
+				current = parent;
+			}
+			break;
+		case ',':
+			if (current >= 0)
+				pEntries[current].elements++;
+			break;
+		default:
+			break;
+		}
+		sp++;
+	}
+	if (current >= 0)
+		return -1; // unbalanced
+
+	readContext.pEntries = pEntries;
+	readContext.count = count;
+	return count;
+}
+
+void Json::clearIndex()
+{
+	readContext.pEntries = NULL;
+	readContext.count = 0;
+	readContext.slotsUsed = 0;
+}
+
+void Json::useKeyTables(struct KeySlot *pSlots, int maxSlots)
+{
+	readContext.pSlots = (maxSlots > 0) ? pSlots : NULL;
+	readContext.slots = (maxSlots > 0) ? maxSlots : 0;
+	readContext.slotsUsed = 0;
+	for (int i = 0; i < readContext.count; i++)
+		readContext.pEntries[i].keys = -1;
+}
+
+void Json::useCache(struct CacheEntry *pEntries, int maxEntries)
+{
+	queryCache.pEntries = (maxEntries > 0) ? pEntries : NULL;
+	queryCache.size = (maxEntries > 0) ? maxEntries : 0;
+	queryCache.hits = queryCache.misses = 0;
+	clearCache();
+}
+
+void Json::clearCache()
+{
+	queryCache.used = 0;
+	queryCache.next = 0;
+}
+
+unsigned long Json::getCacheHits() const
+{
+	return queryCache.hits;
+}
+
+unsigned long Json::getCacheMisses() const
+{
+	return queryCache.misses;
+}
+
+// getRootElement
+// - one pass over the query string gives its length, hash and the
+//   number of '*' parameters ('*' outside quoted keys)
+// - entries are searched in turn, a hash match is confirmed by the
+//   query string and the parameter values
+// - a miss reads the JSON and stores the result in the next entry
+//
+const char *Json::getRootElement(const char *pQuery, int *queryParams, struct ReadElement *pResult)
+{
+	unsigned int hash = 2166136261u; // as hashKey()
+	int len, params = 0, quoted = 0, i;
+	CacheEntry *pEntry;
+
+	if (queryCache.pEntries == NULL)
+		return getElement(readContext.pJson, pQuery, queryParams, pResult, &readContext);
+	for (len = 0; pQuery[len] != '\0'; len++)
+	{
+		hash = (hash ^ (unsigned char)pQuery[len]) * 16777619u;
+		if (pQuery[len] == QUERY_QUOTE)
+			quoted = !quoted;
+		else if ((pQuery[len] == '*') && !quoted)
+			params++;
+	}
+	if ((len >= JREAD_CACHE_QUERY) || (params > JREAD_CACHE_PARAMS) || ((params > 0) && (queryParams == NULL)))
+	{
+		queryCache.misses++; // can not be cached
+		return getElement(readContext.pJson, pQuery, queryParams, pResult, &readContext);
+	}
+	for (i = 0; i < queryCache.used; i++)
+	{
+		pEntry = &queryCache.pEntries[i];
+		if ((pEntry->hash == hash) && (memcmp(pEntry->query, pQuery, len + 1) == 0) &&
+			((params == 0) || (memcmp(pEntry->params, queryParams, params * sizeof(int)) == 0)))
+		{
+			queryCache.hits++;
+			*pResult = pEntry->result;
+			return pEntry->pAfter;
+		}
+	}
+	queryCache.misses++;
+	pEntry = &queryCache.pEntries[queryCache.next];
+	pEntry->pAfter = getElement(readContext.pJson, pQuery, queryParams, pResult, &readContext);
+	pEntry->hash = hash;
+	memcpy(pEntry->query, pQuery, len + 1);
+	if (params > 0)
+		memcpy(pEntry->params, queryParams, params * sizeof(int));
+	pEntry->result = *pResult;
+	if (queryCache.used < queryCache.size)
+		queryCache.used++;
+	queryCache.next = (queryCache.next + 1) % queryCache.size;
+	return pEntry->pAfter;
+}
+
+// findIndexEntry
+// - binary search for the object/array starting at pJson
+// - returns NULL if there is no index or pJson is not an indexed '{' or '['
+//
+IndexEntry *Json::findIndexEntry(const ReadContext *pContext, const char *pJson)
+{
+	int lo, hi, mid;
+	size_t offset;
+	if ((pContext == NULL) || (pContext->pEntries == NULL) || (pContext->count == 0) || (pJson < pContext->pJson))
+		return NULL;
+	offset = pJson - pContext->pJson;
+	if (offset > pContext->pEntries[0].close) // not in indexed JSON
+		return NULL;
+	lo = 0;
+	hi = pContext->count - 1;
+	while (lo <= hi)
+	{
+		mid = (lo + hi) / 2;
+		if (pContext->pEntries[mid].open == offset)
+			return &pContext->pEntries[mid];
+		if (pContext->pEntries[mid].open < offset)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return NULL;
+}
+
+// getKeyTable
+// - key table of the wide object at pJson (pEntry its index entry), built
+//   on the first call: the members are read once, each key is placed at its
+//   hash in a table of the smallest power of 2 >= 2 * members slots, taking
+//   the next free slot on a collision, a key repeated keeps its first value
+// - returns NULL if the table does not fit in the slots left or the object
+//   can not be read, its keys are then looked up without a table
+//
+const KeySlot *Json::getKeyTable(const char *pJson, IndexEntry *pEntry, const ReadContext *pContext)
+{
+	struct ReadElement jElement;
+	KeySlot *pTable, *pSlot;
+	unsigned int size, mask, hash, members = 0;
+	int jTok;
+	const char *pEnd = contextEnd(pContext);
+
+	if (pEntry->keys >= 0)
+		return pContext->pSlots + pEntry->keys;
+	if (pEntry->keys < -1)
+		return NULL;
+	pEntry->keys = -2; // unless built
+	for (size = 2; size < 2 * (unsigned int)pEntry->elements; size <<= 1)
+		;
+	if ((int)size > pContext->slots - pContext->slotsUsed)
+		return NULL;
+	pTable = pContext->pSlots + pContext->slotsUsed;
+	mask = size - 1;
+	memset(pTable, 0, size * sizeof(KeySlot));
+	while (1)
+	{
+		pJson = getElementString(++pJson, &jElement, '\"', pEnd);
+		if (jElement.dataType != JREAD_STRING)
+			return NULL; // Expected "key"
+		pJson = findTok(pJson, &jTok, pEnd);
+		if ((jTok != JREAD_COLON) || (++members >= size))
+			return NULL; // Expected ":", or more members than indexed
+		hash = hashKey((const char *)jElement.pValue, (int)jElement.bytelen);
+		for (pSlot = &pTable[hash & mask]; pSlot->key != 0; pSlot = &pTable[(pSlot - pTable + 1) & mask])
+		{
+			if ((pSlot->hash == hash) && (pSlot->keyLen == jElement.bytelen) &&
+				(memcmp(pContext->pJson + pSlot->key, jElement.pValue, jElement.bytelen) == 0))
+				break; // repeated key
+		}
+		if (pSlot->key == 0)
+		{
+			pSlot->key = (const char *)jElement.pValue - pContext->pJson;
+			pSlot->value = ++pJson - pContext->pJson;
+			pSlot->hash = hash;
+			pSlot->keyLen = (unsigned int)jElement.bytelen;
+		}
+		else
+			pJson++;
+		pJson = skipValue(pJson, pContext);
+		pJson = findTok(pJson, &jTok, pEnd);
+		if (jTok == JREAD_EOBJECT)
+			break;
+		if (jTok != JREAD_COMMA)
+			return NULL; // Expected "," in object
+	}
+	pEntry->keys = pContext->slotsUsed;
+	pContext->slotsUsed += size;
+	return pTable;
+}
+
+// getElementTable
+// - element table of the wide array at pJson (pEntry its index entry),
+//   built on the first call: the elements are read once, slot n holds the
+//   offset after the '[' or ',' before element n (as findArrayIndex() returns)
+// - returns NULL if the table does not fit in the slots left or the array
+//   can not be read, its elements are then found without a table
+//
+const KeySlot *Json::getElementTable(const char *pJson, IndexEntry *pEntry, const ReadContext *pContext)
+{
+	KeySlot *pTable;
+	int elements = 0, jTok;
+	const char *pEnd = contextEnd(pContext);
+
+	if (pEntry->keys >= 0)
+		return pContext->pSlots + pEntry->keys;
+	if (pEntry->keys < -1)
+		return NULL;
+	pEntry->keys = -2; // unless built
+	if (pEntry->elements > pContext->slots - pContext->slotsUsed)
+		return NULL;
+	pTable = pContext->pSlots + pContext->slotsUsed;
+	while (1)
+	{
+		if (elements >= pEntry->elements)
+			return NULL; // more elements than indexed
+		pTable[elements].key = 0;
+		pTable[elements].value = ++pJson - pContext->pJson;
+		pTable[elements].hash = 0;
+		pTable[elements].keyLen = 0;
+		elements++;
+		pJson = skipValue(pJson, pContext);
+		pJson = findTok(pJson, &jTok, pEnd);
+		if (jTok == JREAD_EARRAY)
+			break;
+		if (jTok != JREAD_COMMA)
+			return NULL; // Expected "," in array
+	}
+	if (elements != pEntry->elements)
+		return NULL;
+	pEntry->keys = pContext->slotsUsed;
+	pContext->slotsUsed += elements;
+	return pTable;
+}
+
+// Internal for reading
+// - runs of whitespace are skipped by the block scanner
+//
+inline const char *Json::skipWhitespace(const char *sp, const char *pEnd)
+{
+	if ((sp == pEnd) || (*sp == '\0') || (*sp > ' '))
+		return sp;
+	if ((sp + 1 == pEnd) || (sp[1] == '\0') || (sp[1] > ' ')) // single separator
+		return sp + 1;
+	return jScanWhitespace(sp + 2, pEnd);
+}
+
+// Token type of the first char of a token
+// - QUERY_QUOTE starts a string in query strings
+//
+#define EOL JREAD_EOL
+#define ERR JREAD_ERROR
+#define STR JREAD_STRING
+#define NUM JREAD_NUMBER
+#define OBJ JREAD_OBJECT
+#define ARR JREAD_ARRAY
+#define EOB JREAD_EOBJECT
+#define EAR JREAD_EARRAY
+#define BOL JREAD_BOOL
+#define NUL JREAD_NULL
+#define COL JREAD_COLON
+#define COM JREAD_COMMA
+#define QPM JREAD_QPARAM
+#ifdef JREAD_DOUBLE_QUOTE_IN_QUERY
+#define SQT JREAD_ERROR
+#else
+#define SQT JREAD_STRING
+#endif
+static const unsigned char tokTypes[256] = {
+	EOL, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, // 00
+	ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, // 10
+	ERR, ERR, STR, ERR, ERR, ERR, ERR, SQT, ERR, ERR, QPM, ERR, COM, NUM, ERR, ERR, // 20
+	NUM, NUM, NUM, NUM, NUM, NUM, NUM, NUM, NUM, NUM, COL, ERR, ERR, ERR, ERR, ERR, // 30
+	ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, // 40
+	ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ARR, ERR, EAR, ERR, ERR, // 50
+	ERR, ERR, ERR, ERR, ERR, ERR, BOL, ERR, ERR, ERR, ERR, ERR, ERR, ERR, NUL, ERR, // 60
+	ERR, ERR, ERR, ERR, BOL, ERR, ERR, ERR, ERR, ERR, ERR, OBJ, ERR, EOB, ERR, ERR, // 70
+	ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, // 80
+	ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, // 90
+	ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, // a0
+	ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, // b0
+	ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, // c0
+	ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, // d0
+	ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, // e0
+	ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, // f0
+};
+#undef EOL
+#undef ERR
+#undef STR
+#undef NUM
+#undef OBJ
+#undef ARR
+#undef EOB
+#undef EAR
+#undef BOL
+#undef NUL
+#undef COL
+#undef COM
+#undef QPM
+#undef SQT
+
+// Find start of a token
+// - returns pointer to start of next token or element
+//   returns type via tokType
+//
+inline const char *Json::findTok(const char *sp, int *tokType, const char *pEnd)
+{
+	sp = skipWhitespace(sp, pEnd);
+	*tokType = (sp == pEnd) ? JREAD_EOL : tokTypes[(unsigned char)*sp];
+	return sp;
+}
+
+// contextEnd
+// - end of the JSON text read with pContext, NULL if '\0'-terminated only
+//
+const char *Json::contextEnd(const ReadContext *pContext)
+{
+	return (pContext != NULL) ? pContext->pEnd : NULL;
+}
+
+// getElementString
+// - assumes next element is "string" which may include "\" sequences
+// - returns pointer to -------------^
+// - pElem contains result ( JREAD_STRING, length, pointer to string)
+// - pass quote = '"' for Json, quote = '\'' for query scanning
+// - Json strings are scanned a block at a time by jScanString()
+//
+// returns: pointer into pJson after the string (char after the " terminator)
+//			pElem contains pointer and length of string (or dataType=JREAD_ERROR)
+//
+const char *Json::getElementString(const char *pJson, struct ReadElement *pElem, char quote, const char *pEnd)
+{
+	short skipch;
+	pElem->dataType = JREAD_ERROR;
+	pElem->elements = 1;
+	pElem->bytelen = 0;
+	pElem->error = 0;
+	pJson = skipWhitespace(pJson, pEnd);
+	if ((pJson != pEnd) && (*pJson == quote))
+	{
+		pJson++;
+		pElem->pValue = pJson; // -> start of actual string
+		if (quote == '\"')
+		{
+			pJson = jScanString(pJson, pEnd);
+			pElem->bytelen = pJson - (const char *)pElem->pValue;
+			if ((pJson != pEnd) && (*pJson == quote))
+			{
+				pElem->dataType = JREAD_STRING;
+				pJson++;
+			}
+			return pJson;
+		}
+		skipch = 0;
+		while (*pJson != '\0')
+		{
+			if (skipch)
+				skipch = 0;
+			else if (*pJson == '\\') //  "\" sequence
+				skipch = 1;
+			else if (*pJson == quote)
+			{
+				pElem->dataType = JREAD_STRING;
+				pJson++;
+				break;
+			}
+			pElem->bytelen++;
+			pJson++;
+		};
+	};
+	return pJson;
+}
+
+// getElementStringLenght
+// - used to identify length of element text
+// - returns no. of chars from pJson upto a terminator
+// - terminators: ' ' , } ]
+//
+size_t Json::getElementStringLenght(const char *pJson, const char *pEnd)
+{
+	size_t len = 0;
+	while ((pJson != pEnd) &&
+		   (*pJson > ' ') && // any ctrl char incl '\0'
+		   (*pJson != ',') &&
+		   (*pJson != '}') &&
+		   (*pJson != ']'))
+	{
+		len++;
+		pJson++;
+	}
+	return len;
+}
+
+//--------------------------------------------------------------------
+// Optional helper functions
+//--------------------------------------------------------------------
+
+ReadError Json::getValue(const char *pQuery, long &value)
+{
+	return getValue(pQuery, (int *)NULL, value);
+}
+
+ReadError Json::getValue(const char *pQuery, int *queryParams, long &value)
+{
+	struct ReadElement elem;
+	getRootElement(pQuery, queryParams, &elem);
+	return readValue(&elem, &value);
+}
+ReadError Json::getValue(const char *pJson, const char *pQuery, int *queryParams, long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, pQuery, queryParams, &elem, NULL);
+	return readValue(&elem, value);
 }
 
 ReadError Json::getValue(const char *pQuery, int &value)
 {
-	return getValue(buffer, pQuery, NULL, &value);
+	return getValue(pQuery, (int *)NULL, value);
+}
+
+ReadError Json::getValue(const char *pQuery, int *queryParams, int &value)
+{
+	struct ReadElement elem;
+	getRootElement(pQuery, queryParams, &elem);
+	return readValue(&elem, &value);
+}
+ReadError Json::getValue(const char *pJson, const char *pQuery, int *queryParams, int *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, pQuery, queryParams, &elem, NULL);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pQuery, long long &value)
+{
+	return getValue(pQuery, NULL, value);
+}
+
+ReadError Json::getValue(const char *pQuery, int *queryParams, long long &value)
+{
+	struct ReadElement elem;
+	getRootElement(pQuery, queryParams, &elem);
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const char *pJson, const char *pQuery, int *queryParams, long long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, pQuery, queryParams, &elem, NULL);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pQuery, unsigned long &value)
+{
+	return getValue(pQuery, NULL, value);
+}
+
+ReadError Json::getValue(const char *pQuery, int *queryParams, unsigned long &value)
+{
+	struct ReadElement elem;
+	getRootElement(pQuery, queryParams, &elem);
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const char *pJson, const char *pQuery, int *queryParams, unsigned long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, pQuery, queryParams, &elem, NULL);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pQuery, unsigned long long &value)
+{
+	return getValue(pQuery, NULL, value);
+}
+
+ReadError Json::getValue(const char *pQuery, int *queryParams, unsigned long long &value)
+{
+	struct ReadElement elem;
+	getRootElement(pQuery, queryParams, &elem);
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const char *pJson, const char *pQuery, int *queryParams, unsigned long long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, pQuery, queryParams, &elem, NULL);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pQuery, double &value)
+{
+	return getValue(pQuery, (int *)NULL, value);
+}
+
+ReadError Json::getValue(const char *pQuery, int *queryParams, double &value)
+{
+	struct ReadElement elem;
+	getRootElement(pQuery, queryParams, &elem);
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const char *pJson, const char *pQuery, int *queryParams, double *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, pQuery, queryParams, &elem, NULL);
+	return readValue(&elem, value);
+}
+
+// jRead_boolean
+// - returns bool from JSON
+// - returns error code
+//
+ReadError Json::getValue(const char *pQuery, bool &value)
+{
+	return getValue(pQuery, (int *)NULL, value);
+}
+ReadError Json::getValue(const char *pQuery, int *queryParams, bool &value)
+{
+	struct ReadElement elem;
+	getRootElement(pQuery, queryParams, &elem);
+	return readValue(&elem, &value);
+}
+ReadError Json::getValue(const char *pJson, const char *pQuery, int *queryParams, bool *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, pQuery, queryParams, &elem, NULL);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const char *pQuery, char *pDest, int destlen)
+{
+	return getValue(pQuery, (int *)NULL, pDest, destlen);
+}
+ReadError Json::getValue(const char *pQuery, int *queryParams, char *pDest, int destlen)
+{
+	struct ReadElement elem;
+	*pDest = '\0';
+	getRootElement(pQuery, queryParams, &elem);
+	return readValue(&elem, pDest, destlen);
+}
+ReadError Json::getValue(const char *pJson, const char *pQuery, int *queryParams, char *pDest, int destlen)
+{
+	struct ReadElement elem;
+	*pDest = '\0';
+	getElement(pJson, pQuery, queryParams, &elem, NULL);
+	return readValue(&elem, pDest, destlen);
+}
+
+ReadError Json::getValue(const Query &query, int *queryParams, long &value)
+{
+	struct ReadElement elem;
+	getElement(readContext.pJson, query, queryParams, &elem, &readContext);
+	return readValue(&elem, &value);
+}
+ReadError Json::getValue(const char *pJson, const Query &query, int *queryParams, long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, query, queryParams, &elem, NULL);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const Query &query, int *queryParams, int &value)
+{
+	struct ReadElement elem;
+	getElement(readContext.pJson, query, queryParams, &elem, &readContext);
+	return readValue(&elem, &value);
+}
+ReadError Json::getValue(const char *pJson, const Query &query, int *queryParams, int *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, query, queryParams, &elem, NULL);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const Query &query, int *queryParams, long long &value)
+{
+	struct ReadElement elem;
+	getElement(readContext.pJson, query, queryParams, &elem, &readContext);
+	return readValue(&elem, &value);
+}
+ReadError Json::getValue(const char *pJson, const Query &query, int *queryParams, long long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, query, queryParams, &elem, NULL);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const Query &query, int *queryParams, unsigned long &value)
+{
+	struct ReadElement elem;
+	getElement(readContext.pJson, query, queryParams, &elem, &readContext);
+	return readValue(&elem, &value);
+}
+ReadError Json::getValue(const char *pJson, const Query &query, int *queryParams, unsigned long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, query, queryParams, &elem, NULL);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const Query &query, int *queryParams, unsigned long long &value)
+{
+	struct ReadElement elem;
+	getElement(readContext.pJson, query, queryParams, &elem, &readContext);
+	return readValue(&elem, &value);
+}
+ReadError Json::getValue(const char *pJson, const Query &query, int *queryParams, unsigned long long *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, query, queryParams, &elem, NULL);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const Query &query, int *queryParams, double &value)
+{
+	struct ReadElement elem;
+	getElement(readContext.pJson, query, queryParams, &elem, &readContext);
+	return readValue(&elem, &value);
+}
+ReadError Json::getValue(const char *pJson, const Query &query, int *queryParams, double *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, query, queryParams, &elem, NULL);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const Query &query, int *queryParams, bool &value)
+{
+	struct ReadElement elem;
+	getElement(readContext.pJson, query, queryParams, &elem, &readContext);
+	return readValue(&elem, &value);
+}
+ReadError Json::getValue(const char *pJson, const Query &query, int *queryParams, bool *value)
+{
+	struct ReadElement elem;
+	getElement(pJson, query, queryParams, &elem, NULL);
+	return readValue(&elem, value);
+}
+
+ReadError Json::getValue(const Query &query, int *queryParams, char *pDest, int destlen)
+{
+	struct ReadElement elem;
+	*pDest = '\0';
+	getElement(readContext.pJson, query, queryParams, &elem, &readContext);
+	return readValue(&elem, pDest, destlen);
+}
+ReadError Json::getValue(const char *pJson, const Query &query, int *queryParams, char *pDest, int destlen)
+{
+	struct ReadElement elem;
+	*pDest = '\0';
+	getElement(pJson, query, queryParams, &elem, NULL);
+	return readValue(&elem, pDest, destlen);
+}
+
+ReadError Json::getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, long &value)
+{
+	struct ReadElement elem;
+	getElement(root, pQuery, queryParams, elem);
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, int &value)
+{
+	struct ReadElement elem;
+	getElement(root, pQuery, queryParams, elem);
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, long long &value)
+{
+	struct ReadElement elem;
+	getElement(root, pQuery, queryParams, elem);
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, unsigned long &value)
+{
+	struct ReadElement elem;
+	getElement(root, pQuery, queryParams, elem);
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, unsigned long long &value)
+{
+	struct ReadElement elem;
+	getElement(root, pQuery, queryParams, elem);
+	return readValue(&elem, &value);
 }
 
-ReadError Json::getValue(const char *pQuery, int *queryParams, int &value)
+ReadError Json::getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, double &value)
 {
-	return getValue(buffer, pQuery, queryParams, &value);
+	struct ReadElement elem;
+	getElement(root, pQuery, queryParams, elem);
+	return readValue(&elem, &value);
 }
-ReadError Json::getValue(const char *pJson, const char *pQuery, int *queryParams, int *value)
+
+ReadError Json::getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, bool &value)
 {
-	long rValue;
-	ReadError error;
-	error = getValue(pJson, pQuery, queryParams, &rValue);
-	*value = (int)rValue;
-	return error;
+	struct ReadElement elem;
+	getElement(root, pQuery, queryParams, elem);
+	return readValue(&elem, &value);
 }
 
-ReadError Json::getValue(const char *pQuery, double &value)
+ReadError Json::getValue(const struct ReadElement &root, const char *pQuery, int *queryParams, char *pDest, int destlen)
 {
-	return getValue(buffer, pQuery, NULL, &value);
+	struct ReadElement elem;
+	*pDest = '\0';
+	getElement(root, pQuery, queryParams, elem);
+	return readValue(&elem, pDest, destlen);
 }
 
-ReadError Json::getValue(const char *pQuery, int *queryParams, double &value)
+ReadError Json::getValue(const struct ReadElement &root, const Query &query, int *queryParams, long &value)
 {
-	return getValue(buffer, pQuery, queryParams, &value);
+	struct ReadElement elem;
+	getElement(root, query, queryParams, elem);
+	return readValue(&elem, &value);
 }
 
-ReadError Json::getValue(const char *pJson, const char *pQuery, int *queryParams, double *value)
+ReadError Json::getValue(const struct ReadElement &root, const Query &query, int *queryParams, int &value)
 {
 	struct ReadElement elem;
-	getElement(pJson, pQuery, queryParams, &elem);
-	if (elem.dataType == JREAD_ERROR)
-		return ReadError::JS_ERROR;
-	jRead_atof((char *)elem.pValue, value);
-	return ReadError::JS_OK;
+	getElement(root, query, queryParams, elem);
+	return readValue(&elem, &value);
 }
 
-// jRead_boolean
-// - returns bool from JSON
-// - returns error code
-//
-ReadError Json::getValue(const char *pQuery, bool &value)
+ReadError Json::getValue(const struct ReadElement &root, const Query &query, int *queryParams, long long &value)
 {
-	return getValue(buffer, pQuery, NULL, &value);
+	struct ReadElement elem;
+	getElement(root, query, queryParams, elem);
+	return readValue(&elem, &value);
 }
-ReadError Json::getValue(const char *pQuery, int *queryParams, bool &value)
+
+ReadError Json::getValue(const struct ReadElement &root, const Query &query, int *queryParams, unsigned long &value)
 {
-	return getValue(buffer, pQuery, queryParams, &value);
+	struct ReadElement elem;
+	getElement(root, query, queryParams, elem);
+	return readValue(&elem, &value);
 }
-ReadError Json::getValue(const char *pJson, const char *pQuery, int *queryParams, bool *value)
+
+ReadError Json::getValue(const struct ReadElement &root, const Query &query, int *queryParams, unsigned long long &value)
+{
+	struct ReadElement elem;
+	getElement(root, query, queryParams, elem);
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const struct ReadElement &root, const Query &query, int *queryParams, double &value)
+{
+	struct ReadElement elem;
+	getElement(root, query, queryParams, elem);
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const struct ReadElement &root, const Query &query, int *queryParams, bool &value)
+{
+	struct ReadElement elem;
+	getElement(root, query, queryParams, elem);
+	return readValue(&elem, &value);
+}
+
+ReadError Json::getValue(const struct ReadElement &root, const Query &query, int *queryParams, char *pDest, int destlen)
+{
+	struct ReadElement elem;
+	*pDest = '\0';
+	getElement(root, query, queryParams, elem);
+	return readValue(&elem, pDest, destlen);
+}
+
+//------------------------------------------------------
+// Bulk numbers
+//------------------------------------------------------
+
+// readNumbers
+// - numbers are converted where they are found, other values
+//   are read as an element and converted by readValue()
+// - only pArray->pValue is used, the array need not be delimited,
+//   the loop finds its closing ']'
+//
+int Json::readNumbers(const struct ReadElement *pArray, double *pValues, int maxValues, const ReadContext *pContext)
 {
+	const char *pJson;
 	struct ReadElement elem;
-	getElement(pJson, pQuery, queryParams, &elem);
-	if (elem.dataType == JREAD_BOOL || elem.dataType == JREAD_NULL)
+	int jTok, count = 0;
+	const char *pEnd = contextEnd(pContext);
+
+	if ((pArray->dataType != JREAD_ARRAY) || (pArray->error != 0))
+		return -1;
+	pJson = findTok((const char *)pArray->pValue + 1, &jTok, pEnd);
+	if (jTok == JREAD_EARRAY)
+		return 0;
+	while (count < maxValues)
 	{
-		*value = (*(char *)elem.pValue == 't') ? true : false;
-		return ReadError::JS_OK;
+		if ((pJson == pEnd) || (*pJson == '\0'))
+			return -1; // JSON ends in array
+		if ((*pJson == '-') || ((*pJson >= '0') && (*pJson <= '9')))
+			pJson = jRead_atofn(pJson, pEnd, &pValues[count]);
+		else
+		{
+			pJson = getElement(pJson, "", NULL, &elem, pContext);
+			if (elem.error != 0)
+				return -1;
+			readValue(&elem, &pValues[count]);
+		}
+		count++;
+		if ((pJson == pEnd) || (*pJson != ',')) // most arrays have no whitespace before ','
+		{
+			pJson = findTok(pJson, &jTok, pEnd);
+			if (jTok == JREAD_EARRAY)
+				break;
+			if (jTok != JREAD_COMMA)
+				return -1; // Expected "," in array
+		}
+		pJson = skipWhitespace(pJson + 1, pEnd);
 	}
+	return count;
+}
+
+int Json::getNumbers(const char *pQuery, int *queryParams, double *pValues, int maxValues)
+{
+	struct ReadElement elem;
+	if (queryCache.pEntries != NULL)
+		getRootElement(pQuery, queryParams, &elem);
 	else
+		getElement(readContext.pJson, pQuery, queryParams, &elem, &readContext, false);
+	return readNumbers(&elem, pValues, maxValues, &readContext);
+}
+
+int Json::getNumbers(const struct ReadElement &root, const char *pQuery, int *queryParams, double *pValues, int maxValues)
+{
+	struct ReadElement elem;
+	const char *pJson = relativeRoot(root, &elem);
+	if (pJson == NULL)
+		return -1;
+	getElement(pJson, pQuery, queryParams, &elem, &readContext, false);
+	return readNumbers(&elem, pValues, maxValues, &readContext);
+}
+
+int Json::getNumbers(const char *pJson, const char *pQuery, int *queryParams, double *pValues, int maxValues)
+{
+	struct ReadElement elem;
+	getElement(pJson, pQuery, queryParams, &elem, NULL, false);
+	return readNumbers(&elem, pValues, maxValues, NULL);
+}
+
+//------------------------------------------------------
+// Parse with a handler (SAX)
+//------------------------------------------------------
+
+// parse
+// - one pass over the document, tokens are classified by findTok()
+// - nesting without recursion, a stack holds one bit per open
+//   object/array (1= object), JREAD_STACK_DEPTH levels
+// - next is what the loop reads next: a value, a "key": value member,
+//   the ',' or end after a value, or the end of an object/array
+// - values are read as by getElement(), numbers, true, false and null
+//   are the text up to a terminator
+//
+int Json::parse(const char *pJson, Handler &handler, const ReadContext *pContext)
+{
+	unsigned char stack[JREAD_STACK_DEPTH / 8];
+	struct ReadElement element;
+	int jTok, depth = 0, isObject = 0;
+	bool go;
+	enum
+	{
+		VALUE,
+		MEMBER,
+		AFTER,
+		CLOSE
+	} next = VALUE;
+	const char *pEnd = contextEnd(pContext);
+
+	pJson = findTok(pJson, &jTok, pEnd);
+	while (1)
+	{
+		switch (next)
+		{
+		case VALUE: // pJson -> value, jTok its type
+			next = AFTER;
+			switch (jTok)
+			{
+			case JREAD_OBJECT:
+			case JREAD_ARRAY:
+				if (depth >= JREAD_STACK_DEPTH)
+					return 16; // Nesting > JREAD_STACK_DEPTH
+				isObject = (jTok == JREAD_OBJECT);
+				if (isObject) // push
+					stack[depth / 8] |= (unsigned char)(1 << (depth % 8));
+				else
+					stack[depth / 8] &= (unsigned char)~(1 << (depth % 8));
+				depth++;
+				if (!(isObject ? handler.startObject() : handler.startArray()))
+					return 17; // Stopped by handler
+				pJson = findTok(pJson + 1, &jTok, pEnd);
+				if (jTok == (isObject ? JREAD_EOBJECT : JREAD_EARRAY))
+					next = CLOSE;
+				else
+					next = isObject ? MEMBER : VALUE;
+				break;
+			case JREAD_STRING:
+				pJson = getElementString(pJson, &element, '\"', pEnd);
+				if (element.dataType != JREAD_STRING)
+					return 2; // Error reading JSON value
+				if (!handler.string(element))
+					return 17; // Stopped by handler
+				break;
+			case JREAD_NUMBER:
+			case JREAD_BOOL:
+			case JREAD_NULL:
+				element.dataType = jTok;
+				element.elements = 1;
+				element.error = 0;
+				element.pValue = pJson;
+				element.bytelen = getElementStringLenght(pJson, pEnd);
+				if (jTok == JREAD_NUMBER)
+					go = handler.number(element);
+				else if (jTok == JREAD_BOOL)
+					go = handler.boolean(*pJson == 't');
+				else
+					go = handler.null();
+				if (!go)
+					return 17; // Stopped by handler
+				pJson += element.bytelen;
+				break;
+			default:
+				return 8; // Unexpected character
+			}
+			break;
+
+		case MEMBER: // pJson -> "key"
+			pJson = getElementString(pJson, &element, '\"', pEnd);
+			if (element.dataType != JREAD_STRING)
+				return 3; // Expected "key"
+			if (!handler.key((const char *)element.pValue, element.bytelen))
+				return 17; // Stopped by handler
+			pJson = findTok(pJson, &jTok, pEnd);
+			if (jTok != JREAD_COLON)
+				return 4; // Expected ':'
+			pJson = findTok(pJson + 1, &jTok, pEnd);
+			next = VALUE;
+			break;
+
+		case AFTER: // pJson -> after a value
+			if (depth == 0)
+				return 0;
+			pJson = findTok(pJson, &jTok, pEnd);
+			if (jTok == JREAD_COMMA)
+			{
+				pJson = findTok(pJson + 1, &jTok, pEnd);
+				next = isObject ? MEMBER : VALUE;
+			}
+			else if (jTok == (isObject ? JREAD_EOBJECT : JREAD_EARRAY))
+				next = CLOSE;
+			else
+				return isObject ? 6 : 9; // Expected "," in object/array
+			break;
+
+		case CLOSE: // pJson -> "}" or "]" of the object/array at depth
+			pJson++;
+			if (!(isObject ? handler.endObject() : handler.endArray()))
+				return 17; // Stopped by handler
+			depth--; // pop
+			isObject = (depth > 0) ? (stack[(depth - 1) / 8] >> ((depth - 1) % 8)) & 1 : 0;
+			next = AFTER;
+			break;
+		}
+	}
+}
+
+int Json::parse(Handler &handler)
+{
+	return parse(readContext.pJson, handler, &readContext);
+}
+
+int Json::parse(const char *pJson, Handler &handler)
+{
+	return parse(pJson, handler, NULL);
+}
+
+int Json::parse(const char *pJson, size_t jsonLen, Handler &handler)
+{
+	const ReadContext context = {pJson + jsonLen, NULL, NULL, 0, NULL, 0, 0};
+	return parse(pJson, handler, &context);
+}
+
+// readValue
+// - converts an element returned by getElement() to a native value
+// - does coercion of types where possible, see getValue()
+//
+ReadError Json::readValue(struct ReadElement *pElem, long long *value)
+{
+	if ((pElem->dataType == JREAD_ERROR) || (pElem->dataType == JREAD_NULL))
 	{
 		return ReadError::JS_ERROR;
 	}
+	else if (pElem->dataType == JREAD_BOOL)
+	{
+		*value = *((char *)pElem->pValue) == 't' ? 1 : 0;
+	}
+	else if (jRead_atolln((char *)pElem->pValue, (char *)pElem->pValue + pElem->bytelen, value) == NULL)
+	{
+		return ReadError::JS_ERROR; // does not fit
+	}
+	return ReadError::JS_OK;
 }
 
-ReadError Json::getValue(const char *pQuery, char *pDest, int destlen)
+ReadError Json::readValue(struct ReadElement *pElem, unsigned long long *value)
 {
-	return getValue(buffer, pQuery, NULL, pDest, destlen);
+	if ((pElem->dataType == JREAD_ERROR) || (pElem->dataType == JREAD_NULL))
+	{
+		return ReadError::JS_ERROR;
+	}
+	else if (pElem->dataType == JREAD_BOOL)
+	{
+		*value = *((char *)pElem->pValue) == 't' ? 1 : 0;
+	}
+	else if ((*(char *)pElem->pValue == '-') ||
+			 (jRead_atoulln((char *)pElem->pValue, (char *)pElem->pValue + pElem->bytelen, value) == NULL))
+	{
+		return ReadError::JS_ERROR; // does not fit
+	}
+	return ReadError::JS_OK;
 }
-ReadError Json::getValue(const char *pQuery, int *queryParams, char *pDest, int destlen)
+
+// narrower types are read as 64 bit and range checked
+ReadError Json::readValue(struct ReadElement *pElem, long *value)
 {
-	return getValue(buffer, pQuery, queryParams, pDest, destlen);
+	long long rValue = 0;
+	if ((readValue(pElem, &rValue) != ReadError::JS_OK) || (rValue < LONG_MIN) || (rValue > LONG_MAX))
+		return ReadError::JS_ERROR;
+	*value = (long)rValue;
+	return ReadError::JS_OK;
 }
-ReadError Json::getValue(const char *pJson, const char *pQuery, int *queryParams, char *pDest, int destlen)
+
+ReadError Json::readValue(struct ReadElement *pElem, unsigned long *value)
 {
-	struct ReadElement elem;
-	int i;
+	unsigned long long rValue = 0;
+	if ((readValue(pElem, &rValue) != ReadError::JS_OK) || (rValue > ULONG_MAX))
+		return ReadError::JS_ERROR;
+	*value = (unsigned long)rValue;
+	return ReadError::JS_OK;
+}
 
-	*pDest = '\0';
-	getElement(pJson, pQuery, queryParams, &elem);
-	if (elem.dataType == JREAD_ERROR)
+ReadError Json::readValue(struct ReadElement *pElem, int *value)
+{
+	long long rValue = 0;
+	if ((readValue(pElem, &rValue) != ReadError::JS_OK) || (rValue < INT_MIN) || (rValue > INT_MAX))
+		return ReadError::JS_ERROR;
+	*value = (int)rValue;
+	return ReadError::JS_OK;
+}
+
+ReadError Json::readValue(struct ReadElement *pElem, double *value)
+{
+	if (pElem->dataType == JREAD_ERROR)
+		return ReadError::JS_ERROR;
+	jRead_atofn((char *)pElem->pValue, (char *)pElem->pValue + pElem->bytelen, value);
+	return ReadError::JS_OK;
+}
+
+ReadError Json::readValue(struct ReadElement *pElem, bool *value)
+{
+	if (pElem->dataType == JREAD_BOOL || pElem->dataType == JREAD_NULL)
+	{
+		*value = (*(char *)pElem->pValue == 't') ? true : false;
+		return ReadError::JS_OK;
+	}
+	else
+	{
+		return ReadError::JS_ERROR;
+	}
+}
+
+ReadError Json::readValue(struct ReadElement *pElem, char *pDest, int destlen)
+{
+	int i;
+	if (pElem->dataType == JREAD_ERROR)
 		return ReadError::JS_ERROR;
 
-	for (i = 0; (i < elem.bytelen) && (i < destlen - 1); i++)
-		*pDest++ = ((char *)elem.pValue)[i];
+	for (i = 0; ((size_t)i < pElem->bytelen) && (i < destlen - 1); i++)
+		*pDest++ = ((char *)pElem->pValue)[i];
 	*pDest = '\0';
 	return ReadError::JS_OK;
 }
 
+//------------------------------------------------------
+// Validation
+//------------------------------------------------------
+
+// skipSpace
+// - JSON whitespace only: ' ', '\t', '\n' and '\r'
+//
+static inline const char *skipSpace(const char *sp, const char *pEnd)
+{
+	while ((sp != pEnd) && ((*sp == ' ') || (*sp == '\n') || (*sp == '\r') || (*sp == '\t')))
+		sp++;
+	return sp;
+}
+
+// checkNumber
+// - -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+// - returns the char after the number, on error the char in error
+//   with *pError set
+//
+static const char *checkNumber(const char *sp, const char *pEnd, int *pError)
+{
+	if ((sp != pEnd) && (*sp == '-'))
+		sp++;
+	if ((sp != pEnd) && (*sp == '0'))
+		sp++;
+	else if ((sp != pEnd) && (*sp >= '1') && (*sp <= '9'))
+		while ((sp != pEnd) && (*sp >= '0') && (*sp <= '9'))
+			sp++;
+	else
+	{
+		*pError = 2; // Error reading JSON value
+		return sp;
+	}
+	if ((sp != pEnd) && (*sp == '.'))
+	{
+		if ((++sp == pEnd) || (*sp < '0') || (*sp > '9'))
+		{
+			*pError = 2;
+			return sp;
+		}
+		while ((sp != pEnd) && (*sp >= '0') && (*sp <= '9'))
+			sp++;
+	}
+	if ((sp != pEnd) && ((*sp == 'e') || (*sp == 'E')))
+	{
+		if ((++sp != pEnd) && ((*sp == '+') || (*sp == '-')))
+			sp++;
+		if ((sp == pEnd) || (*sp < '0') || (*sp > '9'))
+		{
+			*pError = 2;
+			return sp;
+		}
+		while ((sp != pEnd) && (*sp >= '0') && (*sp <= '9'))
+			sp++;
+	}
+	return sp;
+}
+
+// checkKey
+// - "key": of an object member, returns the char after the ':', on
+//   error the char in error with *pError set
+//
+static inline const char *checkKey(const char *sp, const char *pEnd, int *pError)
+{
+	const char *pClose;
+	sp = skipSpace(sp, pEnd);
+	if ((sp == pEnd) || (*sp != '\"'))
+	{
+		*pError = 3; // Expected "key"
+		return sp;
+	}
+	pClose = jScanCheckString(sp + 1, pEnd);
+	if ((pClose == pEnd) || (*pClose != '\"'))
+	{
+		*pError = ((pClose != pEnd) && ((unsigned char)*pClose >= 0x80)) ? 18 : 3;
+		return pClose;
+	}
+	sp = skipSpace(pClose + 1, pEnd);
+	if ((sp == pEnd) || (*sp != ':'))
+	{
+		*pError = 4; // Expected ':'
+		return sp;
+	}
+	return sp + 1;
+}
+
+// validate
+// - strict JSON in one pass, where the reader takes any 't'/'f' as a
+//   bool, 'n' as null and any char <= ' ' as whitespace
+// - strings (and keys) are checked by jScanCheckString(), numbers by
+//   checkNumber(), literals in full
+// - nesting as in parse(), a stack holds one bit per open object/array
+// - each pass reads a value, then the ']'/'}' it ends and the ',' (and
+//   "key":) before the next one, no state is kept between tokens
+// - sp is left at the char in error, its offset is returned in *pOffset
+//
+int Json::validate(const char *pJson, size_t jsonLen, size_t *pOffset)
+{
+	unsigned char stack[JREAD_STACK_DEPTH / 8];
+	const char *sp = pJson;
+	const char *pEnd = pJson + jsonLen;
+	const char *pClose;
+	int depth = 0, isObject = 0, error = 0;
+
+	while (!error)
+	{
+		sp = skipSpace(sp, pEnd);
+		if (sp == pEnd)
+			error = 8; // Unexpected character (end of text)
+		else if ((*sp == '{') || (*sp == '['))
+		{
+			if (depth >= JREAD_STACK_DEPTH)
+			{
+				error = 16; // Nesting > JREAD_STACK_DEPTH
+				break;
+			}
+			isObject = (*sp == '{');
+			if (isObject) // push
+				stack[depth / 8] |= (unsigned char)(1 << (depth % 8));
+			else
+				stack[depth / 8] &= (unsigned char)~(1 << (depth % 8));
+			depth++;
+			sp = skipSpace(sp + 1, pEnd);
+			if ((sp == pEnd) || (*sp != (isObject ? '}' : ']')))
+			{
+				if (isObject)
+					sp = checkKey(sp, pEnd, &error);
+				continue; // first value
+			}
+			sp++; // empty
+			depth--; // pop
+			isObject = (depth > 0) ? (stack[(depth - 1) / 8] >> ((depth - 1) % 8)) & 1 : 0;
+		}
+		else if (*sp == '\"')
+		{
+			pClose = jScanCheckString(sp + 1, pEnd);
+			if ((pClose != pEnd) && (*pClose == '\"'))
+				sp = pClose + 1;
+			else
+			{
+				error = ((pClose != pEnd) && ((unsigned char)*pClose >= 0x80)) ? 18 : 2;
+				sp = pClose;
+			}
+		}
+		else if ((*sp == 't') || (*sp == 'f') || (*sp == 'n'))
+		{
+			const char *pLiteral = (*sp == 't') ? "true" : (*sp == 'f') ? "false" : "null";
+			size_t len = strlen(pLiteral);
+			if (((size_t)(pEnd - sp) < len) || (memcmp(sp, pLiteral, len) != 0))
+				error = 2; // Error reading JSON value
+			else
+				sp += len;
+		}
+		else if ((*sp == '-') || ((*sp >= '0') && (*sp <= '9')))
+			sp = checkNumber(sp, pEnd, &error);
+		else
+			error = 8; // Unexpected character
+
+		// after a value: the objects/arrays it ends, up to the next ','
+		while (!error)
+		{
+			sp = skipSpace(sp, pEnd);
+			if (depth == 0)
+			{
+				if (sp != pEnd)
+					error = 8; // Unexpected character after the value
+				break;
+			}
+			if ((sp != pEnd) && (*sp == ','))
+			{
+				sp++;
+				if (isObject)
+					sp = checkKey(sp, pEnd, &error);
+				break;
+			}
+			if ((sp == pEnd) || (*sp != (isObject ? '}' : ']')))
+				error = isObject ? 6 : 9; // Expected "," in object/array
+			else
+			{
+				sp++;
+				depth--; // pop
+				isObject = (depth > 0) ? (stack[(depth - 1) / 8] >> ((depth - 1) % 8)) & 1 : 0;
+			}
+		}
+		if (depth == 0)
+			break;
+	}
+	if (pOffset != NULL)
+		*pOffset = sp - pJson;
+	return error;
+}
+
+//------------------------------------------------------
+// Decoded strings
+//------------------------------------------------------
+
+// readString
+// - strings and keys are decoded, other elements are copied as they are
+//
+ReadError Json::readString(const struct ReadElement *pElem, char *pDest, size_t destLen, size_t *pLength)
+{
+	long long length;
+	size_t n;
+	if (pElem->dataType == JREAD_ERROR)
+		length = -1;
+	else if ((pElem->dataType == JREAD_STRING) || (pElem->dataType == JREAD_KEY))
+		length = jScanUnescape((const char *)pElem->pValue, pElem->bytelen, pDest, destLen);
+	else
+	{
+		length = (long long)pElem->bytelen;
+		if (destLen > 0)
+		{
+			n = (pElem->bytelen < destLen - 1) ? pElem->bytelen : destLen - 1;
+			memcpy(pDest, pElem->pValue, n);
+			pDest[n] = '\0';
+		}
+	}
+	if (pLength != NULL)
+		*pLength = (length < 0) ? 0 : (size_t)length;
+	if (length < 0)
+	{
+		if (destLen > 0)
+			*pDest = '\0';
+		return ReadError::JS_ERROR;
+	}
+	return ReadError::JS_OK;
+}
+
+ReadError Json::getString(const char *pQuery, int *queryParams, char *pDest, size_t destLen, size_t *pLength)
+{
+	struct ReadElement elem;
+	getRootElement(pQuery, queryParams, &elem);
+	return readString(&elem, pDest, destLen, pLength);
+}
+
+ReadError Json::getString(const Query &query, int *queryParams, char *pDest, size_t destLen, size_t *pLength)
+{
+	struct ReadElement elem;
+	getElement(readContext.pJson, query, queryParams, &elem, &readContext);
+	return readString(&elem, pDest, destLen, pLength);
+}
+
+ReadError Json::getString(const char *pJson, const char *pQuery, int *queryParams, char *pDest, size_t destLen, size_t *pLength)
+{
+	struct ReadElement elem;
+	getElement(pJson, pQuery, queryParams, &elem, NULL);
+	return readString(&elem, pDest, destLen, pLength);
+}
+
+ReadError Json::getString(const char *pJson, size_t jsonLen, const char *pQuery, int *queryParams, char *pDest, size_t destLen, size_t *pLength)
+{
+	struct ReadElement elem;
+	getElement(pJson, jsonLen, pQuery, queryParams, &elem);
+	return readString(&elem, pDest, destLen, pLength);
+}
+
+ReadError Json::getString(const struct ReadElement &element, char *pDest, size_t destLen, size_t *pLength)
+{
+	return readString(&element, pDest, destLen, pLength);
+}
+
 const char *Json::jReadTypeToString(int dataType)
 {
 	return jReadTypeStrings[dataType];
@@ -915,7 +3613,7 @@ const char *Json::jReadTypeToString(int dataType)
 
 const char *Json::jReadErrorToString(int error)
 {
-	if ((error >= 0) && (error <= 14))
+	if ((error >= 0) && (error <= 19))
 		return jReadErrorStrings[error];
 	return "Unknown error";
 }
@@ -0,0 +1,887 @@
+/**
+ * @brief jsonScan.cpp
+ *
+ * Block scanning kernels used by the JSON reader
+ *
+ */
+
+#include "../jsonScan.hpp"
+#include <atomic>
+#include <stdint.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define JSCAN_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define JSCAN_TARGET(isa) __attribute__((target(isa)))
+#define JSCAN_NO_SANITIZE __attribute__((no_sanitize_address))
+#define ctz64(x) __builtin_ctzll(x)
+#define popcount64(x) __builtin_popcountll(x)
+#else
+#define JSCAN_TARGET(isa)
+#define JSCAN_NO_SANITIZE
+static int ctz64(unsigned long long x)
+{
+	int n = 0;
+	while (!(x & 1))
+	{
+		x >>= 1;
+		n++;
+	}
+	return n;
+}
+static int popcount64(unsigned long long x)
+{
+	int n = 0;
+	for (; x; x &= x - 1)
+		n++;
+	return n;
+}
+#endif
+
+using namespace jonaskgandersson;
+
+typedef void (*ScanBlockFn)(const char *pBlock, struct ScanBlock *pScan);
+
+//------------------------------------------------------
+// Scalar kernel
+// - whitespace uses the same test as the reader: (c <= ' ') on plain char
+//
+JSCAN_NO_SANITIZE
+static void scanBlockScalar(const char *pBlock, struct ScanBlock *pScan)
+{
+	unsigned long long bit;
+	int i;
+	char c;
+	pScan->whitespace = pScan->quote = pScan->backslash = pScan->structural = pScan->open = pScan->close = pScan->eol = 0;
+	for (i = 0, bit = 1; i < JSCAN_BLOCK; i++, bit <<= 1)
+	{
+		c = pBlock[i];
+		switch (c)
+		{
+		case '\0':
+			pScan->eol |= bit;
+			break;
+		case '"':
+			pScan->quote |= bit;
+			break;
+		case '\\':
+			pScan->backslash |= bit;
+			break;
+		case '{':
+		case '[':
+			pScan->open |= bit;
+			pScan->structural |= bit;
+			break;
+		case '}':
+		case ']':
+			pScan->close |= bit;
+			pScan->structural |= bit;
+			break;
+		case ':':
+		case ',':
+			pScan->structural |= bit;
+			break;
+		default:
+			if (c <= ' ')
+				pScan->whitespace |= bit;
+			break;
+		}
+	}
+}
+
+#ifdef JSCAN_X86
+//------------------------------------------------------
+// SSE4.2 kernel, 4 x 16 bytes
+// - structurals are matched as a set with pcmpestrm
+// - x86 char is signed, so signed compare matches (c <= ' ')
+//
+JSCAN_TARGET("sse4.2")
+JSCAN_NO_SANITIZE
+static void scanBlockSse42(const char *pBlock, struct ScanBlock *pScan)
+{
+	const __m128i structSet = _mm_setr_epi8('{', '}', '[', ']', ':', ',', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i openCurly = _mm_set1_epi8('{');
+	const __m128i openSquare = _mm_set1_epi8('[');
+	const __m128i closeCurly = _mm_set1_epi8('}');
+	const __m128i closeSquare = _mm_set1_epi8(']');
+	unsigned long long ws = 0, qt = 0, bs = 0, st = 0, op = 0, cl = 0, eol = 0;
+	int i;
+	for (i = 0; i < JSCAN_BLOCK; i += 16)
+	{
+		__m128i v = _mm_load_si128((const __m128i *)(pBlock + i));
+		__m128i s = _mm_cmpestrm(structSet, 6, v, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK);
+		unsigned long long z = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+		eol |= z << i;
+		ws |= ((unsigned long long)(unsigned int)_mm_movemask_epi8(_mm_cmpgt_epi8(space, v)) |
+			   (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, space)))
+			  << i;
+		qt |= (unsigned long long)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << i;
+		bs |= (unsigned long long)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)) << i;
+		st |= (unsigned long long)(unsigned int)(_mm_cvtsi128_si32(s) & 0xffff) << i;
+		op |= (unsigned long long)(unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, openCurly), _mm_cmpeq_epi8(v, openSquare))) << i;
+		cl |= (unsigned long long)(unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, closeCurly), _mm_cmpeq_epi8(v, closeSquare))) << i;
+	}
+	pScan->whitespace = ws & ~eol;
+	pScan->quote = qt;
+	pScan->backslash = bs;
+	pScan->structural = st;
+	pScan->open = op;
+	pScan->close = cl;
+	pScan->eol = eol;
+}
+
+//------------------------------------------------------
+// AVX2 kernel, 2 x 32 bytes
+//
+JSCAN_TARGET("avx2")
+JSCAN_NO_SANITIZE
+static void scanBlockAvx2(const char *pBlock, struct ScanBlock *pScan)
+{
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i zero = _mm256_setzero_si256();
+	unsigned long long ws = 0, qt = 0, bs = 0, st = 0, op = 0, cl = 0, eol = 0;
+	int i;
+	for (i = 0; i < JSCAN_BLOCK; i += 32)
+	{
+		__m256i v = _mm256_load_si256((const __m256i *)(pBlock + i));
+		__m256i o = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('[')));
+		__m256i c = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('}')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(']')));
+		__m256i s = _mm256_or_si256(
+			_mm256_or_si256(o, c),
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+		__m256i w = _mm256_or_si256(_mm256_cmpgt_epi8(space, v), _mm256_cmpeq_epi8(v, space));
+		eol |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)) << i;
+		ws |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(w) << i;
+		qt |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)) << i;
+		bs |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)) << i;
+		st |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(s) << i;
+		op |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(o) << i;
+		cl |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(c) << i;
+	}
+	pScan->whitespace = ws & ~eol;
+	pScan->quote = qt;
+	pScan->backslash = bs;
+	pScan->structural = st;
+	pScan->open = op;
+	pScan->close = cl;
+	pScan->eol = eol;
+}
+
+//------------------------------------------------------
+// AVX-512BW kernel, 1 x 64 bytes
+//
+JSCAN_TARGET("avx512f,avx512bw")
+JSCAN_NO_SANITIZE
+static void scanBlockAvx512(const char *pBlock, struct ScanBlock *pScan)
+{
+	__m512i v = _mm512_load_si512((const void *)pBlock);
+	unsigned long long eol = _mm512_cmpeq_epi8_mask(v, _mm512_setzero_si512());
+	pScan->eol = eol;
+	pScan->whitespace = _mm512_cmple_epi8_mask(v, _mm512_set1_epi8(' ')) & ~eol;
+	pScan->quote = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('"'));
+	pScan->backslash = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\\'));
+	pScan->open = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('{')) |
+				  _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('['));
+	pScan->close = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('}')) |
+				   _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(']'));
+	pScan->structural = pScan->open | pScan->close |
+						_mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(':')) |
+						_mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(','));
+}
+#endif
+
+//------------------------------------------------------
+// Runtime dispatch
+// - scanLevel is the selected kernel, -1 'til the first scan picks the
+//   best supported one, scanKernels maps it to its function so the kernel
+//   used and jScanKernelName() always agree
+// - atomic, scans run on the worker threads of JsonLines and JsonArray,
+//   the first scans of several threads pick the same kernel
+//
+static const ScanBlockFn scanKernels[] = {
+#ifdef JSCAN_X86
+	scanBlockScalar, scanBlockSse42, scanBlockAvx2, scanBlockAvx512
+#else
+	scanBlockScalar, scanBlockScalar, scanBlockScalar, scanBlockScalar
+#endif
+};
+
+static std::atomic<int> scanLevel(-1);
+
+static int scanSupported()
+{
+#ifdef JSCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512bw"))
+		return JSCAN_AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return JSCAN_AVX2;
+	if (__builtin_cpu_supports("sse4.2"))
+		return JSCAN_SSE42;
+#endif
+	return JSCAN_SCALAR;
+}
+
+// scanSelected
+// - level of the selected kernel, the best supported one if none is selected yet
+//
+static int scanSelected()
+{
+	int level = scanLevel.load(std::memory_order_acquire);
+	if (level < 0)
+	{
+		static const int supported = scanSupported(); // initialized once, thread safe
+		int none = -1;
+		if (scanLevel.compare_exchange_strong(none, supported, std::memory_order_acq_rel, std::memory_order_acquire))
+			level = supported;
+		else
+			level = none; // selected by another thread or jScanSelect()
+	}
+	return level;
+}
+
+static inline ScanBlockFn scanKernel()
+{
+	return scanKernels[scanSelected()];
+}
+
+int jonaskgandersson::jScanSelect(int level)
+{
+	int supported = scanSupported();
+	if (level > supported)
+		level = supported;
+	if (level < JSCAN_SCALAR)
+		level = JSCAN_SCALAR;
+	scanLevel.store(level, std::memory_order_release);
+	return level;
+}
+
+const char *jonaskgandersson::jScanKernelName()
+{
+	static const char *names[] = {"scalar", "sse4.2", "avx2", "avx512bw"};
+	return names[scanSelected()];
+}
+
+void jonaskgandersson::jScanBlock(const char *pBlock, struct ScanBlock *pScan)
+{
+	scanKernel()(pBlock, pScan);
+}
+
+//------------------------------------------------------
+// Scanning functions
+//
+
+// findEscaped
+// - returns mask of chars escaped by a '\\' in the block
+// - a run of '\\' escapes the char after it when the run has odd length
+// - adding the run starts to the backslash mask carries each run to the
+//   bit after it, the parity of that bit against the parity of the run
+//   start gives the parity of the run length
+// - pCarry holds 1 when the first char of the next block is escaped
+//
+static unsigned long long findEscaped(unsigned long long backslash, unsigned long long *pCarry)
+{
+	const unsigned long long evenBits = 0x5555555555555555ULL;
+	unsigned long long followsEscape, oddStarts, sum, invertMask;
+	if (backslash == 0)
+	{
+		unsigned long long escaped = *pCarry;
+		*pCarry = 0;
+		return escaped;
+	}
+	backslash &= ~*pCarry; // an escaped '\\' does not escape the next char
+	followsEscape = (backslash << 1) | *pCarry;
+	oddStarts = backslash & ~evenBits & ~followsEscape;
+	sum = oddStarts + backslash;
+	*pCarry = (sum < backslash) ? 1 : 0;
+	invertMask = sum << 1;
+	return (evenBits ^ invertMask) & followsEscape;
+}
+
+// jScanString
+// - unescaped quotes found per block with findEscaped()
+// - without vector kernel a byte loop is faster than classifying blocks
+// - with pEnd no block starting at or after pEnd is read
+//
+const char *jonaskgandersson::jScanString(const char *sp, const char *pEnd)
+{
+	struct ScanBlock scan;
+	ScanBlockFn scanBlockFn = scanKernel(); // one kernel for the whole scan
+	const char *pBlock = (const char *)((uintptr_t)sp & ~(uintptr_t)(JSCAN_BLOCK - 1));
+	unsigned long long before = ((unsigned long long)1 << (sp - pBlock)) - 1;
+	unsigned long long carry = 0;
+	unsigned long long stop;
+	short skipch = 0;
+
+	if ((pEnd != NULL) && (sp >= pEnd))
+		return pEnd;
+	if (scanBlockFn == scanBlockScalar)
+	{
+		while ((sp != pEnd) && (*sp != '\0'))
+		{
+			if (skipch)
+				skipch = 0;
+			else if (*sp == '\\')
+				skipch = 1;
+			else if (*sp == '"')
+				break;
+			sp++;
+		}
+		return sp;
+	}
+	// bytes before sp are not part of the string
+	scanBlockFn(pBlock, &scan);
+	stop = ((scan.quote & ~findEscaped(scan.backslash & ~before, &carry)) | scan.eol) & ~before;
+	while (!stop)
+	{
+		pBlock += JSCAN_BLOCK;
+		if ((pEnd != NULL) && (pBlock >= pEnd))
+			return pEnd;
+		scanBlockFn(pBlock, &scan);
+		stop = (scan.quote & ~findEscaped(scan.backslash, &carry)) | scan.eol;
+	}
+	sp = pBlock + ctz64(stop);
+	return ((pEnd != NULL) && (sp > pEnd)) ? pEnd : sp;
+}
+
+// jScanWhitespace
+// - first block is read from the aligned address below sp,
+//   bits for bytes before sp are shifted out
+// - without vector kernel a byte loop is faster than classifying blocks
+// - with pEnd no block starting at or after pEnd is read
+//
+const char *jonaskgandersson::jScanWhitespace(const char *sp, const char *pEnd)
+{
+	struct ScanBlock scan;
+	ScanBlockFn scanBlockFn = scanKernel(); // one kernel for the whole scan
+	const char *pBlock = (const char *)((uintptr_t)sp & ~(uintptr_t)(JSCAN_BLOCK - 1));
+	unsigned long long stop;
+
+	if ((pEnd != NULL) && (sp >= pEnd))
+		return pEnd;
+	if (scanBlockFn == scanBlockScalar)
+	{
+		while ((sp != pEnd) && (*sp != '\0') && (*sp <= ' '))
+			sp++;
+		return sp;
+	}
+	scanBlockFn(pBlock, &scan);
+	stop = ~scan.whitespace >> (sp - pBlock);
+	if (stop)
+		sp += ctz64(stop);
+	else
+	{
+		while (1)
+		{
+			pBlock += JSCAN_BLOCK;
+			if ((pEnd != NULL) && (pBlock >= pEnd))
+				return pEnd;
+			scanBlockFn(pBlock, &scan);
+			stop = ~scan.whitespace;
+			if (stop)
+				break;
+		}
+		sp = pBlock + ctz64(stop);
+	}
+	return ((pEnd != NULL) && (sp > pEnd)) ? pEnd : sp;
+}
+
+// prefixXor
+// - bit n of the result is the xor of bits 0..n, with the unescaped
+//   quotes of a block it is the mask of chars inside strings (the
+//   opening quote included, the closing quote not)
+//
+static unsigned long long prefixXor(unsigned long long bits)
+{
+	bits ^= bits << 1;
+	bits ^= bits << 2;
+	bits ^= bits << 4;
+	bits ^= bits << 8;
+	bits ^= bits << 16;
+	bits ^= bits << 32;
+	return bits;
+}
+
+// jScanSkip
+// - brackets outside strings are counted a block at a time, a block
+//   that can not close the object/array adds its open minus close
+//   brackets to the depth
+// - the block that may close it (or holds a '\0') is walked bracket by bracket
+// - chars escaped by '\\' are skipped in and out of strings, as by findEscaped()
+// - without vector kernel a byte loop is faster than classifying blocks
+// - with pEnd no block starting at or after pEnd is read, bits at or
+//   after pEnd are dropped
+//
+const char *jonaskgandersson::jScanSkip(const char *sp, const char *pEnd)
+{
+	struct ScanBlock scan;
+	ScanBlockFn scanBlockFn = scanKernel(); // one kernel for the whole scan
+	const char *pBlock = (const char *)((uintptr_t)sp & ~(uintptr_t)(JSCAN_BLOCK - 1));
+	unsigned long long before = ((unsigned long long)1 << (sp - pBlock)) - 1;
+	unsigned long long carry = 0, inString = 0;
+	unsigned long long escaped, open, close, stop, bit;
+	long depth = 1;
+	short skipch = 0, quoted = 0;
+
+	if ((pEnd != NULL) && (sp >= pEnd))
+		return pEnd;
+	if (scanBlockFn == scanBlockScalar)
+	{
+		while ((sp != pEnd) && (*sp != '\0'))
+		{
+			if (skipch)
+				skipch = 0;
+			else if (*sp == '\\')
+				skipch = 1;
+			else if (*sp == '"')
+				quoted = !quoted;
+			else if (!quoted && ((*sp == '{') || (*sp == '[')))
+				depth++;
+			else if (!quoted && ((*sp == '}') || (*sp == ']')) && (--depth == 0))
+				break;
+			sp++;
+		}
+		return sp;
+	}
+	// bytes before sp are not part of the object/array
+	scanBlockFn(pBlock, &scan);
+	scan.backslash &= ~before;
+	scan.quote &= ~before;
+	scan.open &= ~before;
+	scan.close &= ~before;
+	scan.eol &= ~before;
+	while (1)
+	{
+		if ((pEnd != NULL) && (pBlock + JSCAN_BLOCK > pEnd))
+		{
+			stop = ((unsigned long long)1 << (pEnd - pBlock)) - 1;
+			scan.open &= stop;
+			scan.close &= stop;
+			scan.eol |= ~stop; // pEnd is read as '\0'
+		}
+		escaped = findEscaped(scan.backslash, &carry);
+		inString = prefixXor(scan.quote & ~escaped) ^ inString;
+		open = scan.open & ~(inString | escaped);
+		close = scan.close & ~(inString | escaped);
+		if ((scan.eol == 0) && (depth > popcount64(close)))
+			depth += popcount64(open) - popcount64(close);
+		else
+		{
+			stop = open | close | scan.eol;
+			while (stop)
+			{
+				bit = stop & (0 - stop);
+				sp = pBlock + ctz64(stop);
+				if (scan.eol & bit)
+					return ((pEnd != NULL) && (sp > pEnd)) ? pEnd : sp;
+				if (open & bit)
+					depth++;
+				else if (--depth == 0)
+					return sp;
+				stop ^= bit;
+			}
+		}
+		inString = (unsigned long long)((long long)inString >> 63); // carry string state to next block
+		pBlock += JSCAN_BLOCK;
+		if ((pEnd != NULL) && (pBlock >= pEnd))
+			return pEnd;
+		scanBlockFn(pBlock, &scan);
+	}
+}
+
+// jScanSeparators
+// - blocks are read as by jScanSkip(), a block where the depth can not
+//   get back to 1 adds its open minus close brackets to the depth
+// - other blocks are walked bracket by bracket, the separators in the
+//   runs between brackets at depth 1 are kept if they are ',' (':' is
+//   structural too)
+//
+const char *jonaskgandersson::jScanSeparators(const char *sp, const char *pEnd, const char **pSeparators, size_t maxSeparators, size_t *pCount)
+{
+	struct ScanBlock scan;
+	ScanBlockFn scanBlockFn = scanKernel(); // one kernel for the whole scan
+	const char *pBlock = (const char *)((uintptr_t)sp & ~(uintptr_t)(JSCAN_BLOCK - 1));
+	unsigned long long before = ((unsigned long long)1 << (sp - pBlock)) - 1;
+	unsigned long long carry = 0, inString = 0;
+	unsigned long long escaped, open, close, separator, stop, bit;
+	long depth = 1;
+	int start, end;
+	short skipch = 0, quoted = 0;
+
+	*pCount = 0;
+	if ((pEnd != NULL) && (sp >= pEnd))
+		return pEnd;
+	if (maxSeparators == 0)
+		return NULL;
+	if (scanBlockFn == scanBlockScalar)
+	{
+		while ((sp != pEnd) && (*sp != '\0'))
+		{
+			if (skipch)
+				skipch = 0;
+			else if (*sp == '\\')
+				skipch = 1;
+			else if (*sp == '"')
+				quoted = !quoted;
+			else if (!quoted)
+			{
+				if ((*sp == '{') || (*sp == '['))
+					depth++;
+				else if (((*sp == '}') || (*sp == ']')) && (--depth == 0))
+					break;
+				else if ((*sp == ',') && (depth == 1))
+				{
+					pSeparators[(*pCount)++] = sp;
+					if (*pCount == maxSeparators)
+						return NULL;
+				}
+			}
+			sp++;
+		}
+		return sp;
+	}
+	// bytes before sp are not part of the object/array
+	scanBlockFn(pBlock, &scan);
+	scan.backslash &= ~before;
+	scan.quote &= ~before;
+	scan.open &= ~before;
+	scan.close &= ~before;
+	scan.structural &= ~before;
+	scan.eol &= ~before;
+	while (1)
+	{
+		if ((pEnd != NULL) && (pBlock + JSCAN_BLOCK > pEnd))
+		{
+			stop = ((unsigned long long)1 << (pEnd - pBlock)) - 1;
+			scan.open &= stop;
+			scan.close &= stop;
+			scan.structural &= stop;
+			scan.eol |= ~stop; // pEnd is read as '\0'
+		}
+		escaped = findEscaped(scan.backslash, &carry);
+		inString = prefixXor(scan.quote & ~escaped) ^ inString;
+		open = scan.open & ~(inString | escaped);
+		close = scan.close & ~(inString | escaped);
+		if ((scan.eol == 0) && (depth > popcount64(close) + 1))
+			depth += popcount64(open) - popcount64(close);
+		else
+		{
+			separator = scan.structural & ~(scan.open | scan.close | inString | escaped);
+			stop = open | close | scan.eol;
+			start = 0;
+			while (1)
+			{
+				end = stop ? ctz64(stop) : JSCAN_BLOCK;
+				if (depth == 1) // separators between the last bracket and this one
+				{
+					bit = separator & ((start < JSCAN_BLOCK) ? ~0ULL << start : 0) &
+						  ((end < JSCAN_BLOCK) ? ((unsigned long long)1 << end) - 1 : ~0ULL);
+					for (; bit; bit &= bit - 1)
+					{
+						sp = pBlock + ctz64(bit);
+						if (*sp != ',')
+							continue; // ':' of an object
+						pSeparators[(*pCount)++] = sp;
+						if (*pCount == maxSeparators)
+							return NULL;
+					}
+				}
+				if (stop == 0)
+					break;
+				bit = stop & (0 - stop);
+				sp = pBlock + end;
+				if (scan.eol & bit)
+					return ((pEnd != NULL) && (sp > pEnd)) ? pEnd : sp;
+				if (open & bit)
+					depth++;
+				else if (--depth == 0)
+					return sp;
+				stop ^= bit;
+				start = end + 1;
+			}
+		}
+		inString = (unsigned long long)((long long)inString >> 63); // carry string state to next block
+		pBlock += JSCAN_BLOCK;
+		if ((pEnd != NULL) && (pBlock >= pEnd))
+			return pEnd;
+		scanBlockFn(pBlock, &scan);
+	}
+}
+
+// hexDigit
+// - value of a hex digit, -1 if not a hex digit
+//
+static inline int hexDigit(char c)
+{
+	if ((c >= '0') && (c <= '9'))
+		return c - '0';
+	if ((c >= 'a') && (c <= 'f'))
+		return c - 'a' + 10;
+	if ((c >= 'A') && (c <= 'F'))
+		return c - 'A' + 10;
+	return -1;
+}
+
+// hex4
+// - value of "XXXX" at sp, -1 if not 4 hex digits
+//
+static inline long hex4(const char *sp)
+{
+	int d0 = hexDigit(sp[0]), d1 = hexDigit(sp[1]), d2 = hexDigit(sp[2]), d3 = hexDigit(sp[3]);
+	if ((d0 | d1 | d2 | d3) < 0)
+		return -1;
+	return (d0 << 12) | (d1 << 8) | (d2 << 4) | d3;
+}
+
+// jScanUnescape
+// - 16 chars are copied at a time while source and destination have room,
+//   the copy is kept up to the first '\\' (SSE2, part of every x86-64 CPU)
+// - the last chars, or all without SSE2, are copied in a byte loop
+// - escapes are decoded one at a time, "\uXXXX" to UTF-8, a surrogate pair
+//   to one 4 byte sequence, a lone surrogate to U+FFFD
+// - once the destination is full, decoded chars are only counted
+//
+long long jonaskgandersson::jScanUnescape(const char *sp, size_t length, char *pDest, size_t destLen)
+{
+	const char *pEnd = sp + length;
+	size_t room = (destLen > 0) ? destLen - 1 : 0;
+	size_t written = 0, total = 0, n, i;
+	char decoded[4];
+	long code, low;
+
+	while (sp != pEnd)
+	{
+#if defined(JSCAN_X86) && defined(__SSE2__)
+		if ((pEnd - sp >= 16) && (room - written >= 16))
+		{
+			__m128i v = _mm_loadu_si128((const __m128i *)sp);
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+			_mm_storeu_si128((__m128i *)(pDest + written), v);
+			n = (mask == 0) ? 16 : (size_t)ctz64(mask);
+			sp += n;
+			written += n;
+			total += n;
+			if (mask == 0)
+				continue;
+		}
+		else
+#endif
+		{
+			for (; (sp != pEnd) && (*sp != '\\'); sp++, total++)
+			{
+				if (written < room)
+					pDest[written++] = *sp;
+				else
+					room = written; // cut, nothing more is written
+			}
+			if (sp == pEnd)
+				break;
+		}
+
+		// sp -> '\\'
+		if (sp + 1 == pEnd)
+			return -1; // '\' ends the string
+		n = 1;
+		switch (sp[1])
+		{
+		case '\"':
+		case '\\':
+		case '/':
+			decoded[0] = sp[1];
+			break;
+		case 'b':
+			decoded[0] = '\b';
+			break;
+		case 'f':
+			decoded[0] = '\f';
+			break;
+		case 'n':
+			decoded[0] = '\n';
+			break;
+		case 'r':
+			decoded[0] = '\r';
+			break;
+		case 't':
+			decoded[0] = '\t';
+			break;
+		case 'u':
+			if ((pEnd - sp < 6) || ((code = hex4(sp + 2)) < 0))
+				return -1; // bad \uXXXX
+			if ((code >= 0xd800) && (code <= 0xdbff) && (pEnd - sp >= 12) &&
+				(sp[6] == '\\') && (sp[7] == 'u') && ((low = hex4(sp + 8)) >= 0xdc00) && (low <= 0xdfff))
+			{
+				code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00); // surrogate pair
+				sp += 6;
+			}
+			else if ((code >= 0xd800) && (code <= 0xdfff))
+				code = 0xfffd; // lone surrogate
+			if (code < 0x80)
+				decoded[0] = (char)code;
+			else if (code < 0x800)
+			{
+				decoded[0] = (char)(0xc0 | (code >> 6));
+				decoded[1] = (char)(0x80 | (code & 0x3f));
+				n = 2;
+			}
+			else if (code < 0x10000)
+			{
+				decoded[0] = (char)(0xe0 | (code >> 12));
+				decoded[1] = (char)(0x80 | ((code >> 6) & 0x3f));
+				decoded[2] = (char)(0x80 | (code & 0x3f));
+				n = 3;
+			}
+			else
+			{
+				decoded[0] = (char)(0xf0 | (code >> 18));
+				decoded[1] = (char)(0x80 | ((code >> 12) & 0x3f));
+				decoded[2] = (char)(0x80 | ((code >> 6) & 0x3f));
+				decoded[3] = (char)(0x80 | (code & 0x3f));
+				n = 4;
+			}
+			sp += 4;
+			break;
+		default:
+			return -1; // bad escape
+		}
+		sp += 2;
+		if (n <= room - written)
+			for (i = 0; i < n; i++)
+				pDest[written++] = decoded[i];
+		else
+			room = written;
+		total += n;
+	}
+	if (destLen > 0)
+		pDest[written] = '\0';
+	return (long long)total;
+}
+
+// utf8Length
+// - length of the UTF-8 sequence at sp, 0 if it is not valid
+// - the second byte range depends on the first byte, this rules out
+//   overlong forms, surrogates (U+D800..U+DFFF) and code points above U+10FFFF
+//
+static int utf8Length(const unsigned char *sp, const unsigned char *pEnd)
+{
+	unsigned char c = sp[0], low = 0x80, high = 0xbf;
+	int n, i;
+	if ((c >= 0xc2) && (c <= 0xdf))
+		n = 2;
+	else if ((c >= 0xe0) && (c <= 0xef))
+	{
+		n = 3;
+		if (c == 0xe0)
+			low = 0xa0; // overlong
+		else if (c == 0xed)
+			high = 0x9f; // surrogate
+	}
+	else if ((c >= 0xf0) && (c <= 0xf4))
+	{
+		n = 4;
+		if (c == 0xf0)
+			low = 0x90; // overlong
+		else if (c == 0xf4)
+			high = 0x8f; // > U+10FFFF
+	}
+	else
+		return 0;
+	if (pEnd - sp < n)
+		return 0;
+	if ((sp[1] < low) || (sp[1] > high))
+		return 0;
+	for (i = 2; i < n; i++)
+		if ((sp[i] < 0x80) || (sp[i] > 0xbf))
+			return 0;
+	return n;
+}
+
+// jScanCheckString
+// - 16 chars are classified at a time (SSE2, part of every x86-64 CPU),
+//   runs of printable ASCII are skipped without looking at each char
+// - the first '"', '\\', control char or byte >= 0x80 is checked alone:
+//   escapes are read whole, a UTF-8 sequence is checked with utf8Length()
+// - the last chars, or all without SSE2, are checked in a byte loop
+//
+const char *jonaskgandersson::jScanCheckString(const char *sp, const char *pEnd)
+{
+	unsigned char c;
+	int n;
+
+	while (sp != pEnd)
+	{
+#if defined(JSCAN_X86) && defined(__SSE2__)
+		if (pEnd - sp >= 16)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i *)sp);
+			// signed compare, bytes >= 0x80 are below ' ' too
+			__m128i special = _mm_or_si128(_mm_cmplt_epi8(v, _mm_set1_epi8(' ')),
+										   _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+														_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))));
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(special);
+			if (mask == 0)
+			{
+				sp += 16;
+				continue;
+			}
+			sp += ctz64(mask);
+		}
+		else
+#endif
+		{
+			c = (unsigned char)*sp;
+			if ((c >= ' ') && (c < 0x80) && (c != '"') && (c != '\\'))
+			{
+				sp++;
+				continue;
+			}
+		}
+
+		c = (unsigned char)*sp;
+		if (c == '"')
+			return sp;
+		if (c == '\\')
+		{
+			if (pEnd - sp < 2)
+				return sp;
+			switch (sp[1])
+			{
+			case '"':
+			case '\\':
+			case '/':
+			case 'b':
+			case 'f':
+			case 'n':
+			case 'r':
+			case 't':
+				sp += 2;
+				break;
+			case 'u':
+				if ((pEnd - sp < 6) || (hex4(sp + 2) < 0))
+					return sp;
+				sp += 6;
+				break;
+			default:
+				return sp; // bad escape
+			}
+		}
+		else if (c < ' ')
+			return sp; // control char
+		else
+		{
+			n = utf8Length((const unsigned char *)sp, (const unsigned char *)pEnd);
+			if (n == 0)
+				return sp;
+			sp += n;
+		}
+	}
+	return pEnd;
+}
@@ -0,0 +1,923 @@
+#include "../jsonRW.hpp"
+#include "../jsonScan.hpp"
+#include "../jsonFile.hpp"
+#include "../jsonLines.hpp"
+#include "../jsonArray.hpp"
+#include "../jsonPush.hpp"
+#include "../jsonDom.hpp"
+#include "../ascii_num.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace jonaskgandersson;
+
+//-------------------------------------------------
+// Time fn() repeated until at least 0.2s has passed
+// returns MB/s for processing len bytes per call
+//
+template <class F>
+static double throughput(size_t len, F fn)
+{
+    typedef std::chrono::steady_clock clock;
+    long calls = 0;
+    clock::time_point start = clock::now();
+    double seconds;
+    do
+    {
+        fn();
+        calls++;
+        seconds = std::chrono::duration<double>(clock::now() - start).count();
+    } while (seconds < 0.2);
+    return (double)len * calls / seconds / 1e6;
+}
+
+// ns per lookup for fn() doing lookups lookups per call
+template <class F>
+static double nsPerLookup(int lookups, F fn)
+{
+    return 1e3 / throughput(lookups, fn); // throughput() of lookups "bytes" is millions per second
+}
+
+// Byte by byte string scan, as used before the block scanner
+static const char *byteLoopString(const char *p)
+{
+    short skipch = 0;
+    while (*p != '\0')
+    {
+        if (skipch)
+            skipch = 0;
+        else if (*p == '\\')
+            skipch = 1;
+        else if (*p == '"')
+            break;
+        p++;
+    }
+    return p;
+}
+
+//-------------------------------------------------
+// Strings with many escapes: log lines with quotes, paths and \uXXXX
+//
+static void benchStrings()
+{
+    std::string json = "{";
+    char key[32];
+    int i, j;
+    for (i = 0; i < 200; i++)
+    {
+        sprintf(key, "\"key%d\":\"", i);
+        json += key;
+        for (j = 0; j < 40; j++)
+            json += "msg=\\\"C:\\\\temp\\\\log\\\" \\u00e5\\n\\t";
+        json += "\",";
+    }
+    json += "\"last\":1}";
+    const char *pJson = json.c_str();
+    volatile size_t sink = 0;
+
+    printf("Strings, %d bytes, escape heavy\n", (int)json.size());
+    printf("  %-10s %8.0f MB/s\n", "byte loop", throughput(json.size(), [&]() {
+               const char *p = pJson;
+               size_t strings = 0;
+               while ((p = strchr(p, '"')) != NULL)
+               {
+                   p = byteLoopString(p + 1) + 1;
+                   strings++;
+               }
+               sink = sink + strings;
+           }));
+    for (int level = JSCAN_SCALAR; level <= JSCAN_AVX512; level++)
+    {
+        if (jScanSelect(level) != level)
+            break;
+        printf("  %-10s %8.0f MB/s\n", jScanKernelName(), throughput(json.size(), [&]() {
+                   ReadElement elem;
+                   Json::getElement(pJson, "{'last'", &elem);
+                   sink = sink + elem.bytelen;
+               }));
+    }
+    jScanSelect(JSCAN_AVX512);
+}
+
+// Byte by byte unescape of a copied string, as done by callers before getString()
+static size_t byteLoopUnescape(char *p)
+{
+    char *pOut = p;
+    char *pStart = p;
+    unsigned int code;
+    for (; *p != '\0'; p++)
+    {
+        if (*p != '\\')
+        {
+            *pOut++ = *p;
+            continue;
+        }
+        switch (*++p)
+        {
+        case 'n':
+            *pOut++ = '\n';
+            break;
+        case 't':
+            *pOut++ = '\t';
+            break;
+        case 'u':
+            code = 0;
+            for (int i = 1; i <= 4; i++)
+                code = code * 16 + ((p[i] <= '9') ? p[i] - '0' : (p[i] | 0x20) - 'a' + 10);
+            if (code < 0x80)
+                *pOut++ = (char)code;
+            else
+            {
+                *pOut++ = (char)(0xc0 | (code >> 6));
+                *pOut++ = (char)(0x80 | (code & 0x3f));
+            }
+            p += 4;
+            break;
+        default:
+            *pOut++ = *p;
+            break;
+        }
+    }
+    *pOut = '\0';
+    return pOut - pStart;
+}
+
+//-------------------------------------------------
+// Decoded strings, escape heavy and clean
+//
+static void benchUnescape()
+{
+    std::string escaped = "{\"s\":\"", clean = "{\"s\":\"";
+    int i;
+    for (i = 0; i < 2000; i++)
+    {
+        escaped += "msg=\\\"C:\\\\temp\\\\log\\\" \\u00e5\\n\\t";
+        clean += "msg='C:/temp/log' and some more text ";
+    }
+    escaped += "\"}";
+    clean += "\"}";
+    std::vector<char> dest(escaped.size() + clean.size());
+    volatile size_t sink = 0;
+
+    printf("Unescape, %d bytes\n", (int)escaped.size());
+    printf("  %-10s %8.0f MB/s\n", "byte loop", throughput(escaped.size(), [&]() {
+               Json::getValue(escaped.c_str(), "{'s'", NULL, dest.data(), (int)dest.size());
+               sink = sink + byteLoopUnescape(dest.data());
+           }));
+    printf("  %-10s %8.0f MB/s\n", "getString", throughput(escaped.size(), [&]() {
+               size_t length;
+               Json::getString(escaped.c_str(), "{'s'", NULL, dest.data(), dest.size(), &length);
+               sink = sink + length;
+           }));
+    printf("  %-10s %8.0f MB/s\n", "clean", throughput(clean.size(), [&]() {
+               size_t length;
+               Json::getString(clean.c_str(), "{'s'", NULL, dest.data(), dest.size(), &length);
+               sink = sink + length;
+           }));
+}
+
+//-------------------------------------------------
+// 12 fields below shared prefixes, read one by one and as a Batch
+//
+static void benchBatch()
+{
+    std::string json = "{\"id\":1,\"payload\":{\"body\":\"";
+    json += std::string(4000, 'x');
+    json += "\",\"meta\":{";
+    char field[64];
+    const char *queries[12];
+    char queryText[12][32];
+    long values[12];
+    int i;
+    for (i = 0; i < 12; i++)
+    {
+        sprintf(field, "%s\"f%d\":%d", i ? "," : "", i, i * 100);
+        json += field;
+        sprintf(queryText[i], "{'payload'{'meta'{'f%d'", i);
+        queries[i] = queryText[i];
+    }
+    json += "}}}";
+    const char *pJson = json.c_str();
+    volatile long sink = 0;
+
+    printf("Batch, %d bytes, 12 fields\n", (int)json.size());
+    printf("  %-10s %8.0f MB/s\n", "getValue", throughput(json.size(), [&]() {
+               for (int q = 0; q < 12; q++)
+                   Json::getValue(pJson, queries[q], NULL, &values[q]);
+               sink = sink + values[11];
+           }));
+    Json::Batch batch;
+    for (i = 0; i < 12; i++)
+        batch.add(queries[i], values[i]);
+    printf("  %-10s %8.0f MB/s\n", "getValues", throughput(json.size(), [&]() {
+               Json::getValues(pJson, batch);
+               sink = sink + values[11];
+           }));
+}
+
+// Trade record and its binding
+struct Trade
+{
+    long id;
+    long long time;
+    double price;
+    double quantity;
+    int venue;
+    bool buy;
+    char symbol[8];
+    char account[16];
+};
+
+static const BindField tradeFields[] = {
+    JSON_BIND(Trade, id), JSON_BIND(Trade, time), JSON_BIND(Trade, price), JSON_BIND(Trade, quantity),
+    JSON_BIND(Trade, venue), JSON_BIND(Trade, buy), JSON_BIND(Trade, symbol), JSON_BIND(Trade, account)};
+
+//-------------------------------------------------
+// Record of 8 fields and 4 other keys, read field by field and decoded
+//
+static void benchBind()
+{
+    const char *json = "{\"id\":918273,\"time\":1700000000123456789,\"symbol\":\"ACME\",\"price\":101.25,"
+                       "\"quantity\":350,\"venue\":4,\"flags\":[\"odd\",\"late\"],\"buy\":true,"
+                       "\"account\":\"ACC-000917\",\"note\":\"manual entry\",\"meta\":{\"src\":\"fix\"},\"seq\":88}";
+    size_t len = strlen(json);
+    Json::Binding binding(tradeFields);
+    Trade trade;
+    volatile long sink = 0;
+
+    printf("Binding, %d bytes, 8 fields\n", (int)len);
+    printf("  %-10s %8.0f MB/s\n", "getValue", throughput(len, [&]() {
+               Json::getValue(json, "{'id'", NULL, &trade.id);
+               Json::getValue(json, "{'time'", NULL, &trade.time);
+               Json::getValue(json, "{'price'", NULL, &trade.price);
+               Json::getValue(json, "{'quantity'", NULL, &trade.quantity);
+               Json::getValue(json, "{'venue'", NULL, &trade.venue);
+               Json::getValue(json, "{'buy'", NULL, &trade.buy);
+               Json::getString(json, "{'symbol'", NULL, trade.symbol, sizeof(trade.symbol), NULL);
+               Json::getString(json, "{'account'", NULL, trade.account, sizeof(trade.account), NULL);
+               sink = sink + trade.id + trade.venue;
+           }));
+    printf("  %-10s %8.0f MB/s\n", "decode", throughput(len, [&]() {
+               Json::decode(json, "", binding, &trade);
+               sink = sink + trade.id + trade.venue;
+           }));
+}
+
+// Digit by digit double, as used before the Eisel-Lemire parser (no exponents)
+static const char *digitLoopDouble(const char *p, double *result)
+{
+    double sign = 1.0, value, pow10;
+    if (*p == '-')
+    {
+        sign = -1.0;
+        p++;
+    }
+    for (value = 0.0; *p >= '0' && *p <= '9'; p++)
+        value = value * 10.0 + (*p - '0');
+    if (*p == '.')
+    {
+        for (p++, pow10 = 10.0; *p >= '0' && *p <= '9'; p++, pow10 *= 10.0)
+            value += (*p - '0') / pow10;
+    }
+    *result = sign * value;
+    return p;
+}
+
+//-------------------------------------------------
+// Array of 10000 random doubles, "%.17g" (round-trip) format
+//
+static void benchNumbers()
+{
+    std::mt19937_64 rng(1);
+    std::uniform_real_distribution<double> dist(-1000.0, 1000.0);
+    std::string json = "[";
+    char number[32];
+    int i;
+    for (i = 0; i < 10000; i++)
+    {
+        sprintf(number, "%s%.17g", i ? "," : "", dist(rng));
+        json += number;
+    }
+    json += "]";
+    const char *pJson = json.c_str();
+    std::vector<double> values(10000);
+    volatile double sink = 0;
+
+    printf("Numbers, %d bytes, 10000 doubles\n", (int)json.size());
+    printf("  %-10s %8.0f MB/s\n", "digit loop", throughput(json.size(), [&]() {
+               const char *p = pJson;
+               while (*p++ != ']')
+                   p = digitLoopDouble(p, &values[0]);
+               sink = sink + values[0];
+           }));
+    printf("  %-10s %8.0f MB/s\n", "strtod", throughput(json.size(), [&]() {
+               const char *p = pJson;
+               char *pEnd;
+               while (*p++ != ']')
+               {
+                   values[0] = strtod(p, &pEnd);
+                   p = pEnd;
+               }
+               sink = sink + values[0];
+           }));
+    printf("  %-10s %8.0f MB/s\n", "jRead_atof", throughput(json.size(), [&]() {
+               const char *p = pJson;
+               while (*p++ != ']')
+                   p = jRead_atof(p, &values[0]);
+               sink = sink + values[0];
+           }));
+    printf("  %-10s %8.0f MB/s\n", "getNumbers", throughput(json.size(), [&]() {
+               Json::getNumbers(pJson, "", NULL, &values[0], (int)values.size());
+               sink = sink + values[9999];
+           }));
+}
+
+// Digit by digit long, as used before the SWAR parser (no overflow check)
+static const char *digitLoopLong(const char *p, long *result)
+{
+    long x = 0;
+    int neg = 0;
+    if (*p == '-')
+    {
+        neg = 1;
+        p++;
+    }
+    while (*p >= '0' && *p <= '9')
+        x = (x * 10) + (*p++ - '0');
+    *result = neg ? -x : x;
+    return p;
+}
+
+//-------------------------------------------------
+// Array of 10000 ids and nanosecond timestamps (16 to 19 digits)
+//
+static void benchIntegers()
+{
+    std::mt19937_64 rng(2);
+    std::string json = "[";
+    char number[32];
+    int i;
+    for (i = 0; i < 10000; i++)
+    {
+        sprintf(number, "%s%lld", i ? "," : "", (long long)(rng() >> (1 + i % 10)));
+        json += number;
+    }
+    json += "]";
+    const char *pJson = json.c_str();
+    volatile long long sink = 0;
+
+    printf("Integers, %d bytes, 10000 64 bit ids\n", (int)json.size());
+    printf("  %-10s %8.0f MB/s\n", "digit loop", throughput(json.size(), [&]() {
+               const char *p = pJson;
+               long value = 0;
+               while (*p++ != ']')
+                   p = digitLoopLong(p, &value);
+               sink = sink + value;
+           }));
+    printf("  %-10s %8.0f MB/s\n", "strtoll", throughput(json.size(), [&]() {
+               const char *p = pJson;
+               char *pEnd;
+               long long value = 0;
+               while (*p++ != ']')
+               {
+                   value = strtoll(p, &pEnd, 10);
+                   p = pEnd;
+               }
+               sink = sink + value;
+           }));
+    printf("  %-10s %8.0f MB/s\n", "jRead_atoll", throughput(json.size(), [&]() {
+               const char *p = pJson;
+               long long value = 0;
+               while (*p++ != ']')
+                   p = jRead_atoll(p, &value);
+               sink = sink + value;
+           }));
+}
+
+//-------------------------------------------------
+// 100 values nested 50 deep, skipped to read the key after them
+//
+static void benchNesting()
+{
+    std::string json = "{";
+    int i, j;
+    for (i = 0; i < 100; i++)
+    {
+        json += "\"v\":";
+        for (j = 0; j < 50; j++)
+            json += (j & 1) ? "[1," : "{\"k\":";
+        json += "0";
+        for (j = 49; j >= 0; j--)
+            json += (j & 1) ? "]" : "}";
+        json += ",";
+    }
+    json += "\"last\":1}";
+    const char *pJson = json.c_str();
+    volatile long sink = 0;
+
+    printf("Nesting, %d bytes, 50 deep\n", (int)json.size());
+    printf("  %-10s %8.0f MB/s\n", "getValue", throughput(json.size(), [&]() {
+               long value = 0;
+               Json::getValue(pJson, "{'last'", NULL, &value);
+               sink = sink + value;
+           }));
+}
+
+//-------------------------------------------------
+// 64 MB file, read into a buffer or memory mapped, then queried
+//
+static void benchFile()
+{
+    std::string json = "{\"records\":[";
+    char record[96];
+    int i;
+    for (i = 0; json.size() < (64 << 20); i++)
+    {
+        sprintf(record, "%s{\"id\":%d,\"name\":\"record %d\",\"values\":[1.5,2.5,3.5]}", i ? "," : "", i, i);
+        json += record;
+    }
+    json += "],\"last\":1}";
+    FILE *pFile = fopen("jsonBench.json", "wb");
+    if (pFile == NULL)
+        return;
+    fwrite(json.data(), 1, json.size(), pFile);
+    fclose(pFile);
+    volatile long sink = 0;
+
+    printf("File, %d MB, last key\n", (int)(json.size() >> 20));
+    printf("  %-10s %8.0f MB/s\n", "read", throughput(json.size(), [&]() {
+               FILE *pIn = fopen("jsonBench.json", "rb");
+               std::vector<char> text(json.size() + 1);
+               text.resize(fread(text.data(), 1, json.size(), pIn));
+               text.push_back('\0');
+               fclose(pIn);
+               long value = 0;
+               Json::getValue(text.data(), "{'last'", NULL, &value);
+               sink = sink + value;
+           }));
+    printf("  %-10s %8.0f MB/s\n", "mmap", throughput(json.size(), [&]() {
+               JsonFile file;
+               long value = 0;
+               if (file.open("jsonBench.json", JFILE_SEQUENTIAL) == JFILE_OK)
+               {
+                   Json mapped(file);
+                   mapped.getValue("{'last'", value);
+               }
+               sink = sink + value;
+           }));
+    remove("jsonBench.json");
+}
+
+// Sum of ids, one total per worker so the handler needs no lock
+static void sumIds(const JsonLines::Record &record, void *pUser)
+{
+    long id = 0;
+    Json::getValue(record.pResults[0], id);
+    ((long *)pUser)[record.worker * 16] += id; // a cache line per worker
+}
+
+//-------------------------------------------------
+// NDJSON, records read by 1 and by all cores
+//
+static void benchLines()
+{
+    std::string text;
+    char record[96];
+    int i;
+    for (i = 0; text.size() < (64 << 20); i++)
+    {
+        sprintf(record, "{\"name\":\"record %d\",\"values\":[1.5,2.5,3.5],\"id\":%d}\n", i, i);
+        text += record;
+    }
+    int cores = (int)std::thread::hardware_concurrency();
+    std::vector<long> totals(16 * (cores > 0 ? cores : 1));
+    JsonLines lines;
+    lines.addQuery("{'id'");
+
+    printf("JSON Lines, %d MB, %d records, %d cores\n", (int)(text.size() >> 20), i, cores);
+    printf("  %-10s %8.0f MB/s\n", "1 thread", throughput(text.size(), [&]() {
+               lines.read(text.data(), text.size(), sumIds, totals.data(), JLINES_UNORDERED, 1);
+           }));
+    printf("  %-10s %8.0f MB/s\n", "unordered", throughput(text.size(), [&]() {
+               lines.read(text.data(), text.size(), sumIds, totals.data(), JLINES_UNORDERED, 0);
+           }));
+    printf("  %-10s %8.0f MB/s\n", "ordered", throughput(text.size(), [&]() {
+               lines.read(text.data(), text.size(), sumIds, totals.data(), JLINES_ORDERED, 0);
+           }));
+}
+
+// Sum of ids of array elements, one total per worker
+static void sumElementIds(const JsonArray::Record &record, void *pUser)
+{
+    long id = 0;
+    Json::getValue(record.pResults[0], id);
+    ((long *)pUser)[record.worker * 16] += id; // a cache line per worker
+}
+
+//-------------------------------------------------
+// Top-level array, elements read by 1 and by all cores
+//
+static void benchArray()
+{
+    std::string json = "[";
+    char record[128];
+    int i;
+    for (i = 0; json.size() < (64 << 20); i++)
+    {
+        sprintf(record, "%s{\"name\":\"record %d\",\"values\":[1.5,2.5,3.5],\"tags\":{\"a\":1},\"id\":%d}", i ? "," : "", i, i);
+        json += record;
+    }
+    json += "]";
+    int cores = (int)std::thread::hardware_concurrency();
+    std::vector<long> totals(16 * (cores > 0 ? cores : 1));
+    JsonArray array;
+    array.addQuery("{'id'");
+
+    printf("Array, %d MB, %d elements, %d cores\n", (int)(json.size() >> 20), i, cores);
+    printf("  %-10s %8.0f MB/s\n", "sequential", throughput(json.size(), [&]() {
+               // getArrayElement() walk, one element after the other
+               const char *pJson = json.c_str();
+               struct ReadElement element, result;
+               long id;
+               while (1)
+               {
+                   pJson = Json::getArrayElement(pJson, &element);
+                   if (element.dataType == JREAD_ERROR)
+                       break;
+                   Json::getElement((const char *)element.pValue, element.bytelen, "{'id'", NULL, &result);
+                   if (Json::getValue(result, id) == ReadError::JS_OK)
+                       totals[0] += id;
+               }
+           }));
+    printf("  %-10s %8.0f MB/s\n", "1 thread", throughput(json.size(), [&]() {
+               array.read(json.data(), json.size(), sumElementIds, totals.data(), JARRAY_UNORDERED, 1);
+           }));
+    printf("  %-10s %8.0f MB/s\n", "unordered", throughput(json.size(), [&]() {
+               array.read(json.data(), json.size(), sumElementIds, totals.data(), JARRAY_UNORDERED, 0);
+           }));
+    printf("  %-10s %8.0f MB/s\n", "ordered", throughput(json.size(), [&]() {
+               array.read(json.data(), json.size(), sumElementIds, totals.data(), JARRAY_ORDERED, 0);
+           }));
+}
+
+//-------------------------------------------------
+// Push tokenizer, document fed in network sized fragments
+//
+static void benchPush()
+{
+    std::string json = "{\"records\":[";
+    char record[96];
+    int i;
+    for (i = 0; json.size() < (64 << 20); i++)
+    {
+        sprintf(record, "%s{\"id\":%d,\"name\":\"record %d\",\"values\":[1.5,2.5,-3e2]}", i ? "," : "", i, i);
+        json += record;
+    }
+    json += "]}";
+    volatile int sink = 0;
+
+    printf("Push, %d MB\n", (int)(json.size() >> 20));
+    for (size_t fragment = 64; fragment <= 65536; fragment *= 32)
+    {
+        printf("  %-10d %8.0f MB/s\n", (int)fragment, throughput(json.size(), [&]() {
+                   JsonPush push;
+                   int status = JPUSH_MORE;
+                   for (size_t offset = 0; offset < json.size(); offset += fragment)
+                       status = push.feed(json.data() + offset, std::min(fragment, json.size() - offset));
+                   sink = sink + status;
+               }));
+    }
+}
+
+// Sum of all numbers of a document
+class NumberSum : public Json::Handler
+{
+public:
+    NumberSum() : sum(0) {}
+    bool number(const struct ReadElement &element)
+    {
+        double value;
+        jRead_atofn((const char *)element.pValue, (const char *)element.pValue + element.bytelen, &value);
+        sum += value;
+        return true;
+    }
+    double sum;
+};
+
+//-------------------------------------------------
+// SAX parse, every value of the document
+//
+static void benchParse()
+{
+    std::string json = "{\"records\":[";
+    char record[96];
+    int i;
+    for (i = 0; json.size() < (64 << 20); i++)
+    {
+        sprintf(record, "%s{\"id\":%d,\"name\":\"record %d\",\"values\":[1.5,2.5,-3e2]}", i ? "," : "", i, i);
+        json += record;
+    }
+    json += "]}";
+    volatile double sink = 0;
+
+    printf("Parse, %d MB\n", (int)(json.size() >> 20));
+    printf("  %-10s %8.0f MB/s\n", "handler", throughput(json.size(), [&]() {
+               Json::Handler handler;
+               Json::parse(json.c_str(), handler);
+           }));
+    printf("  %-10s %8.0f MB/s\n", "sum", throughput(json.size(), [&]() {
+               NumberSum numbers;
+               Json::parse(json.c_str(), numbers);
+               sink = sink + numbers.sum;
+           }));
+}
+
+//-------------------------------------------------
+// Document of 256 KB built into a tree, then 100 records looked up
+//
+static void benchDom()
+{
+    std::string json = "{\"records\":[";
+    char record[96];
+    int records;
+    for (records = 0; json.size() < (256 << 10); records++)
+    {
+        sprintf(record, "%s{\"id\":%d,\"name\":\"record %d\",\"values\":[1.5,2.5,-3e2]}", records ? "," : "", records, records);
+        json += record;
+    }
+    json += "]}";
+    std::vector<char> arena(json.size() * 4);
+    JsonDom dom(arena.data(), arena.size());
+    Json::Query query("{'records'[*{'id'");
+    volatile long sink = 0;
+
+    printf("DOM, %d KB, %d records\n", (int)(json.size() >> 10), records);
+    printf("  %-10s %8.0f MB/s\n", "build", throughput(json.size(), [&]() {
+               dom.build(json.c_str(), json.size());
+           }));
+    printf("  %-10s %8.0f ns/query\n", "getValue", nsPerLookup(100, [&]() {
+               long id = 0;
+               for (int n = 0; n < 100; n++)
+               {
+                   int params[1] = {n * (records / 100)};
+                   Json::getValue(json.c_str(), json.size(), query, params, &id);
+                   sink = sink + id;
+               }
+           }));
+    dom.build(json.c_str(), json.size());
+    printf("  %-10s %8.0f ns/query\n", "find", nsPerLookup(100, [&]() {
+               long id = 0;
+               for (int n = 0; n < 100; n++)
+               {
+                   int params[1] = {n * (records / 100)};
+                   JsonDom::getValue(dom.find(query, params), id);
+                   sink = sink + id;
+               }
+           }));
+}
+
+//-------------------------------------------------
+// Object of 5000 feature flags, 100 flags near the end looked up
+//
+static void benchWide()
+{
+    std::string json = "{\"flags\":{";
+    char flag[64];
+    const int flags = 5000;
+    int i;
+    for (i = 0; i < flags; i++)
+    {
+        sprintf(flag, "%s\"feature-flag-%d\":%s", i ? "," : "", i, (i % 3) ? "true" : "false");
+        json += flag;
+    }
+    json += "}}";
+    std::vector<char> buffer(json.begin(), json.end());
+    buffer.push_back('\0');
+    Json doc(buffer.data(), (int)buffer.size());
+    std::vector<IndexEntry> index(4);
+    std::vector<KeySlot> slots(2 * 8192);
+    char queries[100][48];
+    for (i = 0; i < 100; i++)
+        sprintf(queries[i], "{'flags'{'feature-flag-%d'", flags - 1 - i * 7);
+    volatile long sink = 0;
+    auto lookup = [&]() {
+        bool on = false;
+        for (int q = 0; q < 100; q++)
+        {
+            doc.getValue(queries[q], on);
+            sink = sink + on;
+        }
+    };
+
+    doc.buildIndex(index.data(), (int)index.size());
+    printf("Wide object, %d keys, 100 lookups\n", flags);
+    printf("  %-10s %8.0f MB/s\n", "index", throughput(json.size(), lookup));
+    doc.useKeyTables(slots.data(), (int)slots.size());
+    printf("  %-10s %8.0f MB/s\n", "key table", throughput(json.size(), lookup));
+}
+
+// Sum of the prices matched by a wildcard query
+static bool sumPrices(const Json::Match &match, void *pUser)
+{
+    double price = 0;
+    Json::getValue(match.value, price);
+    *(double *)pUser += price;
+    return true;
+}
+
+//-------------------------------------------------
+// Order of 500 items, the price of every item read by one query per item and by a wildcard query
+//
+static void benchMatches()
+{
+    std::string json = "{\"id\":\"order-1\",\"items\":[";
+    char item[128];
+    const int items = 500;
+    int i;
+    for (i = 0; i < items; i++)
+    {
+        sprintf(item, "%s{\"sku\":\"SKU-%05d\",\"name\":\"item %d\",\"qty\":%d,\"price\":%d.%02d}", i ? "," : "", i, i, i % 7 + 1, i % 90 + 5, i % 100);
+        json += item;
+    }
+    json += "]}";
+    const char *pJson = json.c_str();
+    Json::Query itemQuery("{'items'[*{'price'");
+    Json::Query pricesQuery("{'items'[*]{'price'");
+    volatile double sink = 0;
+
+    printf("Wildcard query, %d items, %d bytes\n", items, (int)json.size());
+    printf("  %-10s %8.0f MB/s\n", "per item", throughput(json.size(), [&]() {
+               struct ReadElement list;
+               double total = 0, price;
+               Json::getElement(pJson, "{'items'", NULL, &list);
+               for (int n = 0; n < list.elements; n++)
+               {
+                   Json::getValue(pJson, itemQuery, &n, &price);
+                   total += price;
+               }
+               sink = sink + total;
+           }));
+    printf("  %-10s %8.0f MB/s\n", "wildcard", throughput(json.size(), [&]() {
+               double total = 0;
+               Json::getMatches(pJson, pricesQuery, NULL, sumPrices, &total);
+               sink = sink + total;
+           }));
+}
+
+//-------------------------------------------------
+// Message envelope, 3 fields 3 levels deep, read by query string, by a query
+// compiled per call and by query literal (parsed by the compiler)
+//
+static void benchLiteral()
+{
+    const char *json = "{\"envelope\":{\"routing\":{\"destination\":\"orders\",\"priority\":3},"
+                       "\"timestamps\":{\"created\":1700000000123,\"received\":1700000000456}},\"payload\":{\"v\":1}}";
+    size_t len = strlen(json);
+    long priority = 0, created = 0, received = 0;
+    volatile long sink = 0;
+
+    printf("Query literals, %d bytes, 3 fields\n", (int)len);
+    printf("  %-10s %8.0f MB/s\n", "string", throughput(len, [&]() {
+               Json::getValue(json, len, "{'envelope'{'routing'{'priority'", NULL, &priority);
+               Json::getValue(json, len, "{'envelope'{'timestamps'{'created'", NULL, &created);
+               Json::getValue(json, len, "{'envelope'{'timestamps'{'received'", NULL, &received);
+               sink = sink + priority + created + received;
+           }));
+    printf("  %-10s %8.0f MB/s\n", "Query()", throughput(len, [&]() {
+               Json::getValue(json, len, Json::Query("{'envelope'{'routing'{'priority'"), NULL, &priority);
+               Json::getValue(json, len, Json::Query("{'envelope'{'timestamps'{'created'"), NULL, &created);
+               Json::getValue(json, len, Json::Query("{'envelope'{'timestamps'{'received'"), NULL, &received);
+               sink = sink + priority + created + received;
+           }));
+    printf("  %-10s %8.0f MB/s\n", "literal", throughput(len, [&]() {
+               Json::getValue(json, len, JSON_QUERY("{'envelope'{'routing'{'priority'"), NULL, &priority);
+               Json::getValue(json, len, JSON_QUERY("{'envelope'{'timestamps'{'created'"), NULL, &created);
+               Json::getValue(json, len, JSON_QUERY("{'envelope'{'timestamps'{'received'"), NULL, &received);
+               sink = sink + priority + created + received;
+           }));
+}
+
+//-------------------------------------------------
+// Request of 2 KB, the same 3 queries in 3 stages (validation, routing, processing)
+//
+static void benchCache()
+{
+    std::string json = "{\"headers\":{";
+    char header[64];
+    int i;
+    for (i = 0; json.size() < 2000; i++)
+    {
+        sprintf(header, "%s\"x-header-%d\":\"value %d\"", i ? "," : "", i, i);
+        json += header;
+    }
+    json += "},\"route\":\"orders\",\"user\":{\"id\":42,\"role\":\"admin\"},\"items\":[1,2,3]}";
+    std::vector<char> buffer(json.begin(), json.end());
+    buffer.push_back('\0');
+    Json doc(buffer.data(), (int)buffer.size());
+    CacheEntry cache[8];
+    volatile long sink = 0;
+    auto request = [&]() {
+        char route[16];
+        long id = 0, items = 0;
+        for (int stage = 0; stage < 3; stage++)
+        {
+            doc.getValue("{'route'", route, sizeof(route));
+            doc.getValue("{'user'{'id'", id);
+            doc.getValue("{'items'[2", items);
+        }
+        sink = sink + id + items;
+    };
+
+    printf("Query cache, %d bytes, 9 queries\n", (int)json.size());
+    printf("  %-10s %8.0f MB/s\n", "no cache", throughput(json.size(), request));
+    doc.useCache(cache, 8);
+    printf("  %-10s %8.0f MB/s\n", "cache", throughput(json.size(), request));
+}
+
+//-------------------------------------------------
+// Field after a 1 MB object that is skipped
+//
+static void benchSkip()
+{
+    std::string json = "{\"attachments\":{";
+    char attachment[128];
+    int i;
+    for (i = 0; json.size() < (1 << 20); i++)
+    {
+        sprintf(attachment, "%s\"file%d\":{\"name\":\"file %d.bin\",\"size\":%d,\"tags\":[\"a\",\"b\"],\"meta\":{\"x\":1}}",
+                i ? "," : "", i, i, i * 512);
+        json += attachment;
+    }
+    json += "},\"id\":42}";
+    const char *pJson = json.c_str();
+    volatile long sink = 0;
+
+    printf("Skip, %d bytes before the field\n", (int)json.size());
+    printf("  %-10s %8.0f MB/s\n", "getValue", throughput(json.size(), [&]() {
+               long value = 0;
+               Json::getValue(pJson, "{'id'", NULL, &value);
+               sink = sink + value;
+           }));
+}
+
+//-------------------------------------------------
+// Validation, records with text and UTF-8
+//
+static void benchValidate()
+{
+    std::string json = "{\"records\":[";
+    char record[192];
+    int i;
+    for (i = 0; json.size() < (64 << 20); i++)
+    {
+        sprintf(record, "%s{\"id\":%d,\"name\":\"record %d\",\"text\":\"Grüße aus Göteborg, price 20 € \\\"net\\\"\",\"values\":[1.5,2.5,-3e2],\"ok\":true}",
+                i ? "," : "", i, i);
+        json += record;
+    }
+    json += "]}";
+    volatile int sink = 0;
+
+    printf("Validate, %d MB\n", (int)(json.size() >> 20));
+    printf("  %-10s %8.0f MB/s\n", "push", throughput(json.size(), [&]() {
+               JsonPush push;
+               sink = sink + push.feed(json.data(), json.size());
+           }));
+    printf("  %-10s %8.0f MB/s\n", "parse", throughput(json.size(), [&]() {
+               Json::Handler handler;
+               sink = sink + Json::parse(json.data(), json.size(), handler);
+           }));
+    printf("  %-10s %8.0f MB/s\n", "validate", throughput(json.size(), [&]() {
+               sink = sink + Json::validate(json.data(), json.size(), NULL);
+           }));
+}
+
+int main(int argc, char *argv[])
+{
+    benchStrings();
+    benchUnescape();
+    benchBatch();
+    benchBind();
+    benchNumbers();
+    benchIntegers();
+    benchNesting();
+    benchSkip();
+    benchLiteral();
+    benchCache();
+    benchWide();
+    benchMatches();
+    benchFile();
+    benchLines();
+    benchArray();
+    benchPush();
+    benchParse();
+    benchDom();
+    benchValidate();
+    return 0;
+}
@@ -0,0 +1,888 @@
+#include "../jsonRW.hpp"
+#include "../jsonScan.hpp"
+#include "../jsonPush.hpp"
+#include "../jsonDom.hpp"
+#include "../ascii_num.h"
+#include <ctype.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <random>
+#include <vector>
+
+#define CHECK_BLOCKS 100000  // random blocks per kernel level
+#define CHECK_TEXT 768       // longest random text for the scan checks
+#define CHECK_STRINGS 50000  // random strings per kernel level
+#define CHECK_NUMBERS 500000 // random numbers per number check
+#define CHECK_HALFWAY 50000  // random halfway cases (and as many subnormal ones)
+#define CHECK_MUTATIONS 200000 // mutated documents validated
+#define CHECK_ENTRIES 512    // index entries per indexed reader
+#define CHECK_REPORT 5       // failures printed per check
+
+using namespace jonaskgandersson;
+
+static std::mt19937_64 rng(20240611);
+static int failures = 0;
+
+// Count a failure, the first few of each check are printed
+static void fail(int &count, const char *check, const std::string &detail)
+{
+    if (count++ < CHECK_REPORT)
+        printf("  FAIL %s: %s\n", check, detail.c_str());
+    failures++;
+}
+
+// Printable copy of JSON text with its control chars escaped
+static std::string printable(const char *p, size_t length)
+{
+    std::string out;
+    char hex[8];
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned char c = (unsigned char)p[i];
+        if (c < 0x20 || c >= 0x7f)
+        {
+            snprintf(hex, sizeof(hex), "\\x%02x", c);
+            out += hex;
+        }
+        else
+            out += (char)c;
+    }
+    return out;
+}
+
+//-------------------------------------------------
+// Every kernel level classifies random blocks as the scalar kernel
+//
+static void checkKernels()
+{
+    static const char alphabet[] = "{}[]:,\"\\ \t\r\n0123456789-+.eEtrufalsn\x01\x1f\x7f\x80\xc3\xff";
+    alignas(JSCAN_BLOCK) char block[JSCAN_BLOCK];
+    for (int level = JSCAN_SSE42; level <= JSCAN_AVX512; level++)
+    {
+        if (jScanSelect(level) != level)
+            break;
+        const char *name = jScanKernelName();
+        int count = 0;
+        for (int n = 0; n < CHECK_BLOCKS; n++)
+        {
+            // JSON chars mostly, any byte (and '\0') now and then
+            for (int i = 0; i < JSCAN_BLOCK; i++)
+            {
+                unsigned r = (unsigned)rng();
+                block[i] = (r & 7) ? alphabet[(r >> 3) % (sizeof(alphabet) - 1)] : (char)(r >> 3);
+            }
+            ScanBlock expect, got;
+            jScanSelect(JSCAN_SCALAR);
+            jScanBlock(block, &expect);
+            jScanSelect(level);
+            jScanBlock(block, &got);
+            if (got.whitespace != expect.whitespace || got.quote != expect.quote ||
+                got.backslash != expect.backslash || got.structural != expect.structural ||
+                got.open != expect.open || got.close != expect.close || got.eol != expect.eol)
+                fail(count, name, printable(block, JSCAN_BLOCK));
+        }
+        printf("  %-10s %s on %d blocks\n", name, count ? "differs" : "agrees", CHECK_BLOCKS);
+    }
+    jScanSelect(JSCAN_AVX512);
+}
+
+// Random JSON-ish text with runs of '\\' (some longer than a block) and
+// quotes, brackets and ',' to end strings and objects on
+static size_t randomText(char *p, size_t maxLength)
+{
+    static const char alphabet[] = "\"\"{}[],: ab\n";
+    size_t length = 0;
+    while (length < maxLength)
+    {
+        unsigned r = (unsigned)rng();
+        size_t run = 1;
+        char c = alphabet[(r >> 8) % (sizeof(alphabet) - 1)];
+        if ((r & 3) == 0)
+        {
+            c = '\\';
+            run = (r & 4) ? 1 + (r >> 16) % 4 : 1 + (r >> 16) % 140;
+        }
+        else if ((r & 0xff) == 1)
+            c = '\0';
+        for (; (run > 0) && (length < maxLength); run--)
+            p[length++] = c;
+    }
+    return length;
+}
+
+// Byte loop finding the end of a string, '"' after an odd '\\' run is escaped
+static const char *byteLoopString(const char *sp, const char *pEnd)
+{
+    short skipch = 0;
+    for (; (sp != pEnd) && (*sp != '\0'); sp++)
+    {
+        if (skipch)
+            skipch = 0;
+        else if (*sp == '\\')
+            skipch = 1;
+        else if (*sp == '"')
+            break;
+    }
+    return sp;
+}
+
+// All ',' found by jScanSeparators() (called again while it fills pSeparators)
+// as offsets from sp, the last entry is the offset returned
+static std::string separators(const char *sp, const char *pEnd)
+{
+    const char *found[4];
+    const char *p = sp, *pStop;
+    size_t count;
+    std::string offsets;
+    char text[16];
+    while ((pStop = jScanSeparators(p, pEnd, found, 4, &count)) == NULL)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            snprintf(text, sizeof(text), "%d,", (int)(found[i] - sp));
+            offsets += text;
+        }
+        p = found[count - 1] + 1;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        snprintf(text, sizeof(text), "%d,", (int)(found[i] - sp));
+        offsets += text;
+    }
+    snprintf(text, sizeof(text), "%d", (int)(pStop - sp));
+    return offsets + text;
+}
+
+//-------------------------------------------------
+// Strings, objects and separators over random '\\' runs, each kernel level
+// against the byte loop (jScanString) or the scalar kernel, both
+// '\0'-terminated and bounded by pEnd
+//
+static void checkStrings()
+{
+    alignas(JSCAN_BLOCK) static char buffer[JSCAN_BLOCK + CHECK_TEXT + 2 * JSCAN_BLOCK];
+    for (int level = JSCAN_SCALAR; level <= JSCAN_AVX512; level++)
+    {
+        if (jScanSelect(level) != level)
+            break;
+        const char *name = jScanKernelName();
+        int count = 0;
+        for (int n = 0; n < CHECK_STRINGS; n++)
+        {
+            // text starts anywhere in a block, blocks read below it stay in buffer
+            char *sp = buffer + JSCAN_BLOCK + rng() % JSCAN_BLOCK;
+            size_t length = randomText(sp, rng() % (CHECK_TEXT - JSCAN_BLOCK));
+            sp[length] = '\0';
+            const char *pEnd = sp + rng() % (length + 1);
+            for (int bounded = 0; bounded < 2; bounded++)
+            {
+                const char *pStop = bounded ? pEnd : NULL;
+                std::string expectSkip, expectSeparators;
+                jScanSelect(JSCAN_SCALAR);
+                expectSkip = std::to_string(jScanSkip(sp, pStop) - sp);
+                expectSeparators = separators(sp, pStop);
+                jScanSelect(level);
+                if (jScanString(sp, pStop) != byteLoopString(sp, pStop))
+                    fail(count, "jScanString", printable(sp, length));
+                else if (std::to_string(jScanSkip(sp, pStop) - sp) != expectSkip)
+                    fail(count, "jScanSkip", printable(sp, length));
+                else if (separators(sp, pStop) != expectSeparators)
+                    fail(count, "jScanSeparators", printable(sp, length));
+            }
+        }
+        printf("  %-10s %s on %d texts\n", name, count ? "differs" : "agrees", CHECK_STRINGS);
+    }
+    jScanSelect(JSCAN_AVX512);
+}
+
+// Read text with jRead_atof() and jRead_atofn() (bounded at the '\0'),
+// the result must be the bits and end strtod() returns
+static void checkNumber(int &count, const char *check, const char *text)
+{
+    char *pExpect, expectText[32];
+    double expect = strtod(text, &pExpect), got, gotBounded;
+    const char *pGot = jRead_atof(text, &got);
+    const char *pGotBounded = jRead_atofn(text, text + strlen(text), &gotBounded);
+    if ((pGot != pExpect) || (pGotBounded != pExpect) ||
+        memcmp(&got, &expect, sizeof(double)) || memcmp(&gotBounded, &expect, sizeof(double)))
+    {
+        snprintf(expectText, sizeof(expectText), "%.17g", expect);
+        fail(count, check, std::string(text) + " is not " + expectText);
+    }
+}
+
+// Random finite double, any exponent (subnormals too) and sign
+static double randomDouble()
+{
+    double value;
+    do
+    {
+        unsigned long long bits = rng();
+        memcpy(&value, &bits, sizeof(value));
+    } while (!isfinite(value));
+    return value;
+}
+
+//-------------------------------------------------
+// jRead_atof() against strtod(), bit exact: edge cases, random doubles
+// printed round-trip and shorter, random digit strings, the exact
+// halfway points between doubles (ties to even) and subnormals
+//
+static void checkNumbers()
+{
+    static const char *edges[] = {
+        "0", "-0", "0.0", "-0.0e10", "1", "-1", "0.1", "1e23", "8.98846567431158e307",
+        "9007199254740992", "9007199254740993", "9007199254740994", "9007199254740995",
+        "1.7976931348623157e308", "1.7976931348623158e308", "1.7976931348623159e308", "1e309",
+        "2.2250738585072011e-308", "2.2250738585072012e-308", "2.2250738585072014e-308",
+        "4.9406564584124654e-324", "2.4703282292062327e-324", "2.4703282292062328e-324",
+        "1e-400", "123456789012345678901234567890", "0.000000000000000000000000000001e30",
+    };
+    char text[1024];
+    int count = 0;
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++)
+        checkNumber(count, "edge", edges[i]);
+    printf("  %-10s %s on %d numbers\n", "edges", count ? "differs" : "agrees", (int)(sizeof(edges) / sizeof(edges[0])));
+
+    count = 0;
+    for (int n = 0; n < CHECK_NUMBERS; n++)
+    {
+        double value = randomDouble();
+        snprintf(text, sizeof(text), "%.17g", value);
+        checkNumber(count, "round-trip", text);
+        snprintf(text, sizeof(text), "%.*g", 1 + (int)(rng() % 16), value);
+        checkNumber(count, "shorter", text);
+    }
+    printf("  %-10s %s on %d numbers\n", "doubles", count ? "differs" : "agrees", 2 * CHECK_NUMBERS);
+
+    count = 0;
+    for (int n = 0; n < CHECK_NUMBERS; n++)
+    {
+        // 1-40 digits, a '.' among them or not, exponent or not
+        int digits = 1 + (int)(rng() % 40), dot = (int)(rng() % (digits + 1)), length = 0;
+        if (rng() & 1)
+            text[length++] = '-';
+        for (int i = 0; i < digits; i++)
+        {
+            if ((i == dot) && (i > 0))
+                text[length++] = '.';
+            text[length++] = (char)('0' + ((i == 0) ? 1 + rng() % 9 : rng() % 10));
+        }
+        if (rng() & 1)
+            length += snprintf(text + length, sizeof(text) - length, "e%d", (int)(rng() % 700) - 350);
+        text[length] = '\0';
+        checkNumber(count, "digits", text);
+    }
+    printf("  %-10s %s on %d numbers\n", "digits", count ? "differs" : "agrees", CHECK_NUMBERS);
+
+#if LDBL_MANT_DIG >= 64
+    // the midpoint of two doubles (54 bits) is exact in long double
+    // and "%.800Le" prints it exactly, rounded text lands on either side
+    count = 0;
+    for (int n = 0; n < 2 * CHECK_HALFWAY; n++)
+    {
+        double value = fabs(randomDouble());
+        if (n >= CHECK_HALFWAY)
+            value = ldexp((double)(rng() % (1ULL << 52)), -1074); // subnormal
+        double next = nextafter(value, HUGE_VAL);
+        if (!isfinite(next))
+            continue;
+        long double halfway = ((long double)value + (long double)next) / 2;
+        snprintf(text, sizeof(text), "%.800Le", halfway);
+        checkNumber(count, "halfway", text);
+        snprintf(text, sizeof(text), "%.*Le", 17 + (int)(rng() % 24), halfway);
+        checkNumber(count, "near halfway", text);
+    }
+    printf("  %-10s %s on %d numbers\n", "halfway", count ? "differs" : "agrees", 4 * CHECK_HALFWAY);
+#else
+    printf("  %-10s skipped, long double can not hold a halfway point\n", "halfway");
+#endif
+}
+
+// A query literal compiled by the compiler must equal Query(text)
+#define CHECK_LITERAL(text) checkLiteral(count, JSON_QUERY(text), text)
+
+static void checkLiteral(int &count, const Json::Query &literal, const char *text)
+{
+    Json::Query query(text);
+    if (!(literal == query) || (query.getError() != 0))
+        fail(count, "literal", text);
+}
+
+//-------------------------------------------------
+// Query literals against Query(pQuery): every step type, parameters,
+// whitespace, escaped quotes in keys, the most steps and key bytes
+//
+static void checkLiterals()
+{
+    int count = 0, literals = 0;
+    CHECK_LITERAL("");
+    CHECK_LITERAL("{'a'");
+    CHECK_LITERAL("{'header'{'ts'");
+    CHECK_LITERAL("  { 'items' [ 3 { 'price'  ");
+    CHECK_LITERAL("{'it\\'s'{'a\\\\b'");
+    CHECK_LITERAL("{'a\"b'[0");
+    CHECK_LITERAL("{''");
+    CHECK_LITERAL("{'' {'x'");
+    CHECK_LITERAL("[*{'id'");
+    CHECK_LITERAL("{*[*{*");
+    CHECK_LITERAL("{2");
+    CHECK_LITERAL("[12[0[");
+    CHECK_LITERAL("{*}[*]");
+    CHECK_LITERAL("{'items'[*]{'price'");
+    CHECK_LITERAL("[2:5]");
+    CHECK_LITERAL("[ 2 : ]");
+    CHECK_LITERAL("[:7]");
+    CHECK_LITERAL("[:]");
+    CHECK_LITERAL("{'a'{ * }[ * ][1:2]");
+    CHECK_LITERAL("[0[1[2[3[4[5[6[7[8[9[10[11[12[13[14[15");
+    CHECK_LITERAL("{'0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef'{'0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef'");
+    literals = count;
+    count = 0;
+    static const char *texts[] = {"{'a'", "[*{'id'", "{'items'[*]{'price'"}; // literal() not constexpr
+    for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++)
+        if (!(Json::Query::literal(texts[i]) == Json::Query(texts[i])))
+            fail(count, "literal at run time", texts[i]);
+    printf("  %-10s %s\n", "literals", (literals + count) ? "differ" : "agree");
+}
+
+// Documents for the push and validate checks, valid and not
+static std::vector<std::string> corpus()
+{
+    static const char *texts[] = {
+        "{\"seq\":1,\"text\":\"a}\",\"list\":[1,2.5,-3e2,true,false,null,{},[]]}",
+        "[\"\\u00e9\\uD83D\\uDE00\\\"\\\\\\/\\b\\f\\n\\r\\t\", \"\\u0041B\"]",
+        "  { \"a\" : [ true , false , null ] , \"b\" : { \"c\" : \"\" } }  ",
+        "\"top-level string\"", "true", "false", "null", "0", "-0", "-12.5e+3", "123456789", "1E-7",
+        "[0.5,-0,1e5,2E+3,0.25e-2]", "{\"\\u00\":1}", "{\"a\":\"\\x\"}", "[1,]", "[1 2]", "{\"a\" 1}",
+        "{\"a\":1,}", "{1:2}", "[tru]", "[nul", "[\"abc", "\"a\tb\"", "-", "01", "1.", "1e", "1e+", "[.5]",
+        "{\"a\":1}}", "]", "[}", "{\"a\":[1,{\"b\":null}]]", "[fals]", "[truex]", "{\"a\":tRue}",
+    };
+    std::vector<std::string> docs(texts, texts + sizeof(texts) / sizeof(texts[0]));
+    // deepest nesting read, then one level more
+    for (int extra = 0; extra < 2; extra++)
+        docs.push_back(std::string(JREAD_STACK_DEPTH + extra, '[') + std::string(JREAD_STACK_DEPTH + extra, ']'));
+    docs.push_back(std::string(JREAD_STACK_DEPTH - 1, '[') + "{\"k\":1}" + std::string(JREAD_STACK_DEPTH - 1, ']'));
+    return docs;
+}
+
+// Push result: status, end of the value (or offset of the error) and error
+struct PushResult
+{
+    int status;
+    size_t end;
+    int error;
+
+    bool operator!=(const PushResult &other) const
+    {
+        return (status != other.status) || (end != other.end) || (error != other.error);
+    }
+};
+
+// Feed text in two fragments split at split, then finish() if the value is not complete
+static PushResult pushSplit(const std::string &text, size_t split)
+{
+    JsonPush push;
+    PushResult result;
+    result.status = push.feed(text.data(), split);
+    result.end = push.getConsumed();
+    if (result.status == JPUSH_MORE)
+    {
+        result.status = push.feed(text.data() + split, text.size() - split);
+        result.end = split + push.getConsumed();
+    }
+    if (result.status == JPUSH_MORE)
+        result.status = push.finish();
+    if (result.status == JPUSH_ERROR)
+        result.end = push.getOffset();
+    result.error = push.getError();
+    return result;
+}
+
+//-------------------------------------------------
+// JsonPush fed each document split at every byte against one feed of it
+// (status, end or error offset, error), documents it completes against
+// Json::validate()
+//
+static void checkPush()
+{
+    std::vector<std::string> docs = corpus();
+    int count = 0, splits = 0;
+    for (size_t d = 0; d < docs.size(); d++)
+    {
+        const std::string &text = docs[d];
+        JsonPush push;
+        PushResult whole;
+        whole.status = push.feed(text.data(), text.size());
+        whole.end = push.getConsumed();
+        if (whole.status == JPUSH_MORE)
+            whole.status = push.finish();
+        if (whole.status == JPUSH_ERROR)
+            whole.end = push.getOffset();
+        whole.error = push.getError();
+        for (size_t split = 0; split <= text.size(); split++, splits++)
+            if (pushSplit(text, split) != whole)
+                fail(count, "split", text.substr(0, 80) + " at " + std::to_string(split));
+
+        // valid if push completes it with only whitespace after, error codes
+        // and offsets differ: push reports where it stopped, validate() the token
+        size_t offset = 0;
+        int valid = Json::validate(text.data(), text.size(), &offset);
+        bool complete = (whole.status == JPUSH_COMPLETE) &&
+                        (text.find_first_not_of(" \t\r\n", whole.end) == std::string::npos);
+        if ((valid == 0) != complete)
+            fail(count, "validate", text.substr(0, 80) + " validate " + std::to_string(valid));
+    }
+    printf("  %-10s %s on %d documents, %d splits\n", "push", count ? "differs" : "agrees", (int)docs.size(), splits);
+}
+
+// Text with the whitespace outside strings taken out
+static std::string compact(const std::string &text)
+{
+    std::string out;
+    bool inString = false, escaped = false;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        char c = text[i];
+        if (inString)
+        {
+            escaped = !escaped && (c == '\\');
+            inString = escaped || (c != '"');
+        }
+        else if ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'))
+            continue;
+        else
+            inString = (c == '"');
+        out += c;
+    }
+    return out;
+}
+
+// Tree of text printed, "" if build() fails
+static std::string buildPrint(const std::string &text, std::vector<char> &arena)
+{
+    JsonDom dom(arena.data(), arena.size());
+    if (dom.build(text.data(), text.size()) != 0)
+        return "";
+    std::string out(JsonDom::print(dom.getRoot(), NULL, 0) + 1, '\0');
+    out.resize(JsonDom::print(dom.getRoot(), &out[0], out.size()));
+    return out;
+}
+
+//-------------------------------------------------
+// JsonDom: build() then print() gives the text compacted (escapes as
+// print() writes them) or the text of decoded escapes, every arena too
+// small for a document fails with 19 and no root, setNumber(double)
+// reads back bit exact
+//
+static void checkDom()
+{
+    static const char *escapes[][2] = {
+        {"[\"a\\u00e9\\/\\u0041\"]", "[\"a\xc3\xa9/A\"]"},
+        {"{\"k\\ud83d\\ude00\":\"\\b\\f\\n\\r\\t\\u0001\\u001F\"}", "{\"k\xf0\x9f\x98\x80\":\"\\b\\f\\n\\r\\t\\u0001\\u001f\"}"},
+        {"[\"\\ud800\", \"\\\"\\\\\"]", "[\"\xef\xbf\xbd\",\"\\\"\\\\\"]"},
+    };
+    std::vector<std::string> docs = corpus();
+    std::vector<char> arena(1 << 20);
+    int count = 0, documents = 0, arenas = 0;
+    for (size_t d = 0; d < docs.size(); d++)
+    {
+        const std::string &text = docs[d];
+        std::string printed = buildPrint(text, arena);
+        size_t offset;
+        if (Json::validate(text.data(), text.size(), &offset) != 0)
+            continue;
+        documents++;
+        // "\\uXXXX" and "\\/" are printed decoded, the printed text must then print the same
+        bool decoded = (text.find("\\u") != std::string::npos) || (text.find("\\/") != std::string::npos);
+        if (printed != (decoded ? buildPrint(printed, arena) : compact(text)))
+            fail(count, "print", text.substr(0, 80) + " printed " + printed.substr(0, 80));
+    }
+    for (size_t e = 0; e < sizeof(escapes) / sizeof(escapes[0]); e++, documents++)
+        if (buildPrint(escapes[e][0], arena) != escapes[e][1])
+            fail(count, "escapes", printable(escapes[e][0], strlen(escapes[e][0])));
+
+    // smallest arena each document builds in, all smaller ones fail
+    for (size_t d = 0; d < docs.size(); d++)
+    {
+        const std::string &text = docs[d];
+        size_t size = 0;
+        if (buildPrint(text, arena).empty())
+            continue;
+        while (true)
+        {
+            std::vector<char> small(size);
+            JsonDom dom(small.data(), small.size());
+            int error = dom.build(text.data(), text.size());
+            if (error == 0)
+                break;
+            arenas++;
+            if ((error != 19) || (dom.getRoot() != NULL))
+            {
+                fail(count, "arena", text.substr(0, 80) + " in " + std::to_string(size) + " bytes: " + std::to_string(error));
+                break;
+            }
+            size++;
+        }
+    }
+
+    std::vector<char> small(256);
+    JsonDom dom(small.data(), small.size());
+    JsonDom::Node *pNode = NULL;
+    for (int n = 0; n < CHECK_NUMBERS; n++)
+    {
+        double value = randomDouble(), got;
+        dom.build("[0]"); // arena reset
+        pNode = dom.find("[0", NULL);
+        if (!dom.setNumber(pNode, value) || (jRead_atofn(pNode->pText, pNode->pText + pNode->length, &got) != pNode->pText + pNode->length) ||
+            memcmp(&got, &value, sizeof(double)))
+            fail(count, "setNumber", std::string(pNode->pText, pNode->length));
+    }
+    if (dom.setNumber(pNode, NAN) || dom.setNumber(pNode, HUGE_VAL) || dom.setNumber(pNode, -HUGE_VAL))
+        fail(count, "setNumber", "NaN or infinity set");
+    printf("  %-10s %s on %d documents, %d small arenas, %d numbers\n", "dom", count ? "differs" : "agrees",
+           documents, arenas, CHECK_NUMBERS);
+}
+
+// Document with wide and narrow arrays and objects, nested in each other
+static std::string indexDocument()
+{
+    std::string text = "{\"wide\":[";
+    for (int i = 0; i < 3 * JREAD_WIDE_OBJECT; i++)
+    {
+        text += i ? ", " : "";
+        switch (i % 5)
+        {
+        case 0: text += std::to_string(i); break;
+        case 1: text += "\"s" + std::to_string(i) + "\""; break;
+        case 2: text += "[" + std::to_string(i) + ", [true], {\"k\": \"]\"}]"; break;
+        case 3: text += "{\"id\": " + std::to_string(i) + ", \"v\": [null]}"; break;
+        default: text += "null"; break;
+        }
+    }
+    text += "], \"narrow\": [1, {\"id\": 2}, [3]], \"keys\": {";
+    for (int i = 0; i < 2 * JREAD_WIDE_OBJECT; i++)
+        text += (i ? ", \"k" : "\"k") + std::to_string(i) + "\": " + ((i % 3) ? std::to_string(i) : "[" + std::to_string(i) + "]");
+    text += "}, \"last\": [\"x\"]}";
+    return text;
+}
+
+//-------------------------------------------------
+// Indexed reads: every query gives the same element with an index, with
+// an index and key/element tables and with tables that do not fit, as
+// without an index
+//
+static void checkIndex()
+{
+    std::string text = indexDocument();
+    std::vector<std::string> queries;
+    for (int i = 0; i <= 3 * JREAD_WIDE_OBJECT + 1; i++)
+    {
+        queries.push_back("{'wide'[" + std::to_string(i));
+        queries.push_back("{'wide'[" + std::to_string(i) + "{'id'");
+        queries.push_back("{'wide'[" + std::to_string(i) + "[2{'k'");
+    }
+    for (int i = 0; i <= 2 * JREAD_WIDE_OBJECT; i++)
+    {
+        queries.push_back("{'keys'{'k" + std::to_string(i) + "'");
+        queries.push_back("{'keys'{'k" + std::to_string(i) + "'[0");
+        queries.push_back("{'keys'{" + std::to_string(i));
+    }
+    for (int i = 0; i <= 3; i++)
+        queries.push_back("{'narrow'[" + std::to_string(i));
+    queries.push_back("{'last'[0");
+    queries.push_back("{'none'");
+
+    std::vector<char> plain(text.begin(), text.end()), indexed(plain), tables(plain), full(plain);
+    Json jPlain(plain.data(), (int)plain.size()), jIndexed(indexed.data(), (int)indexed.size());
+    Json jTables(tables.data(), (int)tables.size()), jFull(full.data(), (int)full.size());
+    std::vector<IndexEntry> entries(3 * CHECK_ENTRIES);
+    std::vector<KeySlot> slots(16 * JREAD_WIDE_OBJECT), fewSlots(3 * JREAD_WIDE_OBJECT);
+    Json *readers[] = {&jIndexed, &jTables, &jFull};
+    const char *buffers[] = {indexed.data(), tables.data(), full.data()};
+    int count = 0;
+    for (size_t r = 0; r < 3; r++)
+        if (readers[r]->buildIndex(entries.data() + r * CHECK_ENTRIES, CHECK_ENTRIES) < 0)
+            fail(count, "index", "not built");
+    jTables.useKeyTables(slots.data(), (int)slots.size());
+    jFull.useKeyTables(fewSlots.data(), (int)fewSlots.size()); // the array table fits, the object table not
+
+    for (int pass = 0; pass < 2; pass++) // tables are built on the first pass
+        for (size_t q = 0; q < queries.size(); q++)
+        {
+            struct ReadElement expect, got;
+            const char *pExpect = jPlain.getElement(queries[q].c_str(), expect);
+            for (size_t r = 0; r < 3; r++)
+            {
+                Json::Query query(queries[q].c_str());
+                const char *pGot = (pass == 0) ? readers[r]->getElement(queries[q].c_str(), got) : readers[r]->getElement(query, NULL, got);
+                if ((pGot - buffers[r] != pExpect - plain.data()) || (got.error != expect.error) || (got.dataType != expect.dataType) ||
+                    (got.elements != expect.elements) || (got.bytelen != expect.bytelen) ||
+                    ((const char *)got.pValue - buffers[r] != (const char *)expect.pValue - plain.data()))
+                    fail(count, "index", queries[q] + " reader " + std::to_string(r) + ": error " + std::to_string(got.error) + " at " +
+                                             std::to_string(pGot - buffers[r]) + ", without index " + std::to_string(expect.error) +
+                                             " at " + std::to_string(pExpect - plain.data()));
+            }
+        }
+    printf("  %-10s %s on %d queries\n", "index", count ? "differs" : "agrees", (int)queries.size());
+}
+
+// Reference string check, byte by byte: returns the closing '"', the
+// char in error (the first byte of bad UTF-8, the '\\' of a bad escape)
+// or pEnd
+static const char *referenceString(const char *sp, const char *pEnd)
+{
+    while (sp != pEnd)
+    {
+        unsigned char c = (unsigned char)*sp;
+        if (c == '"')
+            return sp;
+        if (c == '\\')
+        {
+            if ((pEnd - sp < 2) || !strchr("\"\\/bfnrtu", sp[1]) || (sp[1] == '\0'))
+                return sp;
+            if (sp[1] == 'u')
+            {
+                if (pEnd - sp < 6)
+                    return sp;
+                for (int i = 2; i < 6; i++)
+                    if (!isxdigit((unsigned char)sp[i]))
+                        return sp;
+                sp += 4;
+            }
+            sp += 2;
+        }
+        else if (c < 0x20)
+            return sp;
+        else if (c < 0x80)
+            sp++;
+        else
+        {
+            // decode the code point, then rule out overlong forms, surrogates and > U+10FFFF
+            int n = ((c & 0xe0) == 0xc0) ? 2 : ((c & 0xf0) == 0xe0) ? 3 : ((c & 0xf8) == 0xf0) ? 4 : 0;
+            unsigned long code = c & (0x7f >> n);
+            if ((n == 0) || (pEnd - sp < n))
+                return sp;
+            for (int i = 1; i < n; i++)
+            {
+                if (((unsigned char)sp[i] & 0xc0) != 0x80)
+                    return sp;
+                code = (code << 6) | ((unsigned char)sp[i] & 0x3f);
+            }
+            if ((code < ((n == 2) ? 0x80ul : (n == 3) ? 0x800ul : 0x10000ul)) || ((code >= 0xd800) && (code <= 0xdfff)) || (code > 0x10ffff))
+                return sp;
+            sp += n;
+        }
+    }
+    return pEnd;
+}
+
+static const char *referenceSpace(const char *sp, const char *pEnd)
+{
+    while ((sp != pEnd) && strchr(" \t\r\n", *sp) && (*sp != '\0'))
+        sp++;
+    return sp;
+}
+
+// Reference validator, recursive descent: error code as Json::validate(),
+// sp left at the char in error
+static int referenceValue(const char *&sp, const char *pEnd, int depth)
+{
+    sp = referenceSpace(sp, pEnd);
+    if (sp == pEnd)
+        return 8;
+    if ((*sp == '{') || (*sp == '['))
+    {
+        bool isObject = (*sp == '{');
+        if (depth >= JREAD_STACK_DEPTH)
+            return 16;
+        sp = referenceSpace(sp + 1, pEnd);
+        if ((sp != pEnd) && (*sp == (isObject ? '}' : ']')))
+        {
+            sp++;
+            return 0;
+        }
+        while (true)
+        {
+            if (isObject)
+            {
+                sp = referenceSpace(sp, pEnd);
+                if ((sp == pEnd) || (*sp != '"'))
+                    return 3;
+                const char *pClose = referenceString(sp + 1, pEnd);
+                if ((pClose == pEnd) || (*pClose != '"'))
+                {
+                    sp = pClose;
+                    return ((pClose != pEnd) && ((unsigned char)*pClose >= 0x80)) ? 18 : 3;
+                }
+                sp = referenceSpace(pClose + 1, pEnd);
+                if ((sp == pEnd) || (*sp != ':'))
+                    return 4;
+                sp++;
+            }
+            int error = referenceValue(sp, pEnd, depth + 1);
+            if (error)
+                return error;
+            sp = referenceSpace(sp, pEnd);
+            if ((sp != pEnd) && (*sp == ','))
+                sp++;
+            else if ((sp != pEnd) && (*sp == (isObject ? '}' : ']')))
+            {
+                sp++;
+                return 0;
+            }
+            else
+                return isObject ? 6 : 9;
+        }
+    }
+    if (*sp == '"')
+    {
+        const char *pClose = referenceString(sp + 1, pEnd);
+        sp = pClose;
+        if ((pClose != pEnd) && (*pClose == '"'))
+        {
+            sp++;
+            return 0;
+        }
+        return ((pClose != pEnd) && ((unsigned char)*pClose >= 0x80)) ? 18 : 2;
+    }
+    if ((*sp == 't') || (*sp == 'f') || (*sp == 'n'))
+    {
+        const char *pLiteral = (*sp == 't') ? "true" : (*sp == 'f') ? "false" : "null";
+        size_t length = strlen(pLiteral);
+        if (((size_t)(pEnd - sp) < length) || strncmp(sp, pLiteral, length))
+            return 2;
+        sp += length;
+        return 0;
+    }
+    if ((*sp != '-') && !isdigit((unsigned char)*sp))
+        return 8;
+    // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    sp += (*sp == '-');
+    if ((sp == pEnd) || !isdigit((unsigned char)*sp))
+        return 2;
+    if (*sp++ != '0')
+        while ((sp != pEnd) && isdigit((unsigned char)*sp))
+            sp++;
+    if ((sp != pEnd) && (*sp == '.'))
+    {
+        if ((++sp == pEnd) || !isdigit((unsigned char)*sp))
+            return 2;
+        while ((sp != pEnd) && isdigit((unsigned char)*sp))
+            sp++;
+    }
+    if ((sp != pEnd) && ((*sp == 'e') || (*sp == 'E')))
+    {
+        if ((++sp != pEnd) && ((*sp == '+') || (*sp == '-')))
+            sp++;
+        if ((sp == pEnd) || !isdigit((unsigned char)*sp))
+            return 2;
+        while ((sp != pEnd) && isdigit((unsigned char)*sp))
+            sp++;
+    }
+    return 0;
+}
+
+// Validate text with Json::validate() and the reference, same error and offset
+static void checkValidate(int &count, const std::string &text)
+{
+    const char *sp = text.data(), *pEnd = text.data() + text.size();
+    int expect = referenceValue(sp, pEnd, 0);
+    if (expect == 0)
+    {
+        sp = referenceSpace(sp, pEnd);
+        expect = (sp != pEnd) ? 8 : 0;
+    }
+    size_t offset = (size_t)-1;
+    int error = Json::validate(text.data(), text.size(), &offset);
+    if ((error != expect) || (offset != (size_t)(sp - text.data())))
+        fail(count, "validate", printable(text.data(), (text.size() < 80) ? text.size() : 80) + ": " + std::to_string(error) + " at " +
+                                    std::to_string(offset) + ", reference " + std::to_string(expect) + " at " + std::to_string(sp - text.data()));
+}
+
+//-------------------------------------------------
+// Json::validate() against the reference validator: the corpus, every
+// prefix of it, UTF-8 good and bad, and random mutations of both
+//
+static void checkValidation()
+{
+    static const char *utf8[] = {
+        "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\xf4\x8f\xbf\xbf", "\xef\xbf\xbd",  // good
+        "\xc0\x80", "\xc1\xbf", "\xe0\x9f\xbf", "\xf0\x8f\xbf\xbf",                            // overlong
+        "\xed\xa0\x80", "\xed\xbf\xbf", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80", "\xff",        // surrogate, > U+10FFFF
+        "\x80", "\xbf", "\xc3", "\xe2\x82", "\xf0\x9f\x98", "\xc3\x28", "\xe2\x28\xa1", "\xf8\x88\x80\x80\x80", // broken
+    };
+    static const char *pieces[] = {
+        "{", "}", "[", "]", ",", ":", " ", "\n", "\t", "\"k\"", "\"a b\"", "\"\\u00e9\"", "\"\\x\"", "\"\\u12\"", "\"", "\\",
+        "1", "-0.5e+3", "01", "1.", "-", "1e", "true", "fals", "null", "nul", "x", "\x01", "\"\x1f\"", "\"\xc3\xa9\"", "\"\xed\xa0\x80\"",
+    };
+    std::vector<std::string> docs = corpus();
+    int count = 0, inputs = 0;
+    for (size_t u = 0; u < sizeof(utf8) / sizeof(utf8[0]); u++)
+    {
+        docs.push_back(std::string("[\"") + utf8[u] + "\"]");
+        docs.push_back(std::string("{\"") + utf8[u] + "\":\"x" + utf8[u] + "y\"}");
+    }
+    for (size_t d = 0; d < docs.size(); d++)
+        for (size_t length = 0; length <= docs[d].size(); length++, inputs++)
+            checkValidate(count, docs[d].substr(0, length));
+    for (int n = 0; n < CHECK_MUTATIONS; n++, inputs++)
+    {
+        std::string text;
+        if (n & 1)
+        {
+            for (int i = (int)(rng() % 12); i > 0; i--)
+                text += pieces[rng() % (sizeof(pieces) / sizeof(pieces[0]))];
+        }
+        else
+        {
+            // a document with a byte replaced, inserted or taken out
+            text = docs[rng() % docs.size()];
+            if (text.size() > 4096)
+                continue;
+            size_t at = rng() % (text.size() + 1);
+            char c = (rng() & 1) ? pieces[rng() % (sizeof(pieces) / sizeof(pieces[0]))][0] : (char)rng();
+            switch (rng() % 3)
+            {
+            case 0:
+                if (at < text.size())
+                    text[at] = c;
+                break;
+            case 1:
+                text.insert(at, 1, c);
+                break;
+            default:
+                if (at < text.size())
+                    text.erase(at, 1);
+            }
+        }
+        checkValidate(count, text);
+    }
+    printf("  %-10s %s on %d inputs\n", "validate", count ? "differs" : "agrees", inputs);
+}
+
+int main()
+{
+    printf("Kernel agreement with scalar\n");
+    checkKernels();
+    printf("String and object ends over backslash runs\n");
+    checkStrings();
+    printf("Push tokenizer split at every byte\n");
+    checkPush();
+    printf("Document tree\n");
+    checkDom();
+    printf("Indexed reads against unindexed\n");
+    checkIndex();
+    printf("Json::validate() against a reference validator\n");
+    checkValidation();
+    printf("Query literals against Query(pQuery)\n");
+    checkLiterals();
+    printf("jRead_atof() against strtod()\n");
+    checkNumbers();
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
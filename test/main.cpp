@@ -1,9 +1,86 @@
 #include "../jsonRW.hpp"
+#include "../jsonFile.hpp"
+#include "../jsonLines.hpp"
+#include "../jsonArray.hpp"
+#include "../jsonPush.hpp"
+#include "../jsonDom.hpp"
 #include <stdio.h>
+#include <string.h>
 
 #define BUFFER_LEN 1000
 
 using namespace jonaskgandersson;
+//-------------------------------------------------
+//// Print a JSON Lines record
+void printRecord(const JsonLines::Record &record, void *pUser)
+{
+    int id = 0;
+    char name[32] = "";
+    Json::getValue(record.pResults[0], id);
+    Json::getValue(record.pResults[1], name, sizeof(name));
+    printf("%s %d at %d: %s\r\n", (const char *)pUser, id, (int)record.offset, name);
+}
+
+//-------------------------------------------------
+//// Print id and name of an array element
+void printElement(const JsonArray::Record &record, void *pUser)
+{
+    int id = 0;
+    char name[32] = "";
+    Json::getValue(record.pResults[0], id);
+    Json::getValue(record.pResults[1], name, sizeof(name));
+    printf("%s %d: id %d, %s\r\n", (const char *)pUser, (int)record.index, id, name);
+}
+
+//-------------------------------------------------
+//// Print the sku of an item matched by a wildcard query
+bool printMatch(const Json::Match &match, void *pUser)
+{
+    char sku[16] = "";
+    Json::getValue(match.value, sku, sizeof(sku));
+    printf("%s %u: %s\r\n", (const char *)pUser, match.pIndexes[0], sku);
+    return true;
+}
+
+//-------------------------------------------------
+//// Struct read and written with a binding
+struct Order
+{
+    int id;
+    double price;
+    bool paid;
+    char item[16];
+};
+
+static const BindField orderFields[] = {
+    JSON_BIND(Order, id), JSON_BIND(Order, price), JSON_BIND(Order, paid), JSON_BIND_KEY(Order, item, "name")};
+
+//-------------------------------------------------
+//// Count the values of a document
+class Counter : public Json::Handler
+{
+public:
+    Counter() : keys(0), numbers(0), sum(0) {}
+    bool key(const char *pKey, size_t keyLen)
+    {
+        (void)pKey;
+        (void)keyLen;
+        keys++;
+        return true;
+    }
+    bool number(const struct ReadElement &element)
+    {
+        double value;
+        if (Json::getValue(element, value) == ReadError::JS_OK)
+            sum += value;
+        numbers++;
+        return true;
+    }
+    int keys;
+    int numbers;
+    double sum;
+};
+
 //-------------------------------------------------
 //// Do a query and print the results
 void testQuery(Json &oJson, char *pJson, const char *query)
@@ -14,8 +91,8 @@ void testQuery(Json &oJson, char *pJson, const char *query)
     //printf( "return: %d= %s\n", jElement.error, oJson.jReadErrorToString(jElement.error) );
     //printf( " dataType = %s\n", oJson.jReadTypeToString(jElement.dataType) );
     printf(" elements = %d\n", jElement.elements);
-    printf(" bytelen  = %d\n", jElement.bytelen);
-    printf(" value    = %*.*s\n\n", jElement.bytelen, jElement.bytelen, (const char *)jElement.pValue);
+    printf(" bytelen  = %d\n", (int)jElement.bytelen);
+    printf(" value    = %*.*s\n\n", (int)jElement.bytelen, (int)jElement.bytelen, (const char *)jElement.pValue);
 }
 
 int main(int argc, char *argv[])
@@ -72,16 +149,16 @@ int main(int argc, char *argv[])
     // Get an element from an raw json string
     ReadElement rElement;
     Json::getElement(buffer, "{'Bool'", &rElement);
-    printf(" Bool    = %*.*s\n\n", rElement.bytelen, rElement.bytelen, (const char *)rElement.pValue);
+    printf(" Bool    = %*.*s\n\n", (int)rElement.bytelen, (int)rElement.bytelen, (const char *)rElement.pValue);
 
     // Get an element from json object
     jw.getElement("{'anArray'[4[1", rElement);
-    printf(" value    = %*.*s\n\n", rElement.bytelen, rElement.bytelen, (const char *)rElement.pValue);
+    printf(" value    = %*.*s\n\n", (int)rElement.bytelen, (int)rElement.bytelen, (const char *)rElement.pValue);
 
     // Using quaryParams as index
     int index[] = {4};
     jw.getElement("{'anArray'[*[0", index, rElement);
-    printf(" value    = %*.*s\n\n", rElement.bytelen, rElement.bytelen, (const char *)rElement.pValue);
+    printf(" value    = %*.*s\n\n", (int)rElement.bytelen, (int)rElement.bytelen, (const char *)rElement.pValue);
 
     if (jw.getValue("{'anArray'[4[1", json_pi) == ReadError::JS_OK)
     {
@@ -187,5 +264,193 @@ int main(int argc, char *argv[])
         printf("Json bool : Unkown\r\n");
     }
 
+    // Compile a query once, use it with different parameters
+    Json::Query arrayQuery("{'anArray'[*");
+    for (int i = 0; i < 3; i++)
+    {
+        index[0] = i;
+        if (jw.getValue(arrayQuery, index, json_int) == ReadError::JS_OK)
+            printf("Json anArray[%d]: %d\r\n", i, json_int);
+    }
+
+    // Read several fields in one pass
+    Json::Batch batch;
+    double batch_pi = 0;
+    char batch_string[32];
+    batch.add("{'int'", json_int);
+    batch.add("{'anArray'[4[1", batch_pi);
+    batch.add("{'anArray'[4[0", batch_string, sizeof(batch_string));
+    int found = jw.getValues(batch);
+    printf("Batch found: %d, int: %d, pi: %f, string: %s\r\n", found, json_int, batch_pi, batch_string);
+
+    // Build a structural index, following queries skip objects/arrays by lookup
+    struct IndexEntry jIndex[16];
+    int indexed = jw.buildIndex(jIndex, 16);
+    struct KeySlot keySlots[256]; // hash tables of objects with JREAD_WIDE_OBJECT or more keys
+    jw.useKeyTables(keySlots, 256);
+    printf("Index entries: %d\r\n", indexed);
+    testQuery(jw, buffer, "{'anArray'");
+    testQuery(jw, buffer, "{'ObjectObject'{'ObjectArray'");
+
+    // Iterate over an array and an object, each element is read once
+    struct ReadElement container;
+    jw.getElement("{'anArray'", container);
+    for (Json::Cursor &cursor : jw.iterate(container))
+        printf("anArray[%d]: %s\r\n", cursor.index(), jw.jReadTypeToString(cursor.value().dataType));
+    jw.getElement("{'ObjectObject'", container);
+    Json::Cursor objectCursor = jw.iterate(container);
+    while (objectCursor.next())
+        printf("ObjectObject '%.*s': %s\r\n", (int)objectCursor.key().bytelen, (const char *)objectCursor.key().pValue,
+               jw.jReadTypeToString(objectCursor.value().dataType));
+
+    // Query inside an element returned earlier, without reading the outer JSON again
+    struct ReadElement inner;
+    jw.getElement("{'anArray'[4", container);
+    jw.getElement(container, "[0", NULL, inner);
+    printf("Relative [0: %.*s\r\n", (int)inner.bytelen, (const char *)inner.pValue);
+    if (jw.getValue(container, "[1", NULL, json_pi) == ReadError::JS_OK)
+        printf("Relative [1: %f\r\n", json_pi);
+
+    // Numbers with exponents, and all numbers of an array in one call
+    double numbers[8];
+    Json::getValue("{\"small\":1e-7}", "{'small'", NULL, &json_pi);
+    printf("Exponent: %g\r\n", json_pi);
+    int numberCount = Json::getNumbers("[1.5, -2e3, 0.25E+2]", "", NULL, numbers, 8);
+    for (int i = 0; i < numberCount; i++)
+        printf("Number %d: %g\r\n", i, numbers[i]);
+
+    // 64 bit integers, overflow is an error
+    long long json_id;
+    unsigned long long json_ts;
+    const char *ids = "{\"id\":-9007199254740993,\"ts\":18446744073709551615,\"big\":18446744073709551616}";
+    if (Json::getValue(ids, "{'id'", NULL, &json_id) == ReadError::JS_OK)
+        printf("Json id: %lld\r\n", json_id);
+    if (Json::getValue(ids, "{'ts'", NULL, &json_ts) == ReadError::JS_OK)
+        printf("Json ts: %llu\r\n", json_ts);
+    if (Json::getValue(ids, "{'big'", NULL, &json_ts) != ReadError::JS_OK)
+        printf("Json big: overflow\r\n");
+
+    // Read one frame of a receive buffer, frames are not '\0'-terminated
+    const char frames[] = "{\"seq\":1,\"temp\":21.5}{\"seq\":2,\"temp\":22}";
+    size_t frameLen = 21; // length of the first frame
+    int json_seq;
+    if (Json::getValue(frames + frameLen, sizeof(frames) - 1 - frameLen, "{'seq'", NULL, &json_seq) == ReadError::JS_OK)
+        printf("Frame 2 seq: %d\r\n", json_seq);
+    if (Json::getValue(frames, frameLen, "{'temp'", NULL, &json_pi) == ReadError::JS_OK)
+        printf("Frame 1 temp: %g\r\n", json_pi);
+
+    // Query a file in place, the file is memory mapped not read
+    FILE *pFile = fopen("jsonTest.json", "w");
+    if (pFile != NULL)
+    {
+        fputs(buffer, pFile);
+        fclose(pFile);
+    }
+    JsonFile file;
+    if (file.open("jsonTest.json", JFILE_SEQUENTIAL | JFILE_WILLNEED) == JFILE_OK)
+    {
+        Json mapped(file);
+        if (mapped.getValue("{'anArray'[4[1", json_pi) == ReadError::JS_OK)
+            printf("Mapped %d bytes, pi: %f\r\n", (int)file.size(), json_pi);
+        file.close();
+    }
+    remove("jsonTest.json");
+
+    // Read JSON Lines, one document per line
+    const char *pLines = "{\"id\":1,\"name\":\"first\"}\n"
+                         "\n"
+                         "{\"id\":2,\"name\":\"second\"}\r\n"
+                         "{\"name\":\"third\",\"id\":3}";
+    JsonLines lines;
+    lines.addQuery("{'id'");
+    lines.addQuery("{'name'");
+    size_t records = lines.read(pLines, strlen(pLines), printRecord, (void *)"Record", JLINES_ORDERED, 2);
+    printf("Records: %d\r\n", (int)records);
+
+    // Read the elements of a top-level array on worker threads
+    const char *pArray = "[{\"id\":1,\"name\":\"first\"}, {\"name\":\"[second]\",\"id\":2}, {\"id\":3}]";
+    JsonArray array;
+    array.addQuery("{'id'");
+    array.addQuery("{'name'");
+    size_t elements = array.read(pArray, strlen(pArray), printElement, (void *)"Element", JARRAY_ORDERED, 2);
+    printf("Elements: %d\r\n", (int)elements);
+
+    // Decode escapes, \uXXXX is written as UTF-8
+    char text[32];
+    size_t textLen;
+    if (Json::getString("{\"text\":\"Tab\\t\\\"\\u00e5\\u20ac\\ud83d\\ude00\\\"\"}", "{'text'", NULL, text, sizeof(text), &textLen) == ReadError::JS_OK)
+        printf("Decoded %d bytes: %s\r\n", (int)textLen, text);
+
+    // Check untrusted text before reading it
+    const char *untrusted = "{\"id\":7,\"ok\":tru}";
+    size_t offset;
+    err = Json::validate(untrusted, strlen(untrusted), &offset);
+    printf("Validate: %s at offset %d\r\n", jw.jReadErrorToString(err), (int)offset);
+
+    // Query literal parsed by the compiler, a bad literal does not compile
+    static constexpr Json::Query piQuery = Json::Query::literal("{'anArray'[4[1");
+    if (jw.getValue(piQuery, NULL, json_pi) == ReadError::JS_OK)
+        printf("Literal query: %f\r\n", json_pi);
+
+    // Cache the results of repeated queries, writer calls drop them
+    CacheEntry cache[8];
+    jw.useCache(cache, 8);
+    for (int i = 0; i < 3; i++)
+        jw.getValue("{'anArray'[4[1", json_pi);
+    printf("Cache: %d hits, %d misses\r\n", (int)jw.getCacheHits(), (int)jw.getCacheMisses());
+
+    // Decode an object into a struct and write it back
+    Json::Binding orderBinding(orderFields);
+    Order order = {0, 0.0, false, ""};
+    int members = Json::decode("{\"name\":\"pen\",\"tags\":[\"a\"],\"id\":12,\"price\":2.5}", "", orderBinding, &order);
+    char orderText[128];
+    Json orderJson(orderText, sizeof(orderText));
+    orderJson.open(NodeType::JS_OBJECT, JW_COMPACT);
+    orderJson.add(orderBinding, &order);
+    orderJson.close();
+    printf("Decode: %d members, %s\r\n", members, orderText);
+
+    // Build a tree, change it and write it out
+    static char arena[4096];
+    JsonDom dom(arena, sizeof(arena));
+    const char *cart = "{\"items\":[{\"sku\":\"A1\",\"qty\":1},{\"sku\":\"B2\",\"qty\":5}],\"note\":\"gift\"}";
+    err = dom.build(cart, strlen(cart));
+    int itemParams[1] = {1};
+    dom.setNumber(dom.find("{'items'[*{'qty'", itemParams), 2LL);
+    dom.setBool(dom.add(dom.getRoot(), "paid"), true);
+    dom.remove(dom.getRoot(), 1); // "note"
+    char cartText[128];
+    JsonDom::print(dom.getRoot(), cartText, sizeof(cartText));
+    printf("DOM: %s, %d bytes of arena, %s\r\n", jw.jReadErrorToString(err), (int)dom.getUsed(), cartText);
+
+    // Every value matching a wildcard or slice query, read in one pass
+    int skus = Json::getMatches(cart, "{'items'[*]{'sku'", NULL, printMatch, (void *)"Item");
+    struct ReadElement quantities[4];
+    int qtys = Json::getMatches(cart, "{'items'[1:]{'qty'", NULL, quantities, 4);
+    printf("Matches: %d skus, %d quantities from item 1\r\n", skus, qtys);
+
+    // Read every value once with a handler
+    Counter counter;
+    err = jw.parse(counter);
+    printf("Parse: %s, %d keys, %d numbers, sum %g\r\n", jw.jReadErrorToString(err), counter.keys, counter.numbers, counter.sum);
+
+    // Find whole messages in input received in fragments
+    const char *fragments[] = {"{\"seq\":1,\"te", "xt\":\"a}\"}{\"se", "q\":2}  [1,", "2]"};
+    JsonPush push;
+    for (int i = 0; i < 4; i++)
+    {
+        const char *pFragment = fragments[i];
+        size_t fragmentLen = strlen(pFragment);
+        int status;
+        while ((status = push.feed(pFragment, fragmentLen)) == JPUSH_COMPLETE)
+        {
+            printf("Message complete in fragment %d at %d\r\n", i, (int)push.getOffset());
+            pFragment += push.getConsumed();
+            fragmentLen -= push.getConsumed();
+        }
+        if (status == JPUSH_ERROR)
+            printf("Push error: %s\r\n", jw.jReadErrorToString(push.getError()));
+    }
+
     return 0;
 }